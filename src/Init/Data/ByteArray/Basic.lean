@@ -77,6 +77,14 @@ protected opaque hash (a : @& ByteArray) : UInt64
 instance : Hashable ByteArray where
   hash := ByteArray.hash
 
+/--
+A fast seedable hash of the bytes of `a`. Hashes of several values can be combined without
+intermediate allocations by passing the result of one call as the seed of the next.
+Unlike `ByteArray.hash`, the result is not stable across Lean versions and must not be persisted.
+-/
+@[extern "lean_byte_array_hash_with_seed"]
+protected opaque hashWithSeed (a : @& ByteArray) (seed : UInt64) : UInt64
+
 def isEmpty (s : ByteArray) : Bool :=
   s.size == 0
 
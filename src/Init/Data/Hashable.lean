@@ -8,6 +8,15 @@ import Init.Data.UInt.Basic
 import Init.Data.String
 universe u
 
+/--
+A fast seedable hash of the UTF-8 encoding of `s`. Hashes of several values can be combined
+without intermediate allocations by passing the result of one call as the seed of the next.
+Unlike `String.hash`, which is used for `Name` hashes stored in `.olean` files, the result is not
+stable across Lean versions and must not be persisted.
+-/
+@[extern "lean_string_hash_with_seed"]
+protected opaque String.hashWithSeed (s : @& String) (seed : UInt64) : UInt64
+
 instance : Hashable Nat where
   hash n := UInt64.ofNat n
 
@@ -0,0 +1,222 @@
+/-
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+prelude
+import Init.Data.Array.Basic
+import Init.Data.UInt.Basic
+import Init.Data.Option.Basic
+import Init.Meta
+universe u
+
+/-!
+Arrays of `UInt16`, `UInt32`, and `UInt64` values. Like `ByteArray` and `FloatArray`, they are represented
+in the runtime by scalar arrays that store their elements unboxed and contiguously, rather than as an `Array`
+of pointers to (for `UInt64`) boxed values.
+-/
+
+set_option hygiene false in
+/--
+Declares the scalar array type `typeName` of `elemType` values and its API. The functions are implemented in the
+runtime by `lean_<cName>_array_<op>` (see `lean.h`).
+-/
+macro "declare_uint_array " typeName:ident elemType:ident cName:str : command => do
+  let ext (op : String) : Lean.StrLit := Lean.Syntax.mkStrLit s!"lean_{cName.getString}_array_{op}"
+  let mkEmptyExt := Lean.Syntax.mkStrLit s!"lean_mk_empty_{cName.getString}_array"
+  let field (n : String) : Lean.Ident := Lean.mkIdent (.str typeName.getId n)
+  let (mkId, dataId, emptyId, appendId) := (field "mk", field "data", field "empty", field "append")
+  let (forInId, forInUnsafeId) := (field "forIn", field "forInUnsafe")
+  let toArray := Lean.mkIdent (.str `List s!"to{typeName.getId}")
+  `(
+structure $typeName where
+  data : Array $elemType
+
+attribute [extern $(ext "mk"):str] $mkId
+attribute [extern $(ext "data"):str] $dataId
+
+namespace $typeName
+@[extern $mkEmptyExt:str]
+def mkEmpty (c : @& Nat) : $typeName :=
+  { data := #[] }
+
+def empty : $typeName :=
+  mkEmpty 0
+
+instance : Inhabited $typeName where
+  default := empty
+
+instance : EmptyCollection $typeName where
+  emptyCollection := $emptyId
+
+@[extern $(ext "push"):str]
+def push : $typeName → $elemType → $typeName
+  | ⟨ds⟩, b => ⟨ds.push b⟩
+
+@[extern $(ext "size"):str]
+def size : (@& $typeName) → Nat
+  | ⟨ds⟩ => ds.size
+
+@[extern "lean_sarray_size", simp]
+def usize (a : @& $typeName) : USize :=
+  a.size.toUSize
+
+@[extern $(ext "uget"):str]
+def uget : (a : @& $typeName) → (i : USize) → i.toNat < a.size → $elemType
+  | ⟨ds⟩, i, h => ds[i]
+
+@[extern $(ext "fget"):str]
+def get : (ds : @& $typeName) → (@& Fin ds.size) → $elemType
+  | ⟨ds⟩, i => ds.get i
+
+@[extern $(ext "get"):str]
+def get! : (@& $typeName) → (@& Nat) → $elemType
+  | ⟨ds⟩, i => ds.get! i
+
+def get? (ds : $typeName) (i : Nat) : Option $elemType :=
+  if h : i < ds.size then
+    ds.get ⟨i, h⟩
+  else
+    none
+
+instance : GetElem $typeName Nat $elemType fun xs i => i < xs.size where
+  getElem xs i h := xs.get ⟨i, h⟩
+
+instance : GetElem $typeName USize $elemType fun xs i => i.val < xs.size where
+  getElem xs i h := xs.uget i h
+
+@[extern $(ext "uset"):str]
+def uset : (a : $typeName) → (i : USize) → $elemType → i.toNat < a.size → $typeName
+  | ⟨ds⟩, i, v, h => ⟨ds.uset i v h⟩
+
+@[extern $(ext "fset"):str]
+def set : (ds : $typeName) → (@& Fin ds.size) → $elemType → $typeName
+  | ⟨ds⟩, i, d => ⟨ds.set i d⟩
+
+@[extern $(ext "set"):str]
+def set! : $typeName → (@& Nat) → $elemType → $typeName
+  | ⟨ds⟩, i, d => ⟨ds.set! i d⟩
+
+/-- Sets all elements of `a` to `v`, in place if `a` is not shared. -/
+@[extern $(ext "fill"):str]
+def fill : $typeName → $elemType → $typeName
+  | ⟨ds⟩, v => ⟨ds.map fun _ => v⟩
+
+/-- Creates an array of `n` copies of `v`. -/
+def mkArray (n : Nat) (v : $elemType) : $typeName :=
+  Nat.fold (fun _ a => a.push v) n (mkEmpty n)
+
+def isEmpty (s : $typeName) : Bool :=
+  s.size == 0
+
+/--
+  Copy the slice at `[srcOff, srcOff + len)` in `src` to `[destOff, destOff + len)` in `dest`, growing `dest` if necessary.
+  If `exact` is `false`, the capacity will be doubled when grown. -/
+@[extern "lean_sarray_copy_slice"]
+def copySlice (src : @& $typeName) (srcOff : Nat) (dest : $typeName) (destOff len : Nat) (exact : Bool := true) : $typeName :=
+  ⟨dest.data.extract 0 destOff ++ src.data.extract srcOff (srcOff + len) ++ dest.data.extract (destOff + min len (src.data.size - srcOff)) dest.data.size⟩
+
+def extract (a : $typeName) (b e : Nat) : $typeName :=
+  a.copySlice b empty 0 (e - b)
+
+protected def append (a : $typeName) (b : $typeName) : $typeName :=
+  -- we assume that `append`s may be repeated, so use asymptotic growing; use `copySlice` directly to customize
+  b.copySlice 0 a a.size b.size false
+
+instance : Append $typeName := ⟨$appendId⟩
+
+partial def toList (ds : $typeName) : List $elemType :=
+  let rec loop (i r) :=
+    if h : i < ds.size then
+      loop (i+1) (ds.get ⟨i, h⟩ :: r)
+    else
+      r.reverse
+  loop 0 []
+
+/--
+  We claim this unsafe implementation is correct because an array cannot have more than `usizeSz` elements in our runtime.
+  This is similar to the `Array` version.
+-/
+-- TODO: avoid code duplication in the future after we improve the compiler.
+@[inline] unsafe def forInUnsafe {β : Type v} {m : Type v → Type w} [Monad m] (as : $typeName) (b : β) (f : $elemType → β → m (ForInStep β)) : m β :=
+  let sz := as.usize
+  let rec @[specialize] loop (i : USize) (b : β) : m β := do
+    if i < sz then
+      let a := as.uget i lcProof
+      match (← f a b) with
+      | ForInStep.done  b => pure b
+      | ForInStep.yield b => loop (i+1) b
+    else
+      pure b
+  loop 0 b
+
+/-- Reference implementation for `forIn` -/
+@[implemented_by $forInUnsafeId]
+protected def forIn {β : Type v} {m : Type v → Type w} [Monad m] (as : $typeName) (b : β) (f : $elemType → β → m (ForInStep β)) : m β :=
+  let rec loop (i : Nat) (h : i ≤ as.size) (b : β) : m β := do
+    match i, h with
+    | 0,   _ => pure b
+    | i+1, h =>
+      have h' : i < as.size            := Nat.lt_of_lt_of_le (Nat.lt_succ_self i) h
+      have : as.size - 1 < as.size     := Nat.sub_lt (Nat.zero_lt_of_lt h') (by decide)
+      have : as.size - 1 - i < as.size := Nat.lt_of_le_of_lt (Nat.sub_le (as.size - 1) i) this
+      match (← f (as.get ⟨as.size - 1 - i, this⟩) b) with
+      | ForInStep.done b  => pure b
+      | ForInStep.yield b => loop i (Nat.le_of_lt h') b
+  loop as.size (Nat.le_refl _) b
+
+instance : ForIn m $typeName $elemType where
+  forIn := $forInId
+
+/-- See comment at `forInUnsafe` -/
+-- TODO: avoid code duplication.
+@[inline]
+unsafe def foldlMUnsafe {β : Type v} {m : Type v → Type w} [Monad m] (f : β → $elemType → m β) (init : β) (as : $typeName) (start := 0) (stop := as.size) : m β :=
+  let rec @[specialize] fold (i : USize) (stop : USize) (b : β) : m β := do
+    if i == stop then
+      pure b
+    else
+      fold (i+1) stop (← f b (as.uget i lcProof))
+  if start < stop then
+    if stop ≤ as.size then
+      fold (USize.ofNat start) (USize.ofNat stop) init
+    else
+      pure init
+  else
+    pure init
+
+/-- Reference implementation for `foldlM` -/
+@[implemented_by foldlMUnsafe]
+def foldlM {β : Type v} {m : Type v → Type w} [Monad m] (f : β → $elemType → m β) (init : β) (as : $typeName) (start := 0) (stop := as.size) : m β :=
+  let fold (stop : Nat) (h : stop ≤ as.size) :=
+    let rec loop (i : Nat) (j : Nat) (b : β) : m β := do
+      if hlt : j < stop then
+        match i with
+        | 0    => pure b
+        | i'+1 =>
+          loop i' (j+1) (← f b (as.get ⟨j, Nat.lt_of_lt_of_le hlt h⟩))
+      else
+        pure b
+    loop (stop - start) start init
+  if h : stop ≤ as.size then
+    fold stop h
+  else
+    fold as.size (Nat.le_refl _)
+
+@[inline]
+def foldl {β : Type v} (f : β → $elemType → β) (init : β) (as : $typeName) (start := 0) (stop := as.size) : β :=
+  Id.run <| as.foldlM f init start stop
+
+end $typeName
+
+def $toArray (ds : List $elemType) : $typeName :=
+  let rec loop
+    | [],    r => r
+    | b::ds, r => loop ds (r.push b)
+  loop ds $emptyId
+
+instance : ToString $typeName := ⟨fun ds => ds.toList.toString⟩
+)
+
+declare_uint_array UInt16Array UInt16 "uint16"
+declare_uint_array UInt32Array UInt32 "uint32"
+declare_uint_array UInt64Array UInt64 "uint64"
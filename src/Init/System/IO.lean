@@ -268,6 +268,42 @@ from a snapshot.
 -/
 @[extern "lean_io_add_heartbeats"] opaque addHeartbeats (count : UInt64) : BaseIO Unit
 
+/--
+Counters about the object graph traversals performed when values are marked multi-threaded (e.g.,
+when they are passed to or returned from a task, see `Runtime.markMultiThreaded`) or persistent
+(see `Runtime.markPersistent`), accumulated over all threads since the start of the process.
+-/
+structure MarkStats where
+  /-- Number of marking calls. -/
+  calls : Nat
+  /-- Number of calls that returned immediately because the value was already marked. -/
+  cutoffs : Nat
+  /-- Total number of objects newly marked. -/
+  objects : Nat
+  /-- Maximal number of objects newly marked by a single call. -/
+  maxObjects : Nat
+  /-- Number of calls that split their traversal with task manager workers. -/
+  parallelCalls : Nat
+  deriving Repr, Inhabited
+
+/--
+Returns the marking statistics for multi-threaded and persistent marking, in this order. Useful for
+finding out whether large values are unnecessarily shared between tasks.
+-/
+@[extern "lean_io_get_mark_stats"] opaque getMarkStats : BaseIO (MarkStats × MarkStats)
+
+/--
+Runs `act` with the small objects it allocates placed in a separate memory arena of the current
+thread. When `act` finishes, the part of its result that is not shared with other data is moved out
+of the arena, and the memory of the arena that no longer contains live objects is released at once
+for reuse. Objects that escape the arena in other ways (e.g., by being stored in an `IO.Ref`) stay
+valid, but keep their part of the arena alive until they are freed.
+
+This is useful for bulk computations whose intermediate data all dies together.
+-/
+@[extern "lean_io_with_arena"]
+def withArena {ε α : Type} (act : EIO ε α) : EIO ε α := act
+
 /--
 The mode of a file handle (i.e., a set of `open` flags and an `fdopen` mode).
 
@@ -455,6 +491,15 @@ see there for more information.
 -/
 @[extern "lean_io_rename"] opaque rename (old new : @& FilePath) : IO Unit
 
+/--
+Creates a new directory entry `link` for the existing file `target` (a hard link).
+Both paths must reside on the same file system.
+
+This function coincides with the [POSIX `link` function](https://pubs.opengroup.org/onlinepubs/9699919799/functions/link.html),
+see there for more information.
+-/
+@[extern "lean_io_hard_link"] opaque hardLink (target link : @& FilePath) : IO Unit
+
 end FS
 
 @[extern "lean_io_getenv"] opaque getEnv (var : @& String) : BaseIO (Option String)
@@ -496,6 +541,14 @@ def readFile (fname : FilePath) : IO String := do
   let h ← Handle.mk fname Mode.read
   h.readToEnd
 
+/--
+Hashes the contents of a file without reading it into memory as a whole.
+The result is `hash (← readBinFile fname)`, or `hash (← readFile fname).crlfToLf` if `normalizeEol` is set
+(in which case the file is not checked to be valid UTF-8).
+-/
+@[extern "lean_io_hash_file"]
+opaque hashFile (fname : @& FilePath) (normalizeEol : Bool := false) : IO UInt64
+
 partial def lines (fname : FilePath) : IO (Array String) := do
   let h ← Handle.mk fname Mode.read
   let rec read (lines : Array String) := do
@@ -729,6 +782,23 @@ Check whether the child has exited yet. If it hasn't return none, otherwise its
 @[extern "lean_io_process_child_try_wait"] opaque Child.tryWait {cfg : @& StdioConfig} : @& Child cfg →
     IO (Option UInt32)
 
+/-- Resources consumed by an exited child process. -/
+structure ResourceUsage where
+  /-- CPU time spent in user mode, in microseconds. -/
+  userTime : UInt64 := 0
+  /-- CPU time spent in the kernel on behalf of the process, in microseconds. -/
+  systemTime : UInt64 := 0
+  /-- Peak resident set size in bytes (the peak working set size on Windows). -/
+  maxRss : UInt64 := 0
+  deriving Inhabited, Repr
+
+/--
+Block until the child process has exited and return its exit code together with
+the resources it consumed.
+-/
+@[extern "lean_io_process_child_wait_with_usage"]
+opaque Child.waitWithUsage {cfg : @& StdioConfig} : @& Child cfg → IO (UInt32 × ResourceUsage)
+
 /-- Terminates the child process using the SIGTERM signal or a platform analogue.
     If the process was started using `SpawnArgs.setsid`, terminates the entire process group instead. -/
 @[extern "lean_io_process_child_kill"] opaque Child.kill {cfg : @& StdioConfig} : @& Child cfg → IO Unit
@@ -759,6 +829,18 @@ def output (args : SpawnArgs) : IO Output := do
   let stdout ← IO.ofExcept stdout.get
   pure { exitCode := exitCode, stdout := stdout, stderr := stderr }
 
+/--
+Run process to completion and capture output as well as the resources the process consumed.
+The process does not inherit the standard input of the caller.
+-/
+def outputWithUsage (args : SpawnArgs) : IO (Output × ResourceUsage) := do
+  let child ← spawn { args with stdout := .piped, stderr := .piped, stdin := .null }
+  let stdout ← IO.asTask child.stdout.readToEnd Task.Priority.dedicated
+  let stderr ← child.stderr.readToEnd
+  let (exitCode, usage) ← child.waitWithUsage
+  let stdout ← IO.ofExcept stdout.get
+  pure ({ exitCode := exitCode, stdout := stdout, stderr := stderr }, usage)
+
 /-- Run process to completion and return stdout on success. -/
 def run (args : SpawnArgs) : IO String := do
   let out ← output args
@@ -57,6 +57,7 @@ builtin_initialize classExtension : SimplePersistentEnvExtension ClassEntry Clas
   registerSimplePersistentEnvExtension {
     addEntryFn    := ClassState.addEntry
     addImportedFn := fun es => (mkStateFromImportedEntries ClassState.addEntry {} es).switch
+    importMode    := .async
   }
 
 /-- Return `true` if `n` is the name of type class in the given environment. -/
@@ -144,9 +144,11 @@ builtin_initialize functionSummariesExt : SimplePersistentEnvExtension (FunId ×
     toArrayFn := fun s => sortEntries s.toArray
   }
 
+@[export lean_ir_add_function_summary]
 def addFunctionSummary (env : Environment) (fid : FunId) (v : Value) : Environment :=
   functionSummariesExt.addEntry (env.addExtraName fid) (fid, v)
 
+@[export lean_ir_get_function_summary]
 def getFunctionSummary? (env : Environment) (fid : FunId) : Option Value :=
   match env.getModuleIdxFor? fid with
   | some modIdx => findAtSorted? (functionSummariesExt.getModuleEntries env modIdx) fid
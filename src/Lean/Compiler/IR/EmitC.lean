@@ -25,6 +25,13 @@ structure Context where
   jpMap      : JPParamsMap := {}
   mainFn     : FunId := default
   mainParams : Array Param := #[]
+  /-- Number of translation units the module is split into, see `emitCShards`. -/
+  numShards  : Nat := 1
+  /-- Translation unit being emitted. Shard `0` contains the module constants, their initializers and the module
+  initialization function, the other shards only contain functions. -/
+  shard      : Nat := 0
+  /-- Shard of each function with parameters, all other declarations belong to shard `0`. -/
+  shardOf    : NameMap Nat := {}
 
 abbrev M := ReaderT Context (EStateM String String)
 
@@ -102,8 +109,12 @@ def shouldExport (n : Name) : Bool :=
 def emitFnDeclAux (decl : Decl) (cppBaseName : String) (isExternal : Bool) : M Unit := do
   let ps := decl.params
   let env ← getEnv
+  let ctx ← read
   if ps.isEmpty then
-    if isClosedTermName env decl.name then emit "static "
+    -- When the module is split, its constants are defined in shard `0` and must be visible to the other shards
+    if ctx.shard > 0 && !isExternal then emit "extern "
+    else if isClosedTermName env decl.name then
+      if ctx.numShards == 1 then emit "static "
     else if isExternal then emit "extern "
     else emit "LEAN_EXPORT "
   else
@@ -220,8 +231,11 @@ def emitMainFnIfNeeded : M Unit := do
 def emitFileHeader : M Unit := do
   let env ← getEnv
   let modName ← getModName
+  let ctx ← read
   emitLn "// Lean compiler output"
   emitLn ("// Module: " ++ toString modName)
+  if ctx.numShards > 1 then
+    emitLn s!"// Shard: {ctx.shard + 1}/{ctx.numShards}"
   emit "// Imports:"
   env.imports.forM fun m => emit (" " ++ toString m)
   emitLn ""
@@ -688,8 +702,11 @@ def emitDecl (d : Decl) : M Unit := do
 
 def emitFns : M Unit := do
   let env ← getEnv;
+  let ctx ← read
   let decls := getDecls env;
-  decls.reverse.forM emitDecl
+  decls.reverse.forM fun d => do
+    if (ctx.shardOf.find? d.name).getD 0 == ctx.shard then
+      emitDecl d
 
 def emitMarkPersistent (d : Decl) (n : Name) : M Unit := do
   if d.resultType.isObj then
@@ -750,10 +767,38 @@ def main : M Unit := do
   emitFileHeader
   emitFnDecls
   emitFns
-  emitInitFn
-  emitMainFnIfNeeded
+  if (← read).shard == 0 then
+    emitInitFn
+    emitMainFnIfNeeded
   emitFileFooter
 
+/-- Number of instructions in `b`. -/
+partial def fnBodySize : FnBody → Nat
+  | .jdecl _ _ v b     => fnBodySize v + fnBodySize b + 1
+  | .case _ _ _ alts   => alts.foldl (fun n alt => n + fnBodySize alt.body) 1
+  | b                  => if b.isTerminal then 1 else fnBodySize b.body + 1
+
+/-- Minimal number of IR instructions in a shard, smaller modules are not split. -/
+def minShardSize := 25000
+
+/--
+Split the functions with parameters of `decls` (in emission order) into at most `numShards` contiguous chunks of
+similar size. Returns the number of shards used and the shard of each function.
+-/
+def assignShards (decls : List Decl) (numShards : Nat) : Nat × NameMap Nat := Id.run do
+  let sizes := decls.filterMap fun
+    | .fdecl (f := f) (xs := xs) (body := b) .. => if xs.isEmpty then none else some (f, fnBodySize b)
+    | _ => none
+  let total := sizes.foldl (fun n (_, size) => n + size) 0
+  let used := max 1 (min numShards (total / minShardSize))
+  let target := (total + used - 1) / used
+  let mut shardOf : NameMap Nat := {}
+  let mut acc := 0
+  for (f, size) in sizes do
+    shardOf := shardOf.insert f (min (used - 1) (acc / target))
+    acc := acc + size
+  return (used, shardOf)
+
 end EmitC
 
 @[export lean_ir_emit_c]
@@ -762,4 +807,20 @@ def emitC (env : Environment) (modName : Name) : Except String String :=
   | EStateM.Result.ok    _   s => Except.ok s
   | EStateM.Result.error err _ => Except.error err
 
+/--
+Emit the C code of the module split into `numShards` translation units, so that they can be compiled in parallel.
+Shard `0` contains the module initialization function, and it is the only one that is not empty when the module is
+too small to be split. The result always contains `numShards` files.
+-/
+@[export lean_ir_emit_c_shards]
+def emitCShards (env : Environment) (modName : Name) (numShards : Nat) : Except String (Array String) := do
+  let (used, shardOf) := EmitC.assignShards (getDecls env).reverse numShards
+  (List.range numShards).toArray.mapM fun shard =>
+    if shard < used then
+      match (EmitC.main { env, modName, numShards := used, shard, shardOf }).run "" with
+      | EStateM.Result.ok    _   s => Except.ok s
+      | EStateM.Result.error err _ => Except.error err
+    else
+      return s!"// Lean compiler output\n// Module: {modName}\n// Shard: {shard + 1}/{numShards} (empty)\n"
+
 end Lean.IR
@@ -37,6 +37,14 @@ unsafe opaque runInit (env : @& Environment) (opts : @& Options) (decl initDecl
 /-- Set of modules for which we have already run the module initializer in the interpreter. -/
 builtin_initialize interpretedModInits : IO.Ref NameSet ← IO.mkRef {}
 
+/--
+Forget the modules whose initializers have been run by the interpreter, so that they are run again by the next
+import. Used between the files elaborated by `lean --build-worker`, which must not share global state.
+-/
+@[export lean_reset_interpreted_mod_inits]
+def resetInterpretedModInits : IO Unit :=
+  interpretedModInits.set {}
+
 unsafe def registerInitAttrUnsafe (attrName : Name) (runAfterImport : Bool) (ref : Name) : IO (ParametricAttribute Name) :=
   registerParametricAttribute {
     ref := ref
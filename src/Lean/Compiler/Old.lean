@@ -52,6 +52,11 @@ def isUnsafeRecName? : Name → Option Name
   | .str n "_unsafe_rec" => some n
   | _ => none
 
+/--
+Declaration groups whose code generation has been postponed by `compiler.parallel`, most recent first, together with
+the options in effect when they were declared. See `Environment.compilePendingDecls`. -/
+builtin_initialize pendingCodeGenExt : EnvExtension (List (List Name × Options)) ← registerEnvExtension (pure [])
+
 end Compiler
 
 namespace Environment
@@ -67,4 +72,53 @@ opaque compileDecls (env : Environment) (opt : @& Options) (decls : @& List Name
 def compileDecl (env : Environment) (opt : @& Options) (decl : @& Declaration) : Except KernelException Environment :=
   compileDecls env opt (Compiler.getDeclNamesForCodeGen decl)
 
+/--
+Compile the given blocks of mutual declarations, in order, each one using its own options.
+Blocks that do not use each other are compiled in parallel using tasks, and their results are merged in the given
+order, so the resulting environment does not depend on how the tasks were scheduled.
+-/
+@[extern "lean_compile_decl_groups"]
+opaque compileDeclGroups (env : Environment) (groups : @& List (List Name × Options)) : Except KernelException Environment
+
+/--
+Postpone the compilation of the given block of mutual declarations until `compilePendingDecls`.
+The block will be compiled using `opt`, the options in effect at the declaration.
+-/
+def addPendingCodeGen (env : Environment) (opt : Options) (decls : List Name) : Environment :=
+  Compiler.pendingCodeGenExt.modifyState env ((decls, opt) :: ·)
+
+/-- Compile all declaration blocks postponed using `addPendingCodeGen`. -/
+def compilePendingDecls (env : Environment) : Except KernelException Environment :=
+  match Compiler.pendingCodeGenExt.getState env with
+  | []     => .ok env
+  | groups => compileDeclGroups (Compiler.pendingCodeGenExt.setState env []) groups.reverse
+
+/-- Mark the blocks in `groups` (in declaration order) that the code of `declName` uses, directly or indirectly. -/
+@[extern "lean_get_decl_groups_used_by"]
+opaque getDeclGroupsUsedBy (env : Environment) (groups : @& List (List Name × Options)) (declName : @& Name) : List Bool
+
+/--
+Compile the blocks postponed using `addPendingCodeGen` that the code of `declName` uses; the other blocks remain
+postponed.
+-/
+def compilePendingDeclsFor (env : Environment) (declName : Name) : Except KernelException Environment :=
+  match Compiler.pendingCodeGenExt.getState env with
+  | []     => .ok env
+  | groups =>
+    let groups := groups.reverse
+    let (used, rest) := (groups.zip (getDeclGroupsUsedBy env groups declName)).partition (·.2)
+    let env := Compiler.pendingCodeGenExt.setState env (rest.map (·.1)).reverse
+    compileDeclGroups env (used.map (·.1))
+
+/--
+`evalConst` calls this function on its own copy of the environment when `declName` has not been compiled yet.
+Errors are reported as strings, like the other errors of `evalConst`.
+-/
+@[export lean_compile_pending_decls_for]
+private def compilePendingDeclsForEval (env : Environment) (declName : Name) : Except String Environment :=
+  match env.compilePendingDeclsFor declName with
+  | .ok env => .ok env
+  | .error (.other msg) => .error msg
+  | .error _ => .error "(kernel) failed to compile the declarations postponed by `compiler.parallel`"
+
 end Environment
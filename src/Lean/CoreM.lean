@@ -430,6 +430,12 @@ register_builtin_option compiler.enableNew : Bool := {
   descr    := "(compiler) enable the new code generator, this should have no significant effect on your code but it does help to test the new code generator; unset to only use the old code generator instead"
 }
 
+register_builtin_option compiler.parallel : Bool := {
+  defValue := false
+  group    := "compiler"
+  descr    := "(compiler) postpone code generation until the end of the file (or until code needs to be evaluated) and compile independent declarations in parallel; compilation errors are then reported at that point"
+}
+
 -- Forward declaration
 @[extern "lean_lcnf_compile_decls"]
 opaque compileDeclsNew (declNames : List Name) : CoreM Unit
@@ -439,6 +445,9 @@ def compileDecl (decl : Declaration) : CoreM Unit := do
   let decls := Compiler.getDeclNamesForCodeGen decl
   if compiler.enableNew.get opts then
     compileDeclsNew decls
+  if compiler.parallel.get opts then
+    modifyEnv (·.addPendingCodeGen opts decls)
+    return
   let res ← withTraceNode `compiler (fun _ => return m!"compiling old: {decls}") do
     return (← getEnv).compileDecl opts decl
   match res with
@@ -453,6 +462,9 @@ def compileDecls (decls : List Name) : CoreM Unit := do
   let opts ← getOptions
   if compiler.enableNew.get opts then
     compileDeclsNew decls
+  if compiler.parallel.get opts then
+    modifyEnv (·.addPendingCodeGen opts decls)
+    return
   match (← getEnv).compileDecls opts decls with
   | Except.ok env   => setEnv env
   | Except.error (KernelException.other msg) =>
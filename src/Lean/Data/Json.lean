@@ -8,5 +8,6 @@ prelude
 import Lean.Data.Json.Stream
 import Lean.Data.Json.Printer
 import Lean.Data.Json.Parser
+import Lean.Data.Json.Native
 import Lean.Data.Json.FromToJson
 import Lean.Data.Json.Elab
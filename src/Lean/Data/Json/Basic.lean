@@ -93,6 +93,7 @@ instance : Ord JsonNumber where
     else if x > y then Ordering.gt
     else Ordering.eq
 
+@[export lean_json_number_to_string]
 protected def toString : JsonNumber → String
   | ⟨m, 0⟩ => m.repr
   | ⟨m, e⟩ =>
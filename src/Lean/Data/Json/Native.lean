@@ -0,0 +1,34 @@
+/-
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+prelude
+import Lean.Data.Json.Basic
+
+/-!
+# Native JSON parsing and printing
+
+Implementations of `Json.parse` and `Json.compress` in C++ (see `src/library/json.cpp`), used by the
+language server for the messages it exchanges with clients and workers, where parsing and printing in
+Lean was a significant part of the cost of large messages such as semantic tokens and diagnostics.
+They agree with the Lean implementations on all inputs, except for the wording of error messages.
+-/
+
+namespace Lean.Json
+
+/-- Parses a JSON value like `Json.parse`. -/
+@[extern "lean_json_parse"]
+opaque parseNative (s : @& String) : Except String Json
+
+/--
+Parses a JSON value from its UTF-8 encoding like `Json.parse`, failing with `"invalid UTF-8"` if
+`bytes` is not valid UTF-8. This avoids copying the input into a `String` first.
+-/
+@[extern "lean_json_parse_utf8"]
+opaque parseUTF8Native (bytes : @& ByteArray) : Except String Json
+
+/-- Renders a JSON value like `Json.compress`. -/
+@[extern "lean_json_compress"]
+opaque compressNative (j : @& Json) : String
+
+end Lean.Json
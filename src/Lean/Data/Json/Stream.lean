@@ -9,6 +9,7 @@ import Init.System.IO
 import Lean.Data.Json.Parser
 import Lean.Data.Json.Printer
 import Lean.Data.Json.FromToJson
+import Lean.Data.Json.Native
 
 namespace IO.FS.Stream
 
@@ -18,11 +19,10 @@ open IO
 /-- Consumes `nBytes` bytes from the stream, interprets the bytes as a utf-8 string and the string as a valid JSON object. -/
 def readJson (h : FS.Stream) (nBytes : Nat) : IO Json := do
   let bytes ← h.read (USize.ofNat nBytes)
-  let some s := String.fromUTF8? bytes | throw (IO.userError "invalid UTF-8")
-  ofExcept (Json.parse s)
+  ofExcept (Json.parseUTF8Native bytes)
 
 def writeJson (h : FS.Stream) (j : Json) : IO Unit := do
-  h.putStr j.compress
+  h.putStr j.compressNative
   h.flush
 
 end IO.FS.Stream
@@ -99,7 +99,7 @@ section
   def writeLspMessage (h : FS.Stream) (msg : Message) : IO Unit := do
     -- inlined implementation instead of using jsonrpc's writeMessage
     -- to maintain the atomicity of putStr
-    let j := (toJson msg).compress
+    let j := (toJson msg).compressNative
     let header := s!"Content-Length: {toString j.utf8ByteSize}\r\n\r\n"
     h.putStr (header ++ j)
     h.flush
@@ -378,12 +378,29 @@ structure SemanticTokensLegend where
   tokenModifiers : Array String
   deriving FromJson, ToJson
 
+/-- Support for `textDocument/semanticTokens/full` requests: `boolean | { delta?: boolean }`. -/
+inductive SemanticTokensFullOptions where
+  | bool (b : Bool)
+  /-- Full requests are supported, and so are `textDocument/semanticTokens/full/delta` requests if `delta`. -/
+  | withDelta (delta : Bool)
+  deriving Inhabited
+
+instance : FromJson SemanticTokensFullOptions where
+  fromJson?
+    | .bool b => return .bool b
+    | j => do
+      let _ ← j.getObj?
+      return .withDelta ((j.getObjValAs? Bool "delta").toOption.getD false)
+
+instance : ToJson SemanticTokensFullOptions where
+  toJson
+    | .bool b => b
+    | .withDelta delta => Json.mkObj [("delta", delta)]
+
 structure SemanticTokensOptions where
   legend : SemanticTokensLegend
   range  : Bool
-  full   : Bool /- | {
-    delta?: boolean;
-  } -/
+  full   : SemanticTokensFullOptions
   deriving FromJson, ToJson
 
 structure SemanticTokensParams where
@@ -400,6 +417,43 @@ structure SemanticTokens where
   data      : Array Nat
   deriving FromJson, ToJson
 
+structure SemanticTokensDeltaParams where
+  textDocument     : TextDocumentIdentifier
+  previousResultId : String
+  deriving FromJson, ToJson
+
+/-- Replaces `deleteCount` numbers of the previous `SemanticTokens.data` at `start` with `data?`. -/
+structure SemanticTokensEdit where
+  start       : Nat
+  deleteCount : Nat
+  data?       : Option (Array Nat) := none
+  deriving FromJson, ToJson
+
+structure SemanticTokensDelta where
+  resultId? : Option String := none
+  edits     : Array SemanticTokensEdit
+  deriving FromJson, ToJson
+
+/--
+Response to `textDocument/semanticTokens/full/delta`: either all tokens or the edits to the tokens
+of the result with ID `SemanticTokensDeltaParams.previousResultId`.
+-/
+inductive SemanticTokensDeltaResult where
+  | tokens (tokens : SemanticTokens)
+  | delta (delta : SemanticTokensDelta)
+
+instance : FromJson SemanticTokensDeltaResult where
+  fromJson? j :=
+    if (j.getObjVal? "edits").toOption.isSome then
+      .delta <$> fromJson? j
+    else
+      .tokens <$> fromJson? j
+
+instance : ToJson SemanticTokensDeltaResult where
+  toJson
+    | .tokens tokens => toJson tokens
+    | .delta delta => toJson delta
+
 structure FoldingRangeParams where
   textDocument : TextDocumentIdentifier
   deriving FromJson, ToJson
@@ -79,6 +79,11 @@ partial def processCommands : FrontendM Unit := do
 
 end Frontend
 
+register_builtin_option hashConsExprs : Bool := {
+  defValue := false
+  descr    := "(experimental) hash-cons all expressions created by the frontend, see `Lean.Expr.setHashConsing`. Must be set on the command line."
+}
+
 open Frontend
 
 def IO.processCommands (inputCtx : Parser.InputContext) (parserState : Parser.ModuleParserState) (commandState : Command.State) : IO State := do
@@ -173,15 +178,14 @@ If the option is defined in this library, use '-D{`weak ++ name}' to set it cond
 
   return opts
 
-@[export lean_run_frontend]
-def runFrontend
+private def runFrontendCore
     (input : String)
     (opts : Options)
     (fileName : String)
     (mainModuleName : Name)
-    (trustLevel : UInt32 := 0)
-    (ileanFileName? : Option String := none)
-    (jsonOutput : Bool := false)
+    (trustLevel : UInt32)
+    (ileanFileName? : Option String)
+    (jsonOutput : Bool)
     : IO (Environment × Bool) := do
   let startTime := (← IO.monoNanosNow).toFloat / 1000000000
   let inputCtx := Parser.mkInputContext input fileName
@@ -191,7 +195,9 @@ def runFrontend
     -- outside the server
     let (header, parserState, messages) ← Parser.parseHeader inputCtx
     -- allow `env` to be leaked, which would live until the end of the process anyway
-    let (env, messages) ← processHeader (leakEnv := true) header opts messages inputCtx trustLevel
+    -- (unless the process elaborates several files)
+    let leakEnv := !(← isModuleDataCacheEnabled)
+    let (env, messages) ← processHeader (leakEnv := leakEnv) header opts messages inputCtx trustLevel
     -- now that imports have been loaded, check options again
     let opts ← reparseOptions opts
     let env := env.setMainModule mainModuleName
@@ -202,7 +208,14 @@ def runFrontend
       -- Collect InfoTrees so we can later extract and export their info to the ilean file
       commandState := { commandState with infoState.enabled := true }
 
-    let s ← IO.processCommands inputCtx parserState commandState
+    let mut s ← IO.processCommands inputCtx parserState commandState
+    -- generate the code postponed by `compiler.parallel`
+    match s.commandState.env.compilePendingDecls with
+    | .ok env => s := { s with commandState.env := env }
+    | .error ex =>
+      let msg : Message := {
+        fileName, pos := inputCtx.fileMap.toPosition inputCtx.input.endPos, data := ex.toMessageData opts }
+      s := { s with commandState.messages := s.commandState.messages.add msg }
     Language.reportMessages s.commandState.messages opts jsonOutput
 
     if let some ileanFileName := ileanFileName? then
@@ -210,7 +223,7 @@ def runFrontend
       let references ←
         Lean.Server.findModuleRefs inputCtx.fileMap trees (localVars := false) |>.toLspModuleRefs
       let ilean := { module := mainModuleName, references : Lean.Server.Ilean }
-      IO.FS.writeFile ileanFileName $ Json.compress $ toJson ilean
+      ilean.save ileanFileName
 
     if let some out := trace.profiler.output.get? opts then
       let traceState := s.commandState.traceState
@@ -236,7 +249,7 @@ def runFrontend
     let trees := snaps.getAll.concatMap (match ·.infoTree? with | some t => #[t] | _ => #[])
     let references := Lean.Server.findModuleRefs inputCtx.fileMap trees (localVars := false)
     let ilean := { module := mainModuleName, references := ← references.toLspModuleRefs : Lean.Server.Ilean }
-    IO.FS.writeFile ileanFileName $ Json.compress $ toJson ilean
+    ilean.save ileanFileName
 
   let hasErrors := snaps.getAll.any (·.diagnostics.msgLog.hasErrors)
   -- TODO: remove default when reworking cmdline interface in Lean; currently the only case
@@ -244,5 +257,24 @@ def runFrontend
   let env := Language.Lean.waitForFinalEnv? snap |>.getD (← mkEmptyEnvironment)
   pure (env, !hasErrors)
 
+@[export lean_run_frontend]
+def runFrontend
+    (input : String)
+    (opts : Options)
+    (fileName : String)
+    (mainModuleName : Name)
+    (trustLevel : UInt32 := 0)
+    (ileanFileName? : Option String := none)
+    (jsonOutput : Bool := false)
+    : IO (Environment × Bool) := do
+  unless hashConsExprs.get opts do
+    return ← runFrontendCore input opts fileName mainModuleName trustLevel ileanFileName? jsonOutput
+  -- Restore the previous setting afterwards as the process may go on to process other files (`--build-worker`)
+  let prev ← Expr.isHashConsing
+  Expr.setHashConsing true
+  try
+    runFrontendCore input opts fileName mainModuleName trustLevel ileanFileName? jsonOutput
+  finally
+    Expr.setHashConsing prev
 
 end Lean.Elab
@@ -133,8 +133,11 @@ structure Environment where
   Remark: this mapping also contains auxiliary constants, created by the code generator, that are **not** in
   the field `constants`. These auxiliary constants are invisible to the Lean kernel and elaborator.
   Only the code generator uses them.
+
+  The mapping is not needed to construct the `constants` of an imported environment, so `finalizeImport` builds
+  it in a separate task. Use `getModuleIdxFor?`, which waits for the task if necessary, to access it.
   -/
-  const2ModIdx : HashMap Name ModuleIdx
+  const2ModIdx : Task (HashMap Name ModuleIdx)
   /--
   Mapping from constant name to `ConstantInfo`. It contains all constants (definitions, theorems, axioms, etc)
   that have been already type checked by the kernel.
@@ -205,7 +208,7 @@ private def getTrustLevel (env : Environment) : UInt32 :=
   env.header.trustLevel
 
 def getModuleIdxFor? (env : Environment) (declName : Name) : Option ModuleIdx :=
-  env.const2ModIdx.find? declName
+  env.const2ModIdx.get.find? declName
 
 def isConstructor (env : Environment) (declName : Name) : Bool :=
   match env.find? declName with
@@ -418,16 +421,38 @@ def mkEmptyEnvironment (trustLevel : UInt32 := 0) : IO Environment := do
   if initializing then throw (IO.userError "environment objects cannot be created during initialization")
   let exts ← mkInitialExtensionStates
   pure {
-    const2ModIdx    := {}
+    const2ModIdx    := .pure {}
     constants       := {}
     header          := { trustLevel := trustLevel }
     extraConstNames := {}
     extensions      := exts
   }
 
+/-- When the state of a `PersistentEnvExtension` is computed from the imported entries. -/
+inductive EnvExtensionImportMode where
+  /-- By `addImportedFn`, when the environment is imported. This is the default. -/
+  | sync
+  /--
+  By `addImportedPureFn?`, in a separate task started when the environment is imported.
+  The first access to the state waits for the task.
+  -/
+  | async
+  /--
+  By `addImportedPureFn?`, on the first access to the state. This is useful for extensions that
+  are not consulted by most files (e.g., because they are only used by the language server).
+  -/
+  | lazy
+  deriving Inhabited, BEq, Repr
+
 structure PersistentEnvExtensionState (α : Type) (σ : Type) where
   importedEntries : Array (Array α)  -- entries per imported module
   state : σ
+  /--
+  The state computed from `importedEntries` by an extension not imported `.sync`, if it has not
+  been modified since the import. It takes precedence over `state`, which is the initial state
+  in this case. Use `PersistentEnvExtension.getState` instead of accessing `state` directly.
+  -/
+  importedState? : Option (Thunk σ) := none
 
 structure ImportM.Context where
   env  : Environment
@@ -487,6 +512,12 @@ structure PersistentEnvExtension (α : Type) (β : Type) (σ : Type) where
   addEntryFn      : σ → β → σ
   exportEntriesFn : σ → Array α
   statsFn         : σ → Format
+  importMode      : EnvExtensionImportMode := .sync
+  /--
+  Computes the imported state for `importMode`s other than `.sync`. It replaces `addImportedFn`,
+  which cannot run outside of the import as it has access to the environment being imported.
+  -/
+  addImportedPureFn? : Option (Array (Array α) → σ) := none
 
 instance {α σ} [Inhabited σ] : Inhabited (PersistentEnvExtensionState α σ) :=
   ⟨{importedEntries := #[], state := default }⟩
@@ -501,6 +532,12 @@ instance {α β σ} [Inhabited σ] : Inhabited (PersistentEnvExtension α β σ)
      statsFn := fun _ => Format.nil
   }
 
+/-- The current state of an extension, computing the imported state if necessary. -/
+@[inline] private def PersistentEnvExtensionState.getState {α σ : Type} (s : PersistentEnvExtensionState α σ) : σ :=
+  match s.importedState? with
+  | some state => state.get
+  | none       => s.state
+
 namespace PersistentEnvExtension
 
 def getModuleEntries {α β σ : Type} [Inhabited σ] (ext : PersistentEnvExtension α β σ) (env : Environment) (m : ModuleIdx) : Array α :=
@@ -508,20 +545,20 @@ def getModuleEntries {α β σ : Type} [Inhabited σ] (ext : PersistentEnvExtens
 
 def addEntry {α β σ : Type} (ext : PersistentEnvExtension α β σ) (env : Environment) (b : β) : Environment :=
   ext.toEnvExtension.modifyState env fun s =>
-    let state   := ext.addEntryFn s.state b;
-    { s with state := state }
+    let state   := ext.addEntryFn s.getState b;
+    { s with state := state, importedState? := none }
 
 /-- Get the current state of the given extension in the given environment. -/
 def getState {α β σ : Type} [Inhabited σ] (ext : PersistentEnvExtension α β σ) (env : Environment) : σ :=
-  (ext.toEnvExtension.getState env).state
+  (ext.toEnvExtension.getState env).getState
 
 /-- Set the current state of the given extension in the given environment. This change is *not* persisted across files. -/
 def setState {α β σ : Type} (ext : PersistentEnvExtension α β σ) (env : Environment) (s : σ) : Environment :=
-  ext.toEnvExtension.modifyState env fun ps => { ps with  state := s }
+  ext.toEnvExtension.modifyState env fun ps => { ps with  state := s, importedState? := none }
 
 /-- Modify the state of the given extension in the given environment by applying the given function. This change is *not* persisted across files. -/
 def modifyState {α β σ : Type} (ext : PersistentEnvExtension α β σ) (env : Environment) (f : σ → σ) : Environment :=
-  ext.toEnvExtension.modifyState env fun ps => { ps with state := f (ps.state) }
+  ext.toEnvExtension.modifyState env fun ps => { ps with state := f ps.getState, importedState? := none }
 
 end PersistentEnvExtension
 
@@ -534,10 +571,16 @@ structure PersistentEnvExtensionDescr (α β σ : Type) where
   addEntryFn      : σ → β → σ
   exportEntriesFn : σ → Array α
   statsFn         : σ → Format := fun _ => Format.nil
+  /-- When the imported state is computed. Modes other than `.sync` require `addImportedPureFn?`. -/
+  importMode      : EnvExtensionImportMode := .sync
+  /-- Computes the imported state from the imported entries, see `PersistentEnvExtension.addImportedPureFn?`. -/
+  addImportedPureFn? : Option (Array (Array α) → σ) := none
 
 unsafe def registerPersistentEnvExtensionUnsafe {α β σ : Type} [Inhabited σ] (descr : PersistentEnvExtensionDescr α β σ) : IO (PersistentEnvExtension α β σ) := do
   let pExts ← persistentEnvExtensionsRef.get
   if pExts.any (fun ext => ext.name == descr.name) then throw (IO.userError s!"invalid environment extension, '{descr.name}' has already been used")
+  if descr.importMode != .sync && descr.addImportedPureFn?.isNone then
+    throw (IO.userError s!"invalid environment extension '{descr.name}', import mode {repr descr.importMode} requires `addImportedPureFn?`")
   let ext ← registerEnvExtension do
     let initial ← descr.mkInitial
     let s : PersistentEnvExtensionState α σ := {
@@ -551,7 +594,9 @@ unsafe def registerPersistentEnvExtensionUnsafe {α β σ : Type} [Inhabited σ]
     addImportedFn   := descr.addImportedFn,
     addEntryFn      := descr.addEntryFn,
     exportEntriesFn := descr.exportEntriesFn,
-    statsFn         := descr.statsFn
+    statsFn         := descr.statsFn,
+    importMode      := descr.importMode,
+    addImportedPureFn? := descr.addImportedPureFn?
   }
   persistentEnvExtensionsRef.modify fun pExts => pExts.push (unsafeCast pExt)
   return pExt
@@ -570,6 +615,8 @@ structure SimplePersistentEnvExtensionDescr (α σ : Type) where
   addEntryFn    : σ → α → σ
   addImportedFn : Array (Array α) → σ
   toArrayFn     : List α → Array α := fun es => es.toArray
+  /-- When `addImportedFn` is run, see `EnvExtensionImportMode`. -/
+  importMode    : EnvExtensionImportMode := .sync
 
 def registerSimplePersistentEnvExtension {α σ : Type} [Inhabited σ] (descr : SimplePersistentEnvExtensionDescr α σ) : IO (SimplePersistentEnvExtension α σ) :=
   registerPersistentEnvExtension {
@@ -580,6 +627,8 @@ def registerSimplePersistentEnvExtension {α σ : Type} [Inhabited σ] (descr :
       | (entries, s) => (e::entries, descr.addEntryFn s e),
     exportEntriesFn := fun s => descr.toArrayFn s.1.reverse,
     statsFn := fun s => format "number of local entries: " ++ format s.1.length
+    importMode      := descr.importMode
+    addImportedPureFn? := some fun as => ([], descr.addImportedFn as)
   }
 
 namespace SimplePersistentEnvExtension
@@ -678,6 +727,39 @@ opaque saveModuleData (fname : @& System.FilePath) (mod : @& Name) (data : @& Mo
 @[extern "lean_read_module_data"]
 opaque readModuleData (fname : @& System.FilePath) : IO (ModuleData × CompactedRegion)
 
+/--
+  Module data read by the imports of previous elaborations in this process, indexed by `.olean` file and
+  stored with the file's modification time at the time it was read. The cache is disabled (`none`) by default
+  and enabled by processes that elaborate several files one after another (see `lean --build-worker`), so that
+  each file does not have to read and relocate its imports again. The compacted regions of cached modules are
+  owned by the cache and never freed; in particular, they are not added to the `regions` of an environment. -/
+builtin_initialize moduleDataCacheRef :
+    IO.Ref (Option (HashMap System.FilePath (IO.FS.SystemTime × ModuleData × CompactedRegion))) ← IO.mkRef none
+
+/-- Enables `moduleDataCacheRef`. -/
+@[export lean_enable_module_data_cache]
+def enableModuleDataCache : IO Unit :=
+  moduleDataCacheRef.modify fun cache? => some (cache?.getD {})
+
+/-- Returns `true` if `moduleDataCacheRef` is enabled, i.e., if this process elaborates several files. -/
+def isModuleDataCacheEnabled : BaseIO Bool :=
+  return (← moduleDataCacheRef.get).isSome
+
+/--
+  Like `readModuleData`, but reuses the data cached in `moduleDataCacheRef` (if enabled) unless the file was
+  modified since. Returns the compacted region of the data unless it is owned by the cache.
+  If a cached file was modified, the region of the old data is leaked, as it may still be referenced. -/
+def readModuleDataCached (fname : System.FilePath) : IO (ModuleData × Option CompactedRegion) := do
+  let some cache ← moduleDataCacheRef.get
+    | return Prod.map id some (← readModuleData fname)
+  let mtime := (← fname.metadata).modified
+  if let some (cachedMTime, mod, _) := cache.find? fname then
+    if cachedMTime == mtime then
+      return (mod, none)
+  let (mod, region) ← readModuleData fname
+  moduleDataCacheRef.modify fun cache? => cache?.map (·.insert fname (mtime, mod, region))
+  return (mod, none)
+
 /--
   Free compacted regions of imports. No live references to imported objects may exist at the time of invocation; in
   particular, `env` should be the last reference to any `Environment` derived from these imports. -/
@@ -703,7 +785,10 @@ unsafe def Environment.freeRegions (env : Environment) : IO Unit :=
 def mkModuleData (env : Environment) : IO ModuleData := do
   let pExts ← persistentEnvExtensionsRef.get
   let entries := pExts.map fun pExt =>
-    let state := pExt.getState env
+    /- We do not use `pExt.getState` here, which would force the imported state of `.async` and `.lazy` extensions.
+       If the imported state is still pending, the extension has not been modified since the import, and
+       `state` is its initial state, from which the (empty) local entries are exported. -/
+    let state := (pExt.toEnvExtension.getState env).state
     (pExt.name, pExt.exportEntriesFn state)
   let constNames := env.constants.foldStage2 (fun names name _ => names.push name) #[]
   let constants  := env.constants.foldStage2 (fun cs _ c => cs.push c) #[]
@@ -770,8 +855,20 @@ where
       let s := extDescr.toEnvExtension.getState env
       let prevSize := (← persistentEnvExtensionsRef.get).size
       let prevAttrSize ← getNumBuiltinAttributes
-      let newState ← extDescr.addImportedFn s.importedEntries { env := env, opts := opts }
-      let mut env := extDescr.toEnvExtension.setState env { s with state := newState }
+      let mut env := env
+      match extDescr.importMode, extDescr.addImportedPureFn? with
+      | .async, some f =>
+        let entries := s.importedEntries
+        let task := Task.spawn fun _ => profileit "import" opts (decl := extDescr.name) fun _ => f entries
+        env := extDescr.toEnvExtension.setState env { s with importedState? := some (Thunk.mk fun _ => task.get) }
+      | .lazy, some f =>
+        let entries := s.importedEntries
+        let state := Thunk.mk fun _ => profileit "import" opts (decl := extDescr.name) fun _ => f entries
+        env := extDescr.toEnvExtension.setState env { s with importedState? := some state }
+      | _, _ =>
+        let newState ← profileitIO "import" opts (decl := extDescr.name) do
+          extDescr.addImportedFn s.importedEntries { env := env, opts := opts }
+        env := extDescr.toEnvExtension.setState env { s with state := newState }
       env ← ensureExtensionsArraySize env
       if (← persistentEnvExtensionsRef.get).size > prevSize || (← getNumBuiltinAttributes) > prevAttrSize then
         -- This branch is executed when `pExtDescrs[i]` is the extension associated with the `init` attribute, and
@@ -790,9 +887,10 @@ structure ImportState where
   moduleData    : Array ModuleData := #[]
   regions       : Array CompactedRegion := #[]
 
-def throwAlreadyImported (s : ImportState) (const2ModIdx : HashMap Name ModuleIdx) (modIdx : Nat) (cname : Name) : IO α := do
+def throwAlreadyImported (s : ImportState) (modIdx : Nat) (cname : Name) : IO α := do
   let modName := s.moduleNames[modIdx]!
-  let constModName := s.moduleNames[const2ModIdx[cname].get!.toNat]!
+  let constModIdx := s.moduleData.findIdx? (·.constNames.contains cname) |>.get!
+  let constModName := s.moduleNames[constModIdx]!
   throw <| IO.userError s!"import {modName} failed, environment already contains '{cname}' from {constModName}"
 
 abbrev ImportStateM := StateRefT ImportState IO
@@ -808,11 +906,11 @@ partial def importModulesCore (imports : Array Import) : ImportStateM Unit := do
     let mFile ← findOLean i.module
     unless (← mFile.pathExists) do
       throw <| IO.userError s!"object file '{mFile}' of module {i.module} does not exist"
-    let (mod, region) ← readModuleData mFile
+    let (mod, region?) ← readModuleDataCached mFile
     importModulesCore mod.imports
     modify fun s => { s with
       moduleData  := s.moduleData.push mod
-      regions     := s.regions.push region
+      regions     := s.regions ++ region?.toArray
       moduleNames := s.moduleNames.push i.module
     }
 
@@ -843,6 +941,17 @@ private def equivInfo (cinfo₁ cinfo₂ : ConstantInfo) : Bool := Id.run do
     && tval₁.levelParams == tval₂.levelParams
     && tval₁.all == tval₂.all
 
+/-- Construct the `const2ModIdx` mapping of an environment importing `moduleData`. -/
+def mkConst2ModIdx (moduleData : Array ModuleData) (numConsts : Nat) : HashMap Name ModuleIdx := Id.run do
+  let mut const2ModIdx : HashMap Name ModuleIdx := mkHashMap (capacity := numConsts)
+  for h:modIdx in [0:moduleData.size] do
+    let mod := moduleData[modIdx]'h.upper
+    for cname in mod.constNames do
+      const2ModIdx := const2ModIdx.insertIfNew cname modIdx |>.1
+    for cname in mod.extraConstNames do
+      const2ModIdx := const2ModIdx.insertIfNew cname modIdx |>.1
+  return const2ModIdx
+
 /--
   Construct environment from `importModulesCore` results.
 
@@ -851,12 +960,25 @@ private def equivInfo (cinfo₁ cinfo₂ : ConstantInfo) : Bool := Id.run do
   the process anyway. In exchange, RC updates are avoided, which is especially
   important when they would be atomic because the environment is shared across
   threads (potentially, storing it in an `IO.Ref` is sufficient for marking it
-  as such). -/
+  as such).
+
+  The `const2ModIdx` mapping is built on a dedicated thread in parallel with the
+  constant map and the imported extension states. It has an entry for each imported
+  constant, like the constant map, so it costs about as much to build. The time spent
+  building it is reported by the profiler in the `import (module index)` category.
+  We do not replace it with a lookup in the `constNames` of each imported module:
+  `getModuleIdxFor?` is used by most environment extensions (e.g., to get the
+  reducibility status of a declaration), and would then cost a binary search per
+  imported module instead of a single hash map lookup.
+  Marking the environment persistent waits for this task, so with `leakEnv`, only the
+  final marking (after the extension states are finalized) marks `const2ModIdx`. -/
 def finalizeImport (s : ImportState) (imports : Array Import) (opts : Options) (trustLevel : UInt32 := 0)
     (leakEnv := false) : IO Environment := do
   let numConsts := s.moduleData.foldl (init := 0) fun numConsts mod =>
     numConsts + mod.constants.size + mod.extraConstNames.size
-  let mut const2ModIdx : HashMap Name ModuleIdx := mkHashMap (capacity := numConsts)
+  let moduleData := s.moduleData
+  let const2ModIdx := Task.spawn (prio := .dedicated) fun _ =>
+    profileit "import (module index)" opts fun _ => mkConst2ModIdx moduleData numConsts
   let mut constantMap : HashMap Name ConstantInfo := mkHashMap (capacity := numConsts)
   for h:modIdx in [0:s.moduleData.size] do
     let mod := s.moduleData[modIdx]'h.upper
@@ -867,10 +989,7 @@ def finalizeImport (s : ImportState) (imports : Array Import) (opts : Options) (
         if let some cinfoPrev := cinfoPrev? then
           -- Recall that the map has not been modified when `cinfoPrev? = some _`.
           unless equivInfo cinfoPrev cinfo do
-            throwAlreadyImported s const2ModIdx modIdx cname
-      const2ModIdx := const2ModIdx.insertIfNew cname modIdx |>.1
-    for cname in mod.extraConstNames do
-      const2ModIdx := const2ModIdx.insertIfNew cname modIdx |>.1
+            throwAlreadyImported s modIdx cname
   let constants : ConstMap := SMap.fromHashMap constantMap false
   let exts ← mkInitialExtensionStates
   let mut env : Environment := {
@@ -898,8 +1017,14 @@ def finalizeImport (s : ImportState) (imports : Array Import) (opts : Options) (
        initialized constant. We have seen significant savings in `open Mathlib`
        timings, where we have both a big environment and interpreted environment
        extensions, from this. There is no significant extra cost to calling
-       `markPersistent` multiple times like this. -/
-    env := Runtime.markPersistent env
+       `markPersistent` multiple times like this.
+       We mark the fields of `env` except for the `const2ModIdx` task, as marking the task would wait for it,
+       and thus prevent it from running in parallel with `finalizePersistentExtensions`. -/
+    env := { env with
+      constants       := Runtime.markPersistent env.constants
+      extensions      := Runtime.markPersistent env.extensions
+      extraConstNames := Runtime.markPersistent env.extraConstNames
+      header          := Runtime.markPersistent env.header }
   env ← finalizePersistentExtensions env s.moduleData opts
   if leakEnv then
     /- Ensure the final environment including environment extension states is
@@ -1031,8 +1156,8 @@ def displayStats (env : Environment) : IO Unit := do
   pExtDescrs.forM fun extDescr => do
     IO.println ("extension '" ++ toString extDescr.name ++ "'")
     let s := extDescr.toEnvExtension.getState env
-    let fmt := extDescr.statsFn s.state
-    unless fmt.isNil do IO.println ("  " ++ toString (Format.nest 2 (extDescr.statsFn s.state)))
+    let fmt := extDescr.statsFn s.getState
+    unless fmt.isNil do IO.println ("  " ++ toString (Format.nest 2 fmt))
     IO.println ("  number of imported entries: " ++ toString (s.importedEntries.foldl (fun sum es => sum + es.size) 0))
 
 /--
@@ -607,7 +607,52 @@ Export functions.
 
 end Expr
 
+namespace Expr
+
+/--
+Returns a node equal to `e` from the global hash-consing table if hash-consing is enabled
+(see `Expr.setHashConsing`), and otherwise `e` itself. The construction functions such as `mkApp` and
+`mkConst` apply it to each new node, so equal expressions built from hash-consed subterms are
+pointer-equal. Expressions built directly with the constructors (e.g., `.app f a`) are not hash-consed.
+-/
+@[extern "lean_expr_hash_cons"]
+opaque hashCons (e : Expr) : Expr
+
+/--
+Enables or disables hash-consing of the expressions created by `mkApp`, `mkConst`, and the other
+construction functions. Hash-consing saves memory and makes pointer-equality checks in caches succeed
+more often, but all hash-consed expressions are marked as multi-threaded, which makes reference
+counting more expensive. It should be set before elaboration starts, see option `hashConsExprs`.
+Threads that are already running may observe the change late.
+-/
+@[extern "lean_expr_set_hash_consing"]
+opaque setHashConsing (enabled : Bool) : BaseIO Unit
+
+/-- Returns `true` if hash-consing is enabled, see `Expr.setHashConsing`. -/
+@[extern "lean_expr_is_hash_consing"]
+opaque isHashConsing : BaseIO Bool
+
+/-- The number of nodes in the global hash-consing table, see `Expr.setHashConsing`. -/
+@[extern "lean_expr_hash_cons_table_size"]
+opaque hashConsTableSize : BaseIO Nat
+
+private def mkConstImpl (declName : Name) (us : List Level := []) : Expr := hashCons (.const declName us)
+private def mkBVarImpl (idx : Nat) : Expr := hashCons (.bvar idx)
+private def mkSortImpl (u : Level) : Expr := hashCons (.sort u)
+private def mkFVarImpl (fvarId : FVarId) : Expr := hashCons (.fvar fvarId)
+private def mkMVarImpl (mvarId : MVarId) : Expr := hashCons (.mvar mvarId)
+private def mkProjImpl (structName : Name) (idx : Nat) (struct : Expr) : Expr := hashCons (.proj structName idx struct)
+private def mkAppImpl (f a : Expr) : Expr := hashCons (.app f a)
+private def mkLambdaImpl (x : Name) (bi : BinderInfo) (t : Expr) (b : Expr) : Expr := hashCons (.lam x t b bi)
+private def mkForallImpl (x : Name) (bi : BinderInfo) (t : Expr) (b : Expr) : Expr := hashCons (.forallE x t b bi)
+private def mkLetImpl (x : Name) (t : Expr) (v : Expr) (b : Expr) (nonDep : Bool := false) : Expr :=
+  hashCons (.letE x t v b nonDep)
+private def mkLitImpl (l : Literal) : Expr := hashCons (.lit l)
+
+end Expr
+
 /-- `mkConst declName us` return `.const declName us`. -/
+@[implemented_by Expr.mkConstImpl]
 def mkConst (declName : Name) (us : List Level := []) : Expr :=
   .const declName us
 
@@ -620,10 +665,12 @@ def Literal.type : Literal → Expr
 def Literal.typeEx : Literal → Expr := Literal.type
 
 /-- `.bvar idx` is now the preferred form. -/
+@[implemented_by Expr.mkBVarImpl]
 def mkBVar (idx : Nat) : Expr :=
   .bvar idx
 
 /-- `.sort u` is now the preferred form. -/
+@[implemented_by Expr.mkSortImpl]
 def mkSort (u : Level) : Expr :=
   .sort u
 
@@ -632,6 +679,7 @@ def mkSort (u : Level) : Expr :=
 This function is seldom used, free variables are often automatically created using the
 telescope functions (e.g., `forallTelescope` and `lambdaTelescope`) at `MetaM`.
 -/
+@[implemented_by Expr.mkFVarImpl]
 def mkFVar (fvarId : FVarId) : Expr :=
   .fvar fvarId
 
@@ -640,6 +688,7 @@ def mkFVar (fvarId : FVarId) : Expr :=
 This function is seldom used, metavariables are often created using functions such
 as `mkFresheExprMVar` at `MetaM`.
 -/
+@[implemented_by Expr.mkMVarImpl]
 def mkMVar (mvarId : MVarId) : Expr :=
   .mvar mvarId
 
@@ -652,24 +701,27 @@ def mkMData (m : MData) (e : Expr) : Expr :=
 /--
 `.proj structName idx struct` is now the preferred form.
 -/
+@[implemented_by Expr.mkProjImpl]
 def mkProj (structName : Name) (idx : Nat) (struct : Expr) : Expr :=
   .proj structName idx struct
 
 /--
 `.app f a` is now the preferred form.
 -/
-@[match_pattern] def mkApp (f a : Expr) : Expr :=
+@[match_pattern, implemented_by Expr.mkAppImpl] def mkApp (f a : Expr) : Expr :=
   .app f a
 
 /--
 `.lam x t b bi` is now the preferred form.
 -/
+@[implemented_by Expr.mkLambdaImpl]
 def mkLambda (x : Name) (bi : BinderInfo) (t : Expr) (b : Expr) : Expr :=
   .lam x t b bi
 
 /--
 `.forallE x t b bi` is now the preferred form.
 -/
+@[implemented_by Expr.mkForallImpl]
 def mkForall (x : Name) (bi : BinderInfo) (t : Expr) (b : Expr) : Expr :=
   .forallE x t b bi
 
@@ -684,6 +736,7 @@ def mkSimpleThunk (type : Expr) : Expr :=
 /--
 `.letE x t v b nonDep` is now the preferred form.
 -/
+@[implemented_by Expr.mkLetImpl]
 def mkLet (x : Name) (t : Expr) (v : Expr) (b : Expr) (nonDep : Bool := false) : Expr :=
   .letE x t v b nonDep
 
@@ -701,6 +754,7 @@ def mkLet (x : Name) (t : Expr) (v : Expr) (b : Expr) (nonDep : Bool := false) :
 /--
 `.lit l` is now the preferred form.
 -/
+@[implemented_by Expr.mkLitImpl]
 def mkLit (l : Literal) : Expr :=
   .lit l
 
@@ -229,25 +229,69 @@ structure AbstractMVarsResult where
   expr       : Expr
   deriving Inhabited, BEq
 
-abbrev SynthInstanceCache := PersistentHashMap SynthInstanceCacheKey (Option AbstractMVarsResult)
+/--
+  A persistent hash map whose size can be bounded by evicting the entries that were not used recently.
+  Entries are kept in two generations: new entries are added to `young`, and when `young` is full
+  (see `GenerationalCache.insert`), the `old` generation is evicted and `young` becomes the new `old`.
+  Entries found in `old` are added to `young` again by `findCached?`, so entries that are still in use
+  survive evictions.
+-/
+structure GenerationalCache (α : Type) (β : Type) [BEq α] [Hashable α] where
+  young : PersistentHashMap α β := {}
+  old   : PersistentHashMap α β := {}
+  deriving Inhabited
+
+namespace GenerationalCache
+variable [BEq α] [Hashable α]
+
+/--
+  Returns `true` if inserting an entry into `c` evicts its old generation, i.e., if `young` already has
+  `maxSize` entries. `maxSize = 0` means that the generations are unbounded.
+-/
+@[inline] def willEvict (c : GenerationalCache α β) (maxSize : Nat) : Bool :=
+  maxSize != 0 && c.young.size ≥ maxSize
+
+/-- Inserts an entry into the young generation, first evicting the old generation if `c.willEvict maxSize`. -/
+@[inline] def insert (c : GenerationalCache α β) (k : α) (v : β) (maxSize : Nat) : GenerationalCache α β :=
+  if c.willEvict maxSize then
+    { young := PersistentHashMap.empty.insert k v, old := c.young }
+  else
+    { c with young := c.young.insert k v }
+
+/-- Number of entries in both generations (entries in both are counted twice). -/
+def size (c : GenerationalCache α β) : Nat :=
+  c.young.size + c.old.size
+
+end GenerationalCache
+
+abbrev SynthInstanceCache := GenerationalCache SynthInstanceCacheKey (Option AbstractMVarsResult)
 
-abbrev InferTypeCache := PersistentExprStructMap Expr
-abbrev FunInfoCache   := PersistentHashMap InfoCacheKey FunInfo
-abbrev WhnfCache      := PersistentExprStructMap Expr
+abbrev InferTypeCache := GenerationalCache ExprStructEq Expr
+abbrev FunInfoCache   := GenerationalCache InfoCacheKey FunInfo
+abbrev WhnfCache      := GenerationalCache ExprStructEq Expr
 
 /--
   A mapping `(s, t) ↦ isDefEq s t` per transparency level.
   TODO: consider more efficient representations (e.g., a proper set) and caching policies (e.g., imperfect cache).
   We should also investigate the impact on memory consumption. -/
 structure DefEqCache where
-  reducible : PersistentHashMap (Expr × Expr) Bool := {}
-  instances : PersistentHashMap (Expr × Expr) Bool := {}
-  default   : PersistentHashMap (Expr × Expr) Bool := {}
-  all       : PersistentHashMap (Expr × Expr) Bool := {}
+  reducible : GenerationalCache (Expr × Expr) Bool := {}
+  instances : GenerationalCache (Expr × Expr) Bool := {}
+  default   : GenerationalCache (Expr × Expr) Bool := {}
+  all       : GenerationalCache (Expr × Expr) Bool := {}
   deriving Inhabited
 
+/-- Returns the cache for transparency level `mode`. -/
+def DefEqCache.forMode (cache : DefEqCache) (mode : TransparencyMode) : GenerationalCache (Expr × Expr) Bool :=
+  match mode with
+  | .reducible => cache.reducible
+  | .instances => cache.instances
+  | .default   => cache.default
+  | .all       => cache.all
+
 /--
   Cache datastructures for type inference, type class resolution, whnf, and definitional equality.
+  Their size can be bounded using the option `maxCacheSize`.
 -/
 structure Cache where
   inferType      : InferTypeCache := {}
@@ -283,6 +327,13 @@ structure PostponedEntry where
   ctx? : Option DefEqContext
   deriving Inhabited
 
+/-- Lookups in and evictions from a `MetaM` cache. -/
+structure CacheCounters where
+  hits      : Nat := 0
+  misses    : Nat := 0
+  evictions : Nat := 0
+  deriving Inhabited
+
 structure Diagnostics where
   /-- Number of times each declaration has been unfolded -/
   unfoldCounter : PHashMap Name Nat := {}
@@ -292,6 +343,8 @@ structure Diagnostics where
   instanceCounter : PHashMap Name Nat := {}
   /-- Pending instances that were not synthesized because `maxSynthPendingDepth` has been reached. -/
   synthPendingFailures : PHashMap Expr MessageData := {}
+  /-- Lookups and evictions per cache, indexed by the name of the corresponding field of `Cache`. -/
+  cacheCounters : PHashMap Name CacheCounters := {}
   deriving Inhabited
 
 /--
@@ -315,6 +368,11 @@ structure SavedState where
   meta        : State
   deriving Nonempty
 
+register_builtin_option maxCacheSize : Nat := {
+  defValue := 0
+  descr    := "maximum number of entries of each cache of type inference, type class resolution, weak head normal form computation, and definitional equality checking. When a cache reaches the limit, the entries that have not been used since the cache last reached half of it are evicted. Use `set_option diagnostics true` to report the number of hits, misses and evictions of each cache. 0 means no limit"
+}
+
 register_builtin_option maxSynthPendingDepth : Nat := {
   defValue := 1
   descr    := "maximum number of nested `synthPending` invocations. When resolving unification constraints, pending type class problems may need to be synthesized. These type class problems may create new unification constraints that again require solving new type class problems. This option puts a threshold on how many nested problems are created."
@@ -496,21 +554,21 @@ variable [MonadControlT MetaM n] [Monad n]
 
 /-- If diagnostics are enabled, record that `declName` has been unfolded. -/
 def recordUnfold (declName : Name) : MetaM Unit := do
-  modifyDiag fun { unfoldCounter, heuristicCounter, instanceCounter, synthPendingFailures } =>
+  modifyDiag fun { unfoldCounter, heuristicCounter, instanceCounter, synthPendingFailures, cacheCounters } =>
     let newC := if let some c := unfoldCounter.find? declName then c + 1 else 1
-    { unfoldCounter := unfoldCounter.insert declName newC, heuristicCounter, instanceCounter, synthPendingFailures }
+    { unfoldCounter := unfoldCounter.insert declName newC, heuristicCounter, instanceCounter, synthPendingFailures, cacheCounters }
 
 /-- If diagnostics are enabled, record that heuristic for solving `f a =?= f b` has been used. -/
 def recordDefEqHeuristic (declName : Name) : MetaM Unit := do
-  modifyDiag fun { unfoldCounter, heuristicCounter, instanceCounter, synthPendingFailures } =>
+  modifyDiag fun { unfoldCounter, heuristicCounter, instanceCounter, synthPendingFailures, cacheCounters } =>
     let newC := if let some c := heuristicCounter.find? declName then c + 1 else 1
-    { unfoldCounter, heuristicCounter := heuristicCounter.insert declName newC, instanceCounter, synthPendingFailures }
+    { unfoldCounter, heuristicCounter := heuristicCounter.insert declName newC, instanceCounter, synthPendingFailures, cacheCounters }
 
 /-- If diagnostics are enabled, record that instance `declName` was used during TC resolution. -/
 def recordInstance (declName : Name) : MetaM Unit := do
-  modifyDiag fun { unfoldCounter, heuristicCounter, instanceCounter, synthPendingFailures } =>
+  modifyDiag fun { unfoldCounter, heuristicCounter, instanceCounter, synthPendingFailures, cacheCounters } =>
     let newC := if let some c := instanceCounter.find? declName then c + 1 else 1
-    { unfoldCounter, heuristicCounter, instanceCounter := instanceCounter.insert declName newC, synthPendingFailures }
+    { unfoldCounter, heuristicCounter, instanceCounter := instanceCounter.insert declName newC, synthPendingFailures, cacheCounters }
 
 /-- If diagnostics are enabled, record that synth pending failures. -/
 def recordSynthPendingFailure (type : Expr) : MetaM Unit := do
@@ -518,8 +576,41 @@ def recordSynthPendingFailure (type : Expr) : MetaM Unit := do
     unless (← get).diag.synthPendingFailures.contains type do
       -- We need to save the full context since type class resolution uses multiple metavar contexts and different local contexts
       let msg ← addMessageContextFull m!"{type}"
-      modifyDiag fun { unfoldCounter, heuristicCounter, instanceCounter, synthPendingFailures } =>
-        { unfoldCounter, heuristicCounter, instanceCounter, synthPendingFailures := synthPendingFailures.insert type msg }
+      modifyDiag fun { unfoldCounter, heuristicCounter, instanceCounter, synthPendingFailures, cacheCounters } =>
+        { unfoldCounter, heuristicCounter, instanceCounter, synthPendingFailures := synthPendingFailures.insert type msg, cacheCounters }
+
+/-- If diagnostics are enabled, record a lookup in or an eviction from the cache `cache` (see `findCached?`). -/
+def recordCacheEvent (cache : Name) (f : CacheCounters → CacheCounters) : MetaM Unit := do
+  modifyDiag fun { unfoldCounter, heuristicCounter, instanceCounter, synthPendingFailures, cacheCounters } =>
+    let c := f (cacheCounters.findD cache {})
+    { unfoldCounter, heuristicCounter, instanceCounter, synthPendingFailures, cacheCounters := cacheCounters.insert cache c }
+
+/--
+  Looks up `k` in the cache `c` named `cache`. If `k` is found in the old generation of `c`, `promote`
+  is used to add it to the young generation again. See `GenerationalCache`.
+-/
+@[inline] def findCached? [BEq α] [Hashable α] (cache : Name) (c : GenerationalCache α β) (k : α)
+    (promote : β → MetaM Unit) : MetaM (Option β) := do
+  if let some v := c.young.find? k then
+    recordCacheEvent cache fun n => { n with hits := n.hits + 1 }
+    return some v
+  if let some v := c.old.find? k then
+    recordCacheEvent cache fun n => { n with hits := n.hits + 1 }
+    promote v
+    return some v
+  recordCacheEvent cache fun n => { n with misses := n.misses + 1 }
+  return none
+
+/--
+  Returns the maximum size of a generation of the cache `c` named `cache` for `GenerationalCache.insert`,
+  and records an eviction if the insertion will evict.
+-/
+def getCacheGenerationSize [BEq α] [Hashable α] (cache : Name) (c : GenerationalCache α β) : MetaM Nat := do
+  let maxSize := maxCacheSize.get (← getOptions)
+  let maxSize := if maxSize == 0 then 0 else max 1 (maxSize / 2)
+  if c.willEvict maxSize then
+    recordCacheEvent cache fun n => { n with evictions := n.evictions + 1 }
+  return maxSize
 
 def getLocalInstances : MetaM LocalInstances :=
   return (← read).localInstances
@@ -196,6 +196,13 @@ def check (e : Expr) : MetaM Unit :=
       trace[Meta.check] ex.toMessageData
       throw ex
 
+/--
+Like `check`, but uses the current transparency setting instead of `TransparencyMode.all`.
+Thus, `e` is rejected if it is only type correct after unfolding definitions that cannot be unfolded at this setting.
+-/
+def checkWithCurrentTransparency (e : Expr) : MetaM Unit :=
+  checkAux e
+
 /--
 Return true if `e` is type correct.
 -/
@@ -69,6 +69,21 @@ def mkDiagSynthPendingFailure (failures : PHashMap Expr MessageData) : MetaM Dia
       data := data.push m!"{if data.isEmpty then "  " else "\n"}{msg}"
     return { data }
 
+/--
+Summarizes the lookups in and evictions from the `MetaM` caches (see `Cache`). They are only reported
+if the size of the caches is bounded using `maxCacheSize`.
+-/
+def mkDiagCacheSummary : MetaM DiagSummary := do
+  if maxCacheSize.get (← getOptions) == 0 then
+    return {}
+  let mut entries := #[]
+  for (cache, counters) in (← get).diag.cacheCounters do
+    entries := entries.push (cache, counters)
+  let mut data := #[]
+  for (cache, c) in entries.qsort (Name.lt ·.1 ·.1) do
+    data := data.push m!"{if data.isEmpty then "  " else "\n"}{cache} ↦ {c.hits} hits, {c.misses} misses, {c.evictions} evictions"
+  return { data }
+
 /--
 We use below that this returns `m` unchanged if `s.isEmpty`
 -/
@@ -89,6 +104,7 @@ def reportDiag : MetaM Unit := do
     let inst ← mkDiagSummaryForUsedInstances
     let synthPending ← mkDiagSynthPendingFailure (← get).diag.synthPendingFailures
     let unfoldKernel ← mkDiagSummary (Kernel.getDiagnostics (← getEnv)).unfoldCounter
+    let cache ← mkDiagCacheSummary
     let m := MessageData.nil
     let m := appendSection m `reduction "unfolded declarations" unfoldDefault
     let m := appendSection m `reduction "unfolded instances" unfoldInstance
@@ -99,6 +115,7 @@ def reportDiag : MetaM Unit := do
               synthPending (resultSummary := false)
     let m := appendSection m `def_eq "heuristic for solving `f a =?= f b`" heu
     let m := appendSection m `kernel "unfolded declarations" unfoldKernel
+    let m := appendSection m `cache s!"cache lookups (maxCacheSize: {maxCacheSize.get (← getOptions)})" cache (resultSummary := false)
     unless m matches .nil do
       let m := m ++ "use `set_option diagnostics.threshold <num>` to control threshold for reporting counters"
       logInfo m
@@ -496,6 +496,47 @@ def insertCore [BEq α] (d : DiscrTree α) (keys : Array Key) (v : α) : DiscrTr
       let c := insertAux keys v 1 c
       { root := d.root.insert k c }
 
+/--
+Merges the tries `t₁` and `t₂`. The result is the same as inserting the values of `t₂`, in order,
+into `t₁` using `insertCore`.
+-/
+partial def Trie.merge [BEq α] : Trie α → Trie α → Trie α
+  | .node vs₁ cs₁, .node vs₂ cs₂ =>
+    let vs := if vs₁.isEmpty then vs₂ else vs₂.foldl (init := vs₁) insertVal
+    .node vs (mergeChildren cs₁ cs₂)
+where
+  mergeChildren (cs₁ cs₂ : Array (Key × Trie α)) : Array (Key × Trie α) := Id.run do
+    if cs₁.isEmpty then return cs₂
+    if cs₂.isEmpty then return cs₁
+    let mut cs := Array.mkEmpty (cs₁.size + cs₂.size)
+    let mut i := 0
+    let mut j := 0
+    while i < cs₁.size && j < cs₂.size do
+      let (k₁, t₁) := cs₁[i]!
+      let (k₂, t₂) := cs₂[j]!
+      if k₁ < k₂ then
+        cs := cs.push (k₁, t₁)
+        i := i + 1
+      else if k₂ < k₁ then
+        cs := cs.push (k₂, t₂)
+        j := j + 1
+      else
+        cs := cs.push (k₁, Trie.merge t₁ t₂)
+        i := i + 1
+        j := j + 1
+    return cs ++ cs₁.extract i cs₁.size ++ cs₂.extract j cs₂.size
+
+/--
+Merges the discrimination trees `d₁` and `d₂`. The result is the same as inserting the entries of `d₂`
+into `d₁`, but avoids recomputing the paths of shared prefixes, which makes it cheaper to combine
+trees built in parallel.
+-/
+def merge [BEq α] (d₁ d₂ : DiscrTree α) : DiscrTree α :=
+  { root := d₂.root.foldl (init := d₁.root) fun root k t₂ =>
+      match root.find? k with
+      | some t₁ => root.insert k (t₁.merge t₂)
+      | none    => root.insert k t₂ }
+
 def insert [BEq α] (d : DiscrTree α) (e : Expr) (v : α) (config : WhnfCoreConfig) (noIndexAtArgs := false) : MetaM (DiscrTree α) := do
   let keys ← mkPath e config noIndexAtArgs
   return d.insertCore keys v
@@ -2076,31 +2076,38 @@ private def mkCacheKey (t s : Expr) : MetaM DefEqCacheKeyInfo := do
   let key := if Expr.quickLt t s then (t, s) else (s, t)
   return { key, kind }
 
+def DefEqCache.update (cache : DefEqCache) (mode : TransparencyMode) (key : Expr × Expr) (result : Bool)
+    (maxSize : Nat) : DefEqCache :=
+  match mode with
+  | .reducible => { cache with reducible := cache.reducible.insert key result maxSize }
+  | .instances => { cache with instances := cache.instances.insert key result maxSize }
+  | .default   => { cache with default   := cache.default.insert key result maxSize }
+  | .all       => { cache with all       := cache.all.insert key result maxSize }
+
+private def insertDefEqCache (kind : DefEqCacheKind) (mode : TransparencyMode) (key : Expr × Expr) (result : Bool) :
+    MetaM Unit := do
+  match kind with
+  | .permanent =>
+    let maxSize ← getCacheGenerationSize `defEqPerm ((← get).cache.defEqPerm.forMode mode)
+    modifyDefEqPermCache fun c => c.update mode key result maxSize
+  | .transient =>
+    let maxSize ← getCacheGenerationSize `defEqTrans ((← get).cache.defEqTrans.forMode mode)
+    modifyDefEqTransientCache fun c => c.update mode key result maxSize
+
 private def getCachedResult (keyInfo : DefEqCacheKeyInfo) : MetaM LBool := do
-  let cache ← match keyInfo.kind with
-    | .transient => pure (← get).cache.defEqTrans
-    | .permanent => pure (← get).cache.defEqPerm
-  let cache := match (← getTransparency) with
-    | .reducible => cache.reducible
-    | .instances => cache.instances
-    | .default   => cache.default
-    | .all       => cache.all
-  match cache.find? keyInfo.key with
+  let (name, cache) ← match keyInfo.kind with
+    | .transient => pure (`defEqTrans, (← get).cache.defEqTrans)
+    | .permanent => pure (`defEqPerm, (← get).cache.defEqPerm)
+  let mode ← getTransparency
+  match (← findCached? name (cache.forMode mode) keyInfo.key (insertDefEqCache keyInfo.kind mode keyInfo.key)) with
   | some val => return val.toLBool
   | none => return .undef
 
-def DefEqCache.update (cache : DefEqCache) (mode : TransparencyMode) (key : Expr × Expr) (result : Bool) : DefEqCache :=
-  match mode with
-  | .reducible => { cache with reducible := cache.reducible.insert key result }
-  | .instances => { cache with instances := cache.instances.insert key result }
-  | .default   => { cache with default   := cache.default.insert key result }
-  | .all       => { cache with all       := cache.all.insert key result }
-
 private def cacheResult (keyInfo : DefEqCacheKeyInfo) (result : Bool) : MetaM Unit := do
   let mode ← getTransparency
   let key := keyInfo.key
   match keyInfo.kind with
-  | .permanent => modifyDefEqPermCache fun c => c.update mode key result
+  | .permanent => insertDefEqCache .permanent mode key result
   | .transient =>
     /-
     We must ensure that all assigned metavariables in the key are replaced by their current assignments.
@@ -2108,7 +2115,7 @@ private def cacheResult (keyInfo : DefEqCacheKeyInfo) (result : Bool) : MetaM Un
     See issue #1870 for an example.
     -/
     let key := (← instantiateMVars key.1, ← instantiateMVars key.2)
-    modifyDefEqTransientCache fun c => c.update mode key result
+    insertDefEqCache .transient mode key result
 
 private def whnfCoreAtDefEq (e : Expr) : MetaM Expr := do
   if backward.isDefEq.lazyWhnfCore.get (← getOptions) then
@@ -9,13 +9,18 @@ import Lean.Meta.InferType
 
 namespace Lean.Meta
 
+private def cacheFunInfo (key : InfoCacheKey) (finfo : FunInfo) : MetaM Unit := do
+  let maxSize ← getCacheGenerationSize `funInfo (← get).cache.funInfo
+  modify fun s => { s with cache := { s.cache with funInfo := s.cache.funInfo.insert key finfo maxSize } }
+
 @[inline] private def checkFunInfoCache (fn : Expr) (maxArgs? : Option Nat) (k : MetaM FunInfo) : MetaM FunInfo := do
   let t ← getTransparency
-  match (← get).cache.funInfo.find? ⟨t, fn, maxArgs?⟩ with
+  let key : InfoCacheKey := ⟨t, fn, maxArgs?⟩
+  match (← findCached? `funInfo (← get).cache.funInfo key (cacheFunInfo key)) with
   | some finfo => pure finfo
   | none       => do
     let finfo ← k
-    modify fun s => { s with cache := { s.cache with funInfo := s.cache.funInfo.insert ⟨t, fn, maxArgs?⟩ finfo } }
+    cacheFunInfo key finfo
     pure finfo
 
 @[inline] private def whenHasVar {α} (e : Expr) (deps : α) (k : α → α) : α :=
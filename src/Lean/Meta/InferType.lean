@@ -165,13 +165,17 @@ private def inferFVarType (fvarId : FVarId) : MetaM Expr := do
   | some d => return d.type
   | none   => fvarId.throwUnknown
 
+private def cacheInferType (e type : Expr) : MetaM Unit := do
+  let maxSize ← getCacheGenerationSize `inferType (← get).cache.inferType
+  modifyInferTypeCache fun c => c.insert e type maxSize
+
 @[inline] private def checkInferTypeCache (e : Expr) (inferType : MetaM Expr) : MetaM Expr := do
-  match (← get).cache.inferType.find? e with
+  match (← findCached? `inferType (← get).cache.inferType e (cacheInferType e)) with
   | some type => return type
   | none =>
     let type ← inferType
     unless e.hasMVar || type.hasMVar do
-      modifyInferTypeCache fun c => c.insert e type
+      cacheInferType e type
     return type
 
 @[export lean_infer_type]
@@ -70,18 +70,43 @@ structure Instances where
   discrTree     : InstanceTree := DiscrTree.empty
   instanceNames : PHashMap Name InstanceEntry := {}
   erased        : PHashSet Name := {}
+  /--
+  Fingerprint of the instances, the sum of the `InstanceEntry.fingerprint`s of the entries added minus
+  those of the entries erased. It does not depend on the order in which instances were added, and is used
+  to key results of type class resolution that are shared between environments (see `synthInstance?`).
+  -/
+  fingerprint   : UInt64 := 0
   deriving Inhabited
 
+/-- Hash of the instance and its priority, see `Instances.fingerprint`. -/
+def InstanceEntry.fingerprint (e : InstanceEntry) : UInt64 :=
+  match e.globalName? with
+  | some n => mixHash (hash n) (hash e.priority)
+  | none   => mixHash (hash e.val) (hash e.priority)
+
 /-- Configuration for the discrimination tree module -/
 def tcDtConfig : WhnfCoreConfig := {}
 
 def addInstanceEntry (d : Instances) (e : InstanceEntry) : Instances :=
   match e.globalName? with
-  | some n => { d with discrTree := d.discrTree.insertCore e.keys e, instanceNames := d.instanceNames.insert n e, erased := d.erased.erase n }
-  | none   => { d with discrTree := d.discrTree.insertCore e.keys e }
+  | some n => { d with discrTree := d.discrTree.insertCore e.keys e, instanceNames := d.instanceNames.insert n e, erased := d.erased.erase n, fingerprint := d.fingerprint + e.fingerprint }
+  | none   => { d with discrTree := d.discrTree.insertCore e.keys e, fingerprint := d.fingerprint + e.fingerprint }
 
 def Instances.eraseCore (d : Instances) (declName : Name) : Instances :=
-  { d with erased := d.erased.insert declName, instanceNames := d.instanceNames.erase declName }
+  let fingerprint := match d.instanceNames.find? declName with
+    | some e => d.fingerprint - e.fingerprint
+    | none   => d.fingerprint
+  { d with erased := d.erased.insert declName, instanceNames := d.instanceNames.erase declName, fingerprint }
+
+/--
+Combines instances imported from different modules: the result is the same as adding the instances
+added to `d₂` to `d₁` (see `SimpleScopedEnvExtension.Descr.mergeImported?`).
+-/
+def Instances.merge (d₁ d₂ : Instances) : Instances :=
+  let (instanceNames, erased) := d₂.instanceNames.foldl (init := (d₁.instanceNames, d₁.erased))
+    fun (names, erased) n e => (names.insert n e, erased.erase n)
+  { discrTree := d₁.discrTree.merge d₂.discrTree, instanceNames, erased
+    fingerprint := d₁.fingerprint + d₂.fingerprint }
 
 def Instances.erase [Monad m] [MonadError m] (d : Instances) (declName : Name) : m Instances := do
   unless d.instanceNames.contains declName do
@@ -90,8 +115,10 @@ def Instances.erase [Monad m] [MonadError m] (d : Instances) (declName : Name) :
 
 builtin_initialize instanceExtension : SimpleScopedEnvExtension InstanceEntry Instances ←
   registerSimpleScopedEnvExtension {
-    initial  := {}
-    addEntry := addInstanceEntry
+    initial    := {}
+    addEntry   := addInstanceEntry
+    importMode := .async
+    mergeImported? := Instances.merge
   }
 
 private def mkInstanceKey (e : Expr) : MetaM (Array InstanceKey) := do
@@ -255,6 +282,7 @@ builtin_initialize defaultInstanceExtension : SimplePersistentEnvExtension Defau
   registerSimplePersistentEnvExtension {
     addEntryFn    := addDefaultInstanceEntry
     addImportedFn := fun es => (mkStateFromImportedEntries addDefaultInstanceEntry {} es)
+    importMode    := .async
   }
 
 def addDefaultInstance (declName : Name) (prio : Nat := 0) : MetaM Unit := do
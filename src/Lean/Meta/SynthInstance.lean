@@ -25,6 +25,16 @@ register_builtin_option synthInstance.maxSize : Nat := {
   descr := "maximum number of instances used to construct a solution in the type class instance synthesis procedure"
 }
 
+register_builtin_option synthInstance.sharedCache : Bool := {
+  defValue := true
+  descr := "share the solutions of type class problems without local instances, free variables, and metavariables between commands (and between files elaborated by the same process)"
+}
+
+register_builtin_option synthInstance.sharedCacheSize : Nat := {
+  defValue := 8192
+  descr := "maximum number of entries in each of the two generations of the shared type class resolution cache (see `synthInstance.sharedCache`), 0 means no limit"
+}
+
 register_builtin_option backward.synthInstance.canonInstances : Bool := {
   defValue := true
   group    := "backward compatibility"
@@ -762,18 +772,112 @@ private def applyCachedAbstractResult? (type : Expr) (abstResult? : Option Abstr
   else
     applyAbstractResult? type abstResult?
 
+private def insertSynthInstanceCache (cacheKey : SynthInstanceCacheKey) (abstResult? : Option AbstractMVarsResult) : MetaM Unit := do
+  let maxSize ← getCacheGenerationSize `synthInstance (← get).cache.synthInstance
+  modify fun s => { s with cache.synthInstance := s.cache.synthInstance.insert cacheKey abstResult? maxSize }
+
 /-- Helper function for caching synthesized type class instances. -/
 private def cacheResult (cacheKey : SynthInstanceCacheKey) (abstResult? : Option AbstractMVarsResult) (result? : Option Expr) : MetaM Unit := do
   match result? with
-  | none => modify fun s => { s with cache.synthInstance := s.cache.synthInstance.insert cacheKey none }
+  | none => insertSynthInstanceCache cacheKey none
   | some result =>
     let some abstResult := abstResult? | return ()
     if abstResult.numMVars == 0 && abstResult.paramNames.isEmpty then
       -- See `applyCachedAbstractResult?` If new metavariables have **not** been introduced,
       -- we don't need to perform extra checks again when reusing result.
-      modify fun s => { s with cache.synthInstance := s.cache.synthInstance.insert cacheKey (some { expr := result, paramNames := #[], numMVars := 0 }) }
+      insertSynthInstanceCache cacheKey (some { expr := result, paramNames := #[], numMVars := 0 })
     else
-      modify fun s => { s with cache.synthInstance := s.cache.synthInstance.insert cacheKey (some abstResult) }
+      insertSynthInstanceCache cacheKey (some abstResult)
+
+/--
+Key of the shared type class resolution cache: a closed type class problem, the `Instances.fingerprint`
+and the reducibility fingerprint (see `getReducibilityFingerprint`) of the environment it was solved in,
+the set of modules imported by the environment, the `synthPendingDepth` of the problem, and the options
+affecting the solutions.
+-/
+structure SharedSynthInstanceCacheKey where
+  type              : Expr
+  fingerprint       : UInt64
+  reducibility      : UInt64
+  imports           : UInt64
+  synthPendingDepth : Nat
+  options           : UInt64
+  deriving BEq, Hashable
+
+/--
+Solutions of closed type class problems, shared by all `MetaM` runs of the process. Unlike
+`Cache.synthInstance`, this cache survives the end of a command, and is used by all threads
+elaborating commands (and by all files elaborated by a `lean --build-worker`).
+Adding or erasing an instance, or changing a reducibility status (e.g., `attribute [local irreducible]`),
+changes the fingerprints in the keys, so stale entries are never found, and eventually evicted.
+Only successes are cached.
+Solutions also depend on the declarations of the current file, which are not part of the key. Thus, a
+solution found in the cache is type checked again at `instances` transparency before it is used, see
+`isValidSharedResult`.
+-/
+private builtin_initialize sharedSynthInstanceCacheRef : IO.Ref (GenerationalCache SharedSynthInstanceCacheKey Expr) ←
+  IO.mkRef {}
+
+/-- Hash of the modules imported by the environment, used in `SharedSynthInstanceCacheKey`. -/
+private builtin_initialize importsHashExt : PersistentEnvExtension Unit Unit UInt64 ←
+  registerPersistentEnvExtension {
+    mkInitial       := pure 0
+    addImportedFn   := fun _ => return hash (← read).env.header.moduleNames
+    addEntryFn      := fun s _ => s
+    exportEntriesFn := fun _ => #[]
+  }
+
+/--
+Returns the key of `type` in the shared cache if the problem can use it. The problem must be closed,
+and the solution must not depend on the local context. We also bypass the cache when it would hide the
+search from traces and diagnostics.
+-/
+private def getSharedCacheKey? (localInsts : LocalInstances) (type : Expr) (maxResultSize? : Option Nat) :
+    MetaM (Option SharedSynthInstanceCacheKey) := do
+  let opts ← getOptions
+  unless synthInstance.sharedCache.get opts do return none
+  if !localInsts.isEmpty || type.hasFVar || type.hasMVar || maxResultSize?.isSome || (← read).canUnfold?.isSome then
+    return none
+  if (← isDiagnosticsEnabled) || (← isTracingEnabledFor `Meta.synthInstance) then
+    return none
+  let env ← getEnv
+  return some {
+    type
+    fingerprint       := (instanceExtension.getState env).fingerprint
+    reducibility      := getReducibilityFingerprint env
+    imports           := importsHashExt.getState env
+    synthPendingDepth := (← read).synthPendingDepth
+    options           := mixHash (hash (synthInstance.maxSize.get opts)) <|
+      mixHash (hash (maxSynthPendingDepth.get opts)) (hash (backward.synthInstance.canonInstances.get opts))
+  }
+
+/--
+Returns `true` if the solution `result` of `type` found in the shared cache is type correct at the current
+(i.e., `instances`) transparency setting. It may not be, if it was found in a different file.
+The time spent here is reported by the profiler in its own category, so that it can be compared with the
+`typeclass inference` time it saves.
+-/
+private def isValidSharedResult (type result : Expr) : MetaM Bool := do
+  profileitM Exception "typeclass inference (shared cache check)" (← getOptions) do
+  try
+    checkWithCurrentTransparency result
+    isDefEq (← inferType result) type
+  catch _ =>
+    return false
+
+private def findSharedCache? (key : SharedSynthInstanceCacheKey) : MetaM (Option Expr) := do
+  let c ← sharedSynthInstanceCacheRef.get
+  if let some result := c.young.find? key then
+    return some result
+  let some result := c.old.find? key | return none
+  let maxSize := synthInstance.sharedCacheSize.get (← getOptions)
+  sharedSynthInstanceCacheRef.modify (·.insert key result maxSize)
+  return some result
+
+private def insertSharedCache (key : SharedSynthInstanceCacheKey) (result : Expr) : MetaM Unit := do
+  unless result.hasFVar || result.hasMVar do
+    let maxSize := synthInstance.sharedCacheSize.get (← getOptions)
+    sharedSynthInstanceCacheRef.modify (·.insert key result maxSize)
 
 def synthInstance? (type : Expr) (maxResultSize? : Option Nat := none) : MetaM (Option Expr) := do profileitM Exception "typeclass inference" (← getOptions) (decl := type.getAppFn.constName?.getD .anonymous) do
   let opts ← getOptions
@@ -787,18 +891,30 @@ def synthInstance? (type : Expr) (maxResultSize? : Option Nat := none) : MetaM (
     let type ← instantiateMVars type
     let type ← preprocess type
     let cacheKey := { localInsts, type, synthPendingDepth := (← read).synthPendingDepth }
-    match (← get).cache.synthInstance.find? cacheKey with
+    match (← findCached? `synthInstance (← get).cache.synthInstance cacheKey (insertSynthInstanceCache cacheKey)) with
     | some abstResult? =>
       let result? ← applyCachedAbstractResult? type abstResult?
       trace[Meta.synthInstance] "result {result?} (cached)"
       return result?
     | none =>
+      let sharedKey? ← getSharedCacheKey? localInsts type maxResultSize?
+      if let some sharedKey := sharedKey? then
+        if let some result ← findSharedCache? sharedKey then
+          if (← isValidSharedResult type result) then
+            let abstResult := { expr := result, paramNames := #[], numMVars := 0 }
+            let result? ← applyCachedAbstractResult? type (some abstResult)
+            if result?.isSome then
+              insertSynthInstanceCache cacheKey (some abstResult)
+              return result?
       let abstResult? ← withNewMCtxDepth (allowLevelAssignments := true) do
         let normType ← preprocessOutParam type
         SynthInstance.main normType maxResultSize
       let result? ← applyAbstractResult? type abstResult?
       trace[Meta.synthInstance] "result {result?}"
       cacheResult cacheKey abstResult? result?
+      if let (some sharedKey, some result, some abstResult) := (sharedKey?, result?, abstResult?) then
+        if abstResult.numMVars == 0 && abstResult.paramNames.isEmpty then
+          insertSharedCache sharedKey result
       return result?
 
 /--
@@ -260,6 +260,25 @@ def SimpTheorems.isLemma (d : SimpTheorems) (thmId : Origin) : Bool :=
 def SimpTheorems.registerDeclToUnfoldThms (d : SimpTheorems) (declName : Name) (eqThms : Array Name) : SimpTheorems :=
   { d with toUnfoldThms := d.toUnfoldThms.insert declName eqThms }
 
+/--
+Combines simp theorems imported from different modules: the result is the same as adding the entries
+added to `d₂` to `d₁` (see `SimpleScopedEnvExtension.Descr.mergeImported?`).
+Adding a backward theorem `← thm` erases the forward theorem `thm` (see `eraseFwdIfBwd`), so the
+backward theorems of `d₂` are first applied as erasures to `d₁`. Backward theorems are never erased by
+other entries, so they are exactly the `.decl _ _ true` origins in `d₂.lemmaNames`.
+-/
+def SimpTheorems.merge (d₁ d₂ : SimpTheorems) : SimpTheorems :=
+  let d₁ := d₂.lemmaNames.fold (init := d₁) fun d thmId =>
+    match thmId with
+    | .decl declName post true => eraseIfExists d (.decl declName post false)
+    | _ => d
+  { pre          := d₁.pre.merge d₂.pre
+    post         := d₁.post.merge d₂.post
+    lemmaNames   := d₂.lemmaNames.fold (init := d₁.lemmaNames) (·.insert ·)
+    toUnfold     := d₂.toUnfold.fold (init := d₁.toUnfold) (·.insert ·)
+    erased       := d₂.erased.fold (init := d₁.erased) (·.insert ·)
+    toUnfoldThms := d₂.toUnfoldThms.foldl (init := d₁.toUnfoldThms) (·.insert · ·) }
+
 def SimpTheorems.erase [Monad m] [MonadLog m] [AddMessageContext m] [MonadOptions m]
     (d : SimpTheorems) (thmId : Origin) : m SimpTheorems := do
   unless d.isLemma thmId ||
@@ -418,6 +437,8 @@ def mkSimpExt (name : Name := by exact decl_name%) : IO SimpExtension :=
       | .thm e => addSimpTheoremEntry d e
       | .toUnfold n => d.addDeclToUnfoldCore n
       | .toUnfoldThms n thms => d.registerDeclToUnfoldThms n thms
+    importMode := .async
+    mergeImported? := SimpTheorems.merge
   }
 
 abbrev SimpExtensionMap := HashMap Name SimpExtension
@@ -937,22 +937,26 @@ def reduceNat? (e : Expr) : MetaM (Option Expr) :=
     | .all     => return true
     | _        => return false
 
-@[inline] private def cached? (useCache : Bool) (e : Expr) : MetaM (Option Expr) := do
+private def cache (useCache : Bool) (e r : Expr) : MetaM Expr := do
   if useCache then
     match (← getConfig).transparency with
-    | .default => return (← get).cache.whnfDefault.find? e
-    | .all     => return (← get).cache.whnfAll.find? e
+    | .default =>
+      let maxSize ← getCacheGenerationSize `whnfDefault (← get).cache.whnfDefault
+      modify fun s => { s with cache.whnfDefault := s.cache.whnfDefault.insert e r maxSize }
+    | .all     =>
+      let maxSize ← getCacheGenerationSize `whnfAll (← get).cache.whnfAll
+      modify fun s => { s with cache.whnfAll     := s.cache.whnfAll.insert e r maxSize }
     | _        => unreachable!
-  else
-    return none
+  return r
 
-private def cache (useCache : Bool) (e r : Expr) : MetaM Expr := do
+@[inline] private def cached? (useCache : Bool) (e : Expr) : MetaM (Option Expr) := do
   if useCache then
     match (← getConfig).transparency with
-    | .default => modify fun s => { s with cache.whnfDefault := s.cache.whnfDefault.insert e r }
-    | .all     => modify fun s => { s with cache.whnfAll     := s.cache.whnfAll.insert e r }
+    | .default => findCached? `whnfDefault (← get).cache.whnfDefault e (discard <| cache true e ·)
+    | .all     => findCached? `whnfAll (← get).cache.whnfAll e (discard <| cache true e ·)
     | _        => unreachable!
-  return r
+  else
+    return none
 
 @[export lean_whnf]
 partial def whnfImp (e : Expr) : MetaM Expr :=
@@ -335,6 +335,11 @@ structure MetavarContext where
   /-- Assignment table for delayed abstraction metavariables.
   For more information about delayed abstraction, see the docstring for `DelayedMetavarAssignment`. -/
   dAssignment    : PersistentHashMap MVarId DelayedMetavarAssignment := {}
+  /--
+  Results of `instantiateMVars` that do not contain metavariables, by input. Assignments are never
+  removed from a `MetavarContext` (backtracking restores an older context, including this cache),
+  so these results remain valid. See `instantiateMVars`. -/
+  instantiated   : PersistentExprStructMap Expr := {}
 
 instance : Inhabited MetavarContext := ⟨{}⟩
 
@@ -643,6 +648,9 @@ def instantiateMVarsCore (mctx : MetavarContext) (e : Expr) : Expr × MetavarCon
     instantiateExprMVars e
   runST fun _ => instantiate e |>.run |>.run mctx
 
+/-- Maximum number of entries in `MetavarContext.instantiated`. The cache is cleared when it is full. -/
+def instantiatedCacheMaxSize : Nat := 4096
+
 /-
 Substitutes assigned metavariables in `e` with their assigned value according to the
 `MetavarContext`, recursively.
@@ -663,8 +671,15 @@ def instantiateMVars [Monad m] [MonadMCtx m] (e : Expr) : m Expr := do
   if !e.hasMVar then
     return e
   else
-    let (r, mctx) := instantiateMVarsCore (← getMCtx) e
-    modifyMCtx fun _ => mctx
+    let mctx ← getMCtx
+    if let some r := mctx.instantiated.find? { val := e } then
+      return r
+    let (r, mctx) := instantiateMVarsCore mctx e
+    if r.hasMVar then
+      modifyMCtx fun _ => mctx
+    else
+      let instantiated := if mctx.instantiated.size ≥ instantiatedCacheMaxSize then {} else mctx.instantiated
+      modifyMCtx fun _ => { mctx with instantiated := instantiated.insert { val := e } r }
     return r
 
 def instantiateLCtxMVars [Monad m] [MonadMCtx m] (lctx : LocalContext) : m LocalContext :=
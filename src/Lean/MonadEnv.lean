@@ -128,10 +128,19 @@ def getConstInfoRec [Monad m] [MonadEnv m] [MonadError m] (constName : Name) : m
         | _ => failK ()
       | _ => failK ()
 
+/-- Compile the declarations whose code generation has been postponed by `compiler.parallel`. -/
+def compilePendingDecls [Monad m] [MonadEnv m] [MonadError m] : m Unit := do
+  match (← getEnv).compilePendingDecls with
+  | .ok env => setEnv env
+  | .error (.other msg) => throwError msg
+  | .error ex => throwKernelException ex
+
 unsafe def evalConst [Monad m] [MonadEnv m] [MonadError m] [MonadOptions m] (α) (constName : Name) : m α := do
+  compilePendingDecls
   ofExcept <| (← getEnv).evalConst α (← getOptions) constName
 
 unsafe def evalConstCheck [Monad m] [MonadEnv m] [MonadError m] [MonadOptions m] (α) (typeName : Name) (constName : Name) : m α := do
+  compilePendingDecls
   ofExcept <| (← getEnv).evalConstCheck α (← getOptions) typeName constName
 
 def findModuleOf? [Monad m] [MonadEnv m] [MonadError m] (declName : Name) : m (Option Name) := do
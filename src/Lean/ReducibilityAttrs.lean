@@ -14,36 +14,68 @@ Reducibility status for a definition.
 -/
 inductive ReducibilityStatus where
   | reducible | semireducible | irreducible
-  deriving Inhabited, Repr, BEq
+  deriving Inhabited, Repr, BEq, Hashable
 
 def ReducibilityStatus.toAttrString : ReducibilityStatus → String
   | .reducible => "[reducible]"
   | .irreducible => "[irreducible]"
   | .semireducible => "[semireducible]"
 
-builtin_initialize reducibilityCoreExt : PersistentEnvExtension (Name × ReducibilityStatus) (Name × ReducibilityStatus) (NameMap ReducibilityStatus) ←
+/--
+Reducibility statuses stored by an environment extension, and their fingerprint: the sum of the hashes of the
+entries of `statuses`, see `getReducibilityFingerprint`.
+-/
+structure ReducibilityStatuses (σ : Type) where
+  statuses    : σ
+  fingerprint : UInt64 := 0
+  deriving Inhabited
+
+private def ReducibilityStatuses.fingerprintOf (declName : Name) (status : ReducibilityStatus) : UInt64 :=
+  mixHash (hash declName) (hash status)
+
+private def ReducibilityStatuses.adjustFingerprint (s : ReducibilityStatuses σ) (old? : Option ReducibilityStatus)
+    (declName : Name) (status : ReducibilityStatus) : UInt64 :=
+  let fingerprint := match old? with
+    | some old => s.fingerprint - fingerprintOf declName old
+    | none     => s.fingerprint
+  fingerprint + fingerprintOf declName status
+
+builtin_initialize reducibilityCoreExt : PersistentEnvExtension (Name × ReducibilityStatus) (Name × ReducibilityStatus) (ReducibilityStatuses (NameMap ReducibilityStatus)) ←
   registerPersistentEnvExtension {
     name            := `reducibilityCore
-    mkInitial       := pure {}
-    addImportedFn   := fun _ _ => pure {}
-    addEntryFn      := fun (s : NameMap ReducibilityStatus) (p : Name × ReducibilityStatus) => s.insert p.1 p.2
-    exportEntriesFn := fun m =>
-      let r : Array (Name × ReducibilityStatus) := m.fold (fun a n p => a.push (n, p)) #[]
+    mkInitial       := pure { statuses := {} }
+    addImportedFn   := fun _ _ => pure { statuses := {} }
+    addEntryFn      := fun s (declName, status) =>
+      { statuses := s.statuses.insert declName status
+        fingerprint := s.adjustFingerprint (s.statuses.find? declName) declName status }
+    exportEntriesFn := fun s =>
+      let r : Array (Name × ReducibilityStatus) := s.statuses.fold (fun a n p => a.push (n, p)) #[]
       r.qsort (fun a b => Name.quickLt a.1 b.1)
-    statsFn         := fun s => "reducibility attribute core extension" ++ Format.line ++ "number of local entries: " ++ format s.size
+    statsFn         := fun s => "reducibility attribute core extension" ++ Format.line ++ "number of local entries: " ++ format s.statuses.size
   }
 
-builtin_initialize reducibilityExtraExt : SimpleScopedEnvExtension (Name × ReducibilityStatus) (SMap Name ReducibilityStatus) ←
+builtin_initialize reducibilityExtraExt : SimpleScopedEnvExtension (Name × ReducibilityStatus) (ReducibilityStatuses (SMap Name ReducibilityStatus)) ←
   registerSimpleScopedEnvExtension {
     name := `reducibilityExtra
-    initial := {}
-    addEntry := fun d (declName, status) => d.insert declName status
-    finalizeImport := fun d => d.switch
+    initial := { statuses := {} }
+    addEntry := fun s (declName, status) =>
+      { statuses := s.statuses.insert declName status
+        fingerprint := s.adjustFingerprint (s.statuses.find? declName) declName status }
+    finalizeImport := fun s => { s with statuses := s.statuses.switch }
   }
 
+/--
+Fingerprint of the reducibility statuses that are not determined by the imported modules alone: the statuses set in
+the current file, the statuses set on imported declarations, and the `local` and `scoped` statuses of the current
+scopes. Two environments importing the same modules and with the same fingerprint have the same reducibility
+statuses (up to hash collisions).
+-/
+def getReducibilityFingerprint (env : Environment) : UInt64 :=
+  mixHash (reducibilityCoreExt.getState env).fingerprint (reducibilityExtraExt.getState env).fingerprint
+
 @[export lean_get_reducibility_status]
 def getReducibilityStatusCore (env : Environment) (declName : Name) : ReducibilityStatus :=
-  let m := reducibilityExtraExt.getState env
+  let m := (reducibilityExtraExt.getState env).statuses
   if let some status := m.find? declName then
     status
   else match env.getModuleIdxFor? declName with
@@ -51,7 +83,7 @@ def getReducibilityStatusCore (env : Environment) (declName : Name) : Reducibili
     match (reducibilityCoreExt.getModuleEntries env modIdx).binSearch (declName, .semireducible) (fun a b => Name.quickLt a.1 b.1) with
     | some (_, status) => status
     | none => .semireducible
-  | none => (reducibilityCoreExt.getState env).find? declName |>.getD .semireducible
+  | none => (reducibilityCoreExt.getState env).statuses.find? declName |>.getD .semireducible
 
 private def setReducibilityStatusCore (env : Environment) (declName : Name) (status : ReducibilityStatus) (attrKind : AttributeKind) (currNamespace : Name) : Environment :=
   if attrKind matches .global then
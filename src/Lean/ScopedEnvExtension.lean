@@ -55,21 +55,72 @@ def ScopedEntries.insert (scopedEntries : ScopedEntries β) (ns : Name) (b : β)
   | none    => { map := scopedEntries.map.insert ns <| ({} : PArray β).push b }
   | some bs => { map := scopedEntries.map.insert ns <| bs.push b }
 
-def addImportedFn (descr : Descr α β σ) (as : Array (Array (Entry α))) : ImportM (StateStack α β σ) := do
-  let mut s ← descr.mkInitial
+@[specialize] def addImportedCore [Monad m] (descr : Descr α β σ) (ofOLeanEntry : σ → α → m β) (initial : σ)
+    (as : Array (Array (Entry α))) : m (StateStack α β σ) := do
+  let mut s := initial
   let mut scopedEntries : ScopedEntries β := {}
   for a in as do
     for e in a do
       match e with
       | Entry.global a =>
-        let b ← descr.ofOLeanEntry s a
+        let b ← ofOLeanEntry s a
         s := descr.addEntry s b
       | Entry.scoped ns a =>
-        let b ← descr.ofOLeanEntry s a
+        let b ← ofOLeanEntry s a
         scopedEntries := scopedEntries.insert ns b
   s := descr.finalizeImport s
   return { stateStack := [ { state := s } ], scopedEntries := scopedEntries }
 
+/-- Minimum number of imported entries added to a state by a single task of `addImportedParallel`. -/
+private def importChunkSize : Nat := 4096
+
+/-- Merges adjacent pairs of `tasks` in parallel, preserving their order. -/
+private def mergePairs (merge : σ → σ → σ) : List (Task σ) → List (Task σ)
+  | t₁ :: t₂ :: ts => (t₁.bind fun s₁ => t₂.map (merge s₁ ·)) :: mergePairs merge ts
+  | ts => ts
+
+/--
+Variant of `addImportedCore` for extensions whose states can be merged (see
+`SimpleScopedEnvExtension.Descr.mergeImported?`). The global entries of consecutive imported modules
+are added to copies of `initial` in parallel tasks, whose results are then merged pairwise.
+-/
+def addImportedParallel (descr : Descr α α σ) (merge : σ → σ → σ) (initial : σ)
+    (as : Array (Array (Entry α))) : StateStack α α σ := Id.run do
+  let addGlobals (s : σ) (a : Array (Entry α)) : σ := a.foldl (init := s) fun s e =>
+    match e with
+    | Entry.global a => descr.addEntry s a
+    | Entry.scoped .. => s
+  let mut tasks : Array (Task σ) := #[]
+  let mut chunk : Array (Array (Entry α)) := #[]
+  let mut chunkSize := 0
+  for a in as do
+    chunk := chunk.push a
+    chunkSize := chunkSize + a.size
+    if chunkSize ≥ importChunkSize then
+      let c := chunk
+      tasks := tasks.push <| Task.spawn fun _ => c.foldl addGlobals initial
+      chunk := #[]
+      chunkSize := 0
+  unless chunk.isEmpty do
+    let c := chunk
+    tasks := tasks.push <| Task.spawn fun _ => c.foldl addGlobals initial
+  let mut pending := tasks.toList
+  while pending.length > 1 do
+    pending := mergePairs merge pending
+  let mut s := match pending with
+    | t :: _ => t.get
+    | []     => initial
+  let mut scopedEntries : ScopedEntries α := {}
+  for a in as do
+    for e in a do
+      if let Entry.scoped ns a := e then
+        scopedEntries := scopedEntries.insert ns a
+  s := descr.finalizeImport s
+  return { stateStack := [ { state := s } ], scopedEntries := scopedEntries }
+
+def addImportedFn (descr : Descr α β σ) (as : Array (Array (Entry α))) : ImportM (StateStack α β σ) := do
+  addImportedCore descr descr.ofOLeanEntry (← descr.mkInitial) as
+
 def addEntryFn (descr : Descr α β σ) (s : StateStack α β σ) (e : Entry β) : StateStack α β σ :=
   match s with
   | { stateStack := stateStack, scopedEntries := scopedEntries, newEntries := newEntries } =>
@@ -104,7 +155,12 @@ structure ScopedEnvExtension (α : Type) (β : Type) (σ : Type) where
 
 builtin_initialize scopedEnvExtensionsRef : IO.Ref (Array (ScopedEnvExtension EnvExtensionEntry EnvExtensionEntry EnvExtensionState)) ← IO.mkRef #[]
 
-unsafe def registerScopedEnvExtensionUnsafe (descr : Descr α β σ) : IO (ScopedEnvExtension α β σ) := do
+/--
+Registers a scoped environment extension. Its imported state is computed according to `importMode`
+(see `EnvExtensionImportMode`), which requires `addImportedPureFn?` for modes other than `.sync`.
+-/
+unsafe def registerScopedEnvExtensionUnsafe (descr : Descr α β σ) (importMode := EnvExtensionImportMode.sync)
+    (addImportedPureFn? : Option (Array (Array (Entry α)) → StateStack α β σ) := none) : IO (ScopedEnvExtension α β σ) := do
   let ext ← registerPersistentEnvExtension {
     name            := descr.name
     mkInitial       := mkInitial descr
@@ -112,13 +168,16 @@ unsafe def registerScopedEnvExtensionUnsafe (descr : Descr α β σ) : IO (Scope
     addEntryFn      := addEntryFn descr
     exportEntriesFn := exportEntriesFn
     statsFn         := fun s => format "number of local entries: " ++ format s.newEntries.length
+    importMode      := importMode
+    addImportedPureFn? := addImportedPureFn?
   }
   let ext := { descr := descr, ext := ext : ScopedEnvExtension α β σ }
   scopedEnvExtensionsRef.modify fun exts => exts.push (unsafeCast ext)
   return ext
 
 @[implemented_by registerScopedEnvExtensionUnsafe]
-opaque registerScopedEnvExtension (descr : Descr α β σ) : IO (ScopedEnvExtension α β σ)
+opaque registerScopedEnvExtension (descr : Descr α β σ) (importMode := EnvExtensionImportMode.sync)
+    (addImportedPureFn? : Option (Array (Array (Entry α)) → StateStack α β σ) := none) : IO (ScopedEnvExtension α β σ)
 
 def ScopedEnvExtension.pushScope (ext : ScopedEnvExtension α β σ) (env : Environment) : Environment :=
   let s := ext.ext.getState env
@@ -206,9 +265,21 @@ structure SimpleScopedEnvExtension.Descr (α : Type) (σ : Type) where
   addEntry       : σ → α → σ
   initial        : σ
   finalizeImport : σ → σ := id
+  /--
+  When the imported state is computed, see `EnvExtensionImportMode`. Note that `.lazy` is of
+  little use for scoped extensions, as opening a namespace or section accesses their state.
+  -/
+  importMode     : EnvExtensionImportMode := .sync
+  /--
+  If set, deferred imports (see `importMode`) add the global entries of the imported modules to
+  separate copies of `initial` in parallel, and combine the results using this function, in import
+  order (see `ScopedEnvExtension.addImportedParallel`). `mergeImported s₁ s₂` must be equivalent to
+  adding the entries that produced `s₂` from `initial` to `s₁`.
+  -/
+  mergeImported? : Option (σ → σ → σ) := none
 
 def registerSimpleScopedEnvExtension (descr : SimpleScopedEnvExtension.Descr α σ) : IO (SimpleScopedEnvExtension α σ) := do
-  registerScopedEnvExtension {
+  let scopedDescr : ScopedEnvExtension.Descr α α σ := {
     name           := descr.name
     mkInitial      := return descr.initial
     addEntry       := descr.addEntry
@@ -216,5 +287,9 @@ def registerSimpleScopedEnvExtension (descr : SimpleScopedEnvExtension.Descr α
     ofOLeanEntry   := fun _ a => return a
     finalizeImport := descr.finalizeImport
   }
+  registerScopedEnvExtension scopedDescr descr.importMode <| some fun as =>
+    match descr.mergeImported? with
+    | some merge => ScopedEnvExtension.addImportedParallel scopedDescr merge descr.initial as
+    | none       => Id.run <| ScopedEnvExtension.addImportedCore scopedDescr (fun _ a => a) descr.initial as
 
 end Lean
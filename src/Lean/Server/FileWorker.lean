@@ -143,21 +143,23 @@ This option can only be set on the command line, not in the lakefile or via `set
   See also section "Communication" in Lean/Server/README.md.
   -/
   structure MemorizedInteractiveDiagnostics where
-    diags : Array Widget.InteractiveDiagnostic
+    diags    : Array Widget.InteractiveDiagnostic
+    /-- `diags` converted to `Lsp.Diagnostic` and encoded as JSON. -/
+    lspDiags : Array Json
   deriving TypeName
 
   /--
   Sends a `textDocument/publishDiagnostics` notification to the client that contains the diagnostics
-  in `ctx.stickyDiagnosticsRef` and `doc.diagnosticsRef`.
+  in `ctx.stickyDiagnosticsRef` and `doc.diagnosticsRef`. The latter are taken from
+  `doc.lspDiagnosticsRef`, so that only the few sticky diagnostics are converted and encoded anew.
   -/
   private def publishDiagnostics (ctx : WorkerContext) (doc : EditableDocumentCore)
       : BaseIO Unit := do
     let stickyInteractiveDiagnostics ← ctx.stickyDiagnosticsRef.get
-    let docInteractiveDiagnostics ← doc.diagnosticsRef.get
+    let docLspDiagnostics ← doc.lspDiagnosticsRef.get
     let diagnostics :=
-      stickyInteractiveDiagnostics.toArray ++ docInteractiveDiagnostics
-      |>.map (·.toDiagnostic)
-    let notification := mkPublishDiagnosticsNotification doc.meta diagnostics
+      stickyInteractiveDiagnostics.toArray.map (toJson ·.toDiagnostic) ++ docLspDiagnostics
+    let notification := mkPublishEncodedDiagnosticsNotification doc.meta diagnostics
     ctx.chanOut.send notification
 
   open Language in
@@ -197,17 +199,19 @@ This option can only be set on the command line, not in the lakefile or via `set
   where
     go (node : SnapshotTree) (st : ReportSnapshotsState) : BaseIO (Task ReportSnapshotsState) := do
       if node.element.diagnostics.msgLog.hasUnreported then
-        let diags ←
+        let (diags, lspDiags) ←
           if let some memorized ← node.element.diagnostics.interactiveDiagsRef?.bindM fun ref => do
               return (← ref.get).bind (·.get? MemorizedInteractiveDiagnostics) then
-            pure memorized.diags
+            pure (memorized.diags, memorized.lspDiags)
           else
             let diags ← node.element.diagnostics.msgLog.toArray.mapM
               (Widget.msgToInteractiveDiagnostic doc.meta.text · ctx.clientHasWidgets)
+            let lspDiags := diags.map (toJson ·.toDiagnostic)
             if let some cacheRef := node.element.diagnostics.interactiveDiagsRef? then
-              cacheRef.set <| some <| .mk { diags : MemorizedInteractiveDiagnostics }
-            pure diags
+              cacheRef.set <| some <| .mk { diags, lspDiags : MemorizedInteractiveDiagnostics }
+            pure (diags, lspDiags)
         doc.diagnosticsRef.modify (· ++ diags)
+        doc.lspDiagnosticsRef.modify (· ++ lspDiags)
         if st.hasBlocked then
           publishDiagnostics ctx doc
 
@@ -358,6 +362,7 @@ section Initialization
     let doc : EditableDocumentCore := {
       meta, initSnap
       diagnosticsRef := (← IO.mkRef ∅)
+      lspDiagnosticsRef := (← IO.mkRef ∅)
     }
     let reporterCancelTk ← CancelToken.new
     let reporter ← reportSnapshots ctx doc reporterCancelTk
@@ -381,8 +386,8 @@ section Initialization
         -- always be silently discarded
         let version? : Option Int := do match msg with
           | .notification "textDocument/publishDiagnostics" (some params) =>
-            let params : PublishDiagnosticsParams ← fromJson? (toJson params) |>.toOption
-            params.version?
+            -- only decode the version, not the diagnostics
+            (toJson params).getObjValAs? Int "version" |>.toOption
           | .notification "$/lean/fileProgress" (some params) =>
             let params : LeanFileProgressParams ← fromJson? (toJson params) |>.toOption
             params.textDocument.version?
@@ -432,6 +437,7 @@ section Updates
     let doc : EditableDocumentCore := {
       meta, initSnap
       diagnosticsRef := (← IO.mkRef ∅)
+      lspDiagnosticsRef := (← IO.mkRef ∅)
     }
     let reporterCancelTk ← CancelToken.new
     let reporter ← reportSnapshots ctx doc reporterCancelTk
@@ -573,10 +573,105 @@ where
     let semanticTokens := computeDeltaLspSemanticTokens absoluteLspSemanticTokens
     return semanticTokens
 
+/--
+The last result of a `textDocument/semanticTokens/full(/delta)` request, from which the next
+result is computed incrementally.
+-/
+structure SemanticTokensCache where
+  /-- ID of the result, used as `SemanticTokens.resultId?`. -/
+  resultId   : Nat := 0
+  /-- Text of the document the result was computed for. -/
+  text       : String := ""
+  /-- End position and tokens of each command snapshot of the result. -/
+  snapTokens : Array (String.Pos × Array AbsoluteLspSemanticToken) := #[]
+  /-- `SemanticTokens.data` of the result. -/
+  data       : Array Nat := #[]
+  deriving Inhabited
+
+/-- Each file worker serves a single document, so one cache per process suffices. -/
+private builtin_initialize semanticTokensCacheRef : IO.Ref SemanticTokensCache ← IO.mkRef {}
+
+/--
+Computes the semantic tokens of each snapshot in `snaps`. The tokens of the commands of `prev` that
+end before the first change of the document text since `prev` are reused instead of recomputed,
+so that after an edit, only the commands after it need to be revisited.
+-/
+def computeSnapshotSemanticTokens (text : FileMap) (snaps : List Snapshot) (prev : SemanticTokensCache)
+    : Array (String.Pos × Array AbsoluteLspSemanticToken) := Id.run do
+  let diffPos := prev.text.firstDiffPos text.source
+  let mut snapTokens := #[]
+  let mut reuse := true
+  for s in snaps do
+    if reuse then
+      if let some (endPos, tokens) := prev.snapTokens[snapTokens.size]? then
+        if endPos == s.endPos && endPos < diffPos then
+          snapTokens := snapTokens.push (endPos, tokens)
+          continue
+      reuse := false
+    let leanSemanticTokens :=
+      collectSyntaxBasedSemanticTokens s.stx ++ collectInfoBasedSemanticTokens s.infoTree
+    snapTokens := snapTokens.push (s.endPos, computeAbsoluteLspSemanticTokens text 0 none leanSemanticTokens)
+  return snapTokens
+
+/--
+Computes the edits that turn the semantic tokens data `prev` into `next`: a single edit replacing
+everything between the longest common prefix and suffix of whole tokens.
+-/
+def computeSemanticTokensEdits (prev next : Array Nat) : Array SemanticTokensEdit := Id.run do
+  let mut pre := 0
+  while pre < prev.size && pre < next.size && prev[pre]! == next[pre]! do
+    pre := pre + 1
+  pre := pre - pre % 5
+  let mut suf := 0
+  while suf < prev.size - pre && suf < next.size - pre &&
+      prev[prev.size - 1 - suf]! == next[next.size - 1 - suf]! do
+    suf := suf + 1
+  suf := suf - suf % 5
+  if pre == prev.size && pre == next.size then
+    return #[]
+  return #[{ start := pre, deleteCount := prev.size - pre - suf, data? := some <| next.extract pre (next.size - suf) }]
+
+/--
+Computes all semantic tokens of the finished prefix `snaps` of the document and stores them as the
+last result. Returns the previous and the new last result.
+-/
+def updateSemanticTokens (doc : EditableDocument) (snaps : List Snapshot)
+    : BaseIO (SemanticTokensCache × SemanticTokensCache) := do
+  let prev ← semanticTokensCacheRef.get
+  let text := doc.meta.text
+  let snapTokens := computeSnapshotSemanticTokens text snaps prev
+  let tokens := filterDuplicateSemanticTokens (snapTokens.concatMap (·.2))
+  let data := computeDeltaLspSemanticTokens tokens |>.data
+  -- `prev` may have been replaced by a concurrent request in the meantime, so we assign a fresh ID
+  semanticTokensCacheRef.modifyGet fun last =>
+    let cache := { resultId := last.resultId + 1, text := text.source, snapTokens, data }
+    ((prev, cache), cache)
+
 /-- Computes all semantic tokens for the document. -/
 def handleSemanticTokensFull (_ : SemanticTokensParams)
     : RequestM (RequestTask SemanticTokens) := do
-  handleSemanticTokens 0 none
+  let doc ← readDoc
+  -- Like `handleSemanticTokens`, only uses the finished prefix of the document.
+  let (snaps, _) ← doc.cmdSnaps.getFinishedPrefix
+  asTask do
+    let (_, cache) ← updateSemanticTokens doc snaps
+    return { resultId? := some (toString cache.resultId), data := cache.data }
+
+/--
+Computes all semantic tokens for the document and returns them as edits to the tokens of the result
+with ID `p.previousResultId` if that is the last result, and in full otherwise.
+-/
+def handleSemanticTokensFullDelta (p : SemanticTokensDeltaParams)
+    : RequestM (RequestTask SemanticTokensDeltaResult) := do
+  let doc ← readDoc
+  let (snaps, _) ← doc.cmdSnaps.getFinishedPrefix
+  asTask do
+    let (prev, cache) ← updateSemanticTokens doc snaps
+    let resultId? := some (toString cache.resultId)
+    if toString prev.resultId == p.previousResultId then
+      return .delta { resultId?, edits := computeSemanticTokensEdits prev.data cache.data }
+    else
+      return .tokens { resultId?, data := cache.data }
 
 /-- Computes the semantic tokens in the range provided by `p`. -/
 def handleSemanticTokensRange (p : SemanticTokensRangeParams)
@@ -733,6 +828,11 @@ builtin_initialize
     SemanticTokensParams
     SemanticTokens
     handleSemanticTokensFull
+  registerLspRequestHandler
+    "textDocument/semanticTokens/full/delta"
+    SemanticTokensDeltaParams
+    SemanticTokensDeltaResult
+    handleSemanticTokensFullDelta
   registerLspRequestHandler
     "textDocument/semanticTokens/range"
     SemanticTokensRangeParams
@@ -53,6 +53,11 @@ structure EditableDocumentCore where
   `handleGetInteractiveDiagnosticsRequest`.
   -/
   diagnosticsRef : IO.Ref (Array Widget.InteractiveDiagnostic)
+  /--
+  `diagnosticsRef` converted to `Lsp.Diagnostic` and encoded as JSON. Kept separately so that
+  `textDocument/publishDiagnostics` notifications only need to convert the diagnostics of new snapshots.
+  -/
+  lspDiagnosticsRef : IO.Ref (Array Json)
 
 /-- `EditableDocumentCore` with reporter task. -/
 structure EditableDocument extends EditableDocumentCore where
@@ -182,22 +182,229 @@ open IO
 open Lsp
 open Elab
 
+/-- Version number of the ilean format written by this version of Lean. -/
+def Ilean.currentVersion : Nat := 4
+
 /-- Content of individual `.ilean` files -/
 structure Ilean where
   /-- Version number of the ilean format. -/
-  version    : Nat := 3
+  version    : Nat := Ilean.currentVersion
   /-- Name of the module that this ilean data has been collected for. -/
   module     : Name
   /-- All references of this module. -/
   references : Lsp.ModuleRefs
   deriving FromJson, ToJson
 
+/-! ## Binary `.ilean` encoding
+
+`.ilean` files are written in a compact binary encoding, which is considerably smaller and faster
+to load than JSON. A file consists of `Ilean.binaryMagic`, the format version, a table of all names
+occurring in the file, the module name and the references. Natural numbers are encoded as LEB128
+varints and names as indices into the name table, where each entry refers to its prefix by index.
+`Ilean.load` still accepts the JSON encoding of previous versions.
+-/
+
 namespace Ilean
 
-/-- Reads and parses the .ilean file at `path`. -/
+/-- The bytes that a binary `.ilean` file starts with. -/
+def binaryMagic : ByteArray := "ileanbin".toUTF8
+
+/-- Whether `bytes` start with `binaryMagic`. -/
+def isBinary (bytes : ByteArray) : Bool :=
+  (bytes.extract 0 binaryMagic.size).data == binaryMagic.data
+
+/-- State of encoding an ilean. -/
+private structure Encoder where
+  /-- The encoded references. -/
+  out       : ByteArray := .empty
+  /-- The index of each name in `nameTable` (plus one, as `0` denotes the anonymous name). -/
+  nameIdx   : HashMap Name Nat := {}
+  /-- The encoded name table. -/
+  nameTable : ByteArray := .empty
+  /-- The number of entries of `nameTable`. -/
+  numNames  : Nat := 0
+
+private abbrev EncodeM := StateM Encoder
+
+private partial def encodeNatTo (out : ByteArray) (n : Nat) : ByteArray :=
+  if n < 0x80 then
+    out.push n.toUInt8
+  else
+    encodeNatTo (out.push (n % 0x80 + 0x80).toUInt8) (n / 0x80)
+
+private def encodeStrTo (out : ByteArray) (s : String) : ByteArray :=
+  let bytes := s.toUTF8
+  encodeNatTo out bytes.size ++ bytes
+
+private def encodeNat (n : Nat) : EncodeM Unit :=
+  modify fun e => { e with out := encodeNatTo e.out n }
+
+private def encodeByte (b : UInt8) : EncodeM Unit :=
+  modify fun e => { e with out := e.out.push b }
+
+/-- Returns the index of `n` in the name table, adding it and its prefixes if necessary. -/
+private partial def internName : Name → EncodeM Nat
+  | .anonymous => return 0
+  | n@(.str p str) => intern n p (encodeStrTo (ByteArray.empty.push 0) str)
+  | n@(.num p i) => intern n p (encodeNatTo (ByteArray.empty.push 1) i)
+where
+  intern (n p : Name) (entry : ByteArray) : EncodeM Nat := do
+    if let some idx := (← get).nameIdx.find? n then
+      return idx
+    let pIdx ← internName p
+    modifyGet fun e =>
+      let idx := e.numNames + 1
+      (idx, { e with
+        nameIdx   := e.nameIdx.insert n idx
+        nameTable := encodeNatTo e.nameTable pIdx ++ entry
+        numNames  := idx })
+
+private def encodeName (n : Name) : EncodeM Unit := do
+  encodeNat (← internName n)
+
+private def encodeRange (r : Lsp.Range) : EncodeM Unit := do
+  encodeNat r.start.line; encodeNat r.start.character
+  encodeNat r.end.line; encodeNat r.end.character
+
+private def encodeLocation (l : Lsp.RefInfo.Location) : EncodeM Unit := do
+  encodeRange l.range
+  match l.parentDecl? with
+  | none => encodeByte 0
+  | some d => encodeByte 1; encodeName d.name; encodeRange d.range; encodeRange d.selectionRange
+
+private def encodeRefIdent : RefIdent → EncodeM Unit
+  | .const m n => do encodeByte 0; encodeName m; encodeName n
+  | .fvar m id => do encodeByte 1; encodeName m; encodeName id.name
+
+private def encodeRefInfo (info : Lsp.RefInfo) : EncodeM Unit := do
+  match info.definition? with
+  | none => encodeByte 0
+  | some l => encodeByte 1; encodeLocation l
+  encodeNat info.usages.size
+  info.usages.forM encodeLocation
+
+/-- Encodes `ilean` in the binary `.ilean` format. -/
+def toBinary (ilean : Ilean) : ByteArray :=
+  let go : EncodeM Unit := do
+    encodeName ilean.module
+    encodeNat ilean.references.size
+    ilean.references.forM fun ident info => do
+      encodeRefIdent ident
+      encodeRefInfo info
+  let e := (go.run {}).2
+  let header := encodeNatTo (binaryMagic.push ilean.version.toUInt8) e.numNames
+  header ++ e.nameTable ++ e.out
+
+/-- State of decoding an ilean. -/
+private structure Decoder where
+  /-- The position of the next byte to decode. -/
+  pos   : Nat
+  /-- The names decoded from the name table, starting with the anonymous name. -/
+  names : Array Name := #[.anonymous]
+
+private abbrev DecodeM := ReaderT ByteArray <| StateT Decoder <| Except String
+
+private def decodeByte : DecodeM UInt8 := do
+  let bytes ← read
+  let pos := (← get).pos
+  if h : pos < bytes.size then
+    modify ({ · with pos := pos + 1 })
+    return bytes[pos]
+  throw "unexpected end of file"
+
+private partial def decodeNat (shift := 0) (acc := 0) : DecodeM Nat := do
+  let b ← decodeByte
+  let acc := acc + (b % 0x80).toNat <<< shift
+  if b < 0x80 then
+    return acc
+  decodeNat (shift + 7) acc
+
+private def decodeStr : DecodeM String := do
+  let size ← decodeNat
+  let bytes ← read
+  let pos := (← get).pos
+  if pos + size > bytes.size then
+    throw "unexpected end of file"
+  modify ({ · with pos := pos + size })
+  let some s := String.fromUTF8? (bytes.extract pos (pos + size))
+    | throw "invalid UTF-8 string"
+  return s
+
+private def decodeNameTableEntry : DecodeM Unit := do
+  let names := (← get).names
+  let some p := names[← decodeNat]?
+    | throw "invalid name index"
+  let n ← match (← decodeByte) with
+    | 0 => Name.str p <$> decodeStr
+    | 1 => Name.num p <$> decodeNat
+    | _ => throw "invalid name table entry"
+  modify fun d => { d with names := d.names.push n }
+
+private def decodeName : DecodeM Name := do
+  let some n := (← get).names[← decodeNat]?
+    | throw "invalid name index"
+  return n
+
+private def decodeRange : DecodeM Lsp.Range :=
+  return ⟨⟨← decodeNat, ← decodeNat⟩, ⟨← decodeNat, ← decodeNat⟩⟩
+
+private def decodeLocation : DecodeM Lsp.RefInfo.Location := do
+  let range ← decodeRange
+  match (← decodeByte) with
+  | 0 => return ⟨range, none⟩
+  | 1 => return ⟨range, some ⟨← decodeName, ← decodeRange, ← decodeRange⟩⟩
+  | _ => throw "invalid reference location"
+
+private def decodeRefIdent : DecodeM RefIdent := do
+  match (← decodeByte) with
+  | 0 => return .const (← decodeName) (← decodeName)
+  | 1 => return .fvar (← decodeName) ⟨← decodeName⟩
+  | _ => throw "invalid reference identifier"
+
+private def decodeRefInfo : DecodeM Lsp.RefInfo := do
+  let definition? ← match (← decodeByte) with
+    | 0 => pure none
+    | 1 => some <$> decodeLocation
+    | _ => throw "invalid reference definition"
+  let numUsages ← decodeNat
+  let mut usages := Array.mkEmpty numUsages
+  for _ in [0:numUsages] do
+    usages := usages.push (← decodeLocation)
+  return { definition?, usages }
+
+/-- Decodes an ilean in the binary `.ilean` format. -/
+def ofBinary? (bytes : ByteArray) : Except String Ilean := do
+  unless isBinary bytes do
+    throw "not a binary ilean file"
+  let go : DecodeM Ilean := do
+    let version := (← decodeByte).toNat
+    if version != currentVersion then
+      throw s!"unsupported ilean version {version}"
+    let numNames ← decodeNat
+    for _ in [0:numNames] do
+      decodeNameTableEntry
+    let module ← decodeName
+    let numRefs ← decodeNat
+    let mut references : Lsp.ModuleRefs := mkHashMap (capacity := numRefs)
+    for _ in [0:numRefs] do
+      references := references.insert (← decodeRefIdent) (← decodeRefInfo)
+    return { version, module, references }
+  Prod.fst <$> (go bytes).run { pos := binaryMagic.size }
+
+/-- Writes `ilean` to `path` in the binary `.ilean` format. -/
+def save (ilean : Ilean) (path : System.FilePath) : IO Unit :=
+  FS.writeBinFile path ilean.toBinary
+
+/-- Reads and parses the .ilean file at `path`, in the binary or the JSON encoding. -/
 def load (path : System.FilePath) : IO Ilean := do
-  let content ← FS.readFile path
-  match Json.parse content >>= fromJson? with
+  let bytes ← FS.readBinFile path
+  let ilean? :=
+    if isBinary bytes then
+      ofBinary? bytes
+    else match String.fromUTF8? bytes with
+      | some content => Json.parse content >>= fromJson?
+      | none => throw "invalid UTF-8"
+  match ilean? with
     | Except.ok ilean => pure ilean
     | Except.error msg => throwServerError s!"Failed to load ilean at {path}: {msg}"
 
@@ -381,36 +588,72 @@ structure References where
   ileans : HashMap Name (System.FilePath × Lsp.ModuleRefs)
   /-- References from workers, overriding the corresponding ilean files -/
   workers : HashMap Name (Nat × Lsp.ModuleRefs)
+  /--
+  Inverted index of `ileans` and `workers`: the modules whose ilean or worker references contain
+  each identifier. It is maintained incrementally so that looking up the references to an
+  identifier does not need to visit every module.
+  -/
+  index : HashMap RefIdent NameHashSet := {}
 
 namespace References
 
 /-- No ilean files, no information from workers. -/
 def empty : References := { ileans := HashMap.empty, workers := HashMap.empty }
 
+/-- Adds the identifiers of `refs` of `module` to the index of `self`. -/
+private def indexRefs (self : References) (module : Name) (refs : Lsp.ModuleRefs) : References :=
+  { self with index := refs.fold (init := self.index) fun index ident _ =>
+      index.insert ident <| (index.findD ident {}).insert module }
+
+/--
+Removes the identifiers of `refs` of `module` from the index of `self`, except for those still
+contained in the other references (`other`) of `module`.
+-/
+private def unindexRefs (self : References) (module : Name) (refs : Lsp.ModuleRefs)
+    (other : Option Lsp.ModuleRefs) : References :=
+  { self with index := refs.fold (init := self.index) fun index ident _ =>
+      if other.any (·.contains ident) then
+        index
+      else
+        let modules := index.findD ident {} |>.erase module
+        if modules.isEmpty then index.erase ident else index.insert ident modules }
+
 /-- Adds the contents of an ilean file `ilean` at `path` to `self`. -/
 def addIlean (self : References) (path : System.FilePath) (ilean : Ilean) : References :=
+  let self := match self.ileans.find? ilean.module with
+    | some (_, refs) => self.unindexRefs ilean.module refs (self.workers.find? ilean.module |>.map (·.2))
+    | none => self
+  let self := self.indexRefs ilean.module ilean.references
   { self with ileans := self.ileans.insert ilean.module (path, ilean.references) }
 
 /-- Removes the ilean file data at `path` from `self`. -/
 def removeIlean (self : References) (path : System.FilePath) : References :=
-  let namesToRemove := self.ileans.toList.filter (fun (_, p, _) => p == path)
-    |>.map (fun (n, _, _) => n)
-  namesToRemove.foldl (init := self) fun self name =>
+  let toRemove := self.ileans.toList.filter (fun (_, p, _) => p == path)
+  toRemove.foldl (init := self) fun self (name, _, refs) =>
+    let self := self.unindexRefs name refs (self.workers.find? name |>.map (·.2))
     { self with ileans := self.ileans.erase name }
 
+/-- Replaces the worker references of `name` in `self` with `refs` of version `version`. -/
+private def setWorkerRefs (self : References) (name : Name) (version : Nat) (refs : Lsp.ModuleRefs) : References :=
+  let self := match self.workers.find? name with
+    | some (_, currRefs) => self.unindexRefs name currRefs (self.ileans.find? name |>.map (·.2))
+    | none => self
+  let self := self.indexRefs name refs
+  { self with workers := self.workers.insert name (version, refs) }
+
 /--
 Updates the worker references in `self` with the `refs` of the worker managing the module `name`.
 Replaces the current references with `refs` if `version` is newer than the current version managed
 in `refs` and otherwise merges the reference data if `version` is equal to the current version.
 -/
 def updateWorkerRefs (self : References) (name : Name) (version : Nat) (refs : Lsp.ModuleRefs) : References := Id.run do
-  if let some (currVersion, _) := self.workers.find? name then
+  if let some (currVersion, currRefs) := self.workers.find? name then
     if version > currVersion then
-      return { self with workers := self.workers.insert name (version, refs) }
+      return self.setWorkerRefs name version refs
     if version == currVersion then
-      let current := self.workers.findD name (version, HashMap.empty)
-      let merged := refs.fold (init := current.snd) fun m ident info =>
+      let merged := refs.fold (init := currRefs) fun m ident info =>
         m.findD ident Lsp.RefInfo.empty |>.merge info |> m.insert ident
+      let self := self.indexRefs name refs
       return { self with workers := self.workers.insert name (version, merged) }
   return self
 
@@ -422,10 +665,13 @@ def finalizeWorkerRefs (self : References) (name : Name) (version : Nat) (refs :
   if let some (currVersion, _) := self.workers.find? name then
     if version < currVersion then
       return self
-  return { self with workers := self.workers.insert name (version, refs) }
+  return self.setWorkerRefs name version refs
 
 /-- Erases all worker references in `self` for the worker managing `name`. -/
 def removeWorkerRefs (self : References) (name : Name) : References :=
+  let self := match self.workers.find? name with
+    | some (_, refs) => self.unindexRefs name refs (self.ileans.find? name |>.map (·.2))
+    | none => self
   { self with workers := self.workers.erase name }
 
 /-- Yields a map from all modules to all of their references. -/
@@ -433,6 +679,12 @@ def allRefs (self : References) : HashMap Name Lsp.ModuleRefs :=
   let ileanRefs := self.ileans.toArray.foldl (init := HashMap.empty) fun m (name, _, refs) => m.insert name refs
   self.workers.toArray.foldl (init := ileanRefs) fun m (name, _, refs) => m.insert name refs
 
+/-- Yields the references of `module`, preferring those of its worker over its ilean file. -/
+def refsOf? (self : References) (module : Name) : Option Lsp.ModuleRefs :=
+  match self.workers.find? module with
+  | some (_, refs) => some refs
+  | none => self.ileans.find? module |>.map (·.2)
+
 /--
 Yields all references in `self` for `ident`, as well as the `DocumentUri` that each
 reference occurs in.
@@ -442,14 +694,11 @@ def allRefsFor
     (srcSearchPath : SearchPath)
     (ident         : RefIdent)
     : IO (Array (DocumentUri × Lsp.RefInfo)) := do
-  let refsToCheck := match ident with
-    | RefIdent.const .. => self.allRefs.toArray
-    | RefIdent.fvar identModule .. =>
-      match self.allRefs.find? identModule with
-      | none => #[]
-      | some refs => #[(identModule, refs)]
+  let modules := self.index.findD ident {}
   let mut result := #[]
-  for (module, refs) in refsToCheck do
+  for module in modules.toArray do
+    let some refs := self.refsOf? module
+      | continue
     let some info := refs.find? ident
       | continue
     let some path ← srcSearchPath.findModuleWithExt "lean" module
@@ -462,13 +711,13 @@ def allRefsFor
 
 /-- Yields all references in `module` at `pos`. -/
 def findAt (self : References) (module : Name) (pos : Lsp.Position) (includeStop := false) : Array RefIdent := Id.run do
-  if let some refs := self.allRefs.find? module then
+  if let some refs := self.refsOf? module then
     return refs.findAt pos includeStop
   #[]
 
 /-- Yields the first reference in `module` at `pos`. -/
 def findRange? (self : References) (module : Name) (pos : Lsp.Position) (includeStop := false) : Option Range := do
-  let refs ← self.allRefs.find? module
+  let refs ← self.refsOf? module
   refs.findRange? pos includeStop
 
 /-- Location and parent declaration of a reference. -/
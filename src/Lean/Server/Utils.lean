@@ -148,6 +148,19 @@ def mkPublishDiagnosticsNotification (m : DocumentMeta) (diagnostics : Array Lsp
     diagnostics := diagnostics
   }
 
+/--
+Like `mkPublishDiagnosticsNotification`, but for diagnostics that are already encoded as JSON, so
+that the encoding of unchanged diagnostics can be reused between notifications.
+-/
+def mkPublishEncodedDiagnosticsNotification (m : DocumentMeta) (diagnostics : Array Json) :
+    JsonRpc.Notification Json where
+  method := "textDocument/publishDiagnostics"
+  param  := Json.mkObj [
+    ("uri", toJson m.uri),
+    ("version", toJson m.version),
+    ("diagnostics", Json.arr diagnostics)
+  ]
+
 /-- Constructs a `$/lean/fileProgress` notification. -/
 def mkFileProgressNotification (m : DocumentMeta) (processing : Array LeanFileProgressProcessingInfo) :
     JsonRpc.Notification Lsp.LeanFileProgressParams where
@@ -1025,7 +1025,7 @@ def mkLeanServerCapabilities : ServerCapabilities := {
       tokenTypes     := SemanticTokenType.names
       tokenModifiers := SemanticTokenModifier.names
     }
-    full  := true
+    full  := .withDelta true
     range := true
   }
   codeActionProvider? := some {
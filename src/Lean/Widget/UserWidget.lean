@@ -76,6 +76,7 @@ builtin_initialize moduleRegistry : ModuleRegistry ←
     addImportedFn := fun xss => xss.foldl (Array.foldl (fun s n => s.insert n.1 n.2)) ∅
     addEntryFn    := fun s n => s.insert n.1 n.2
     toArrayFn     := fun es => es.toArray
+    importMode    := .lazy
   }
 
 /--
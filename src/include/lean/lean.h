@@ -313,6 +313,13 @@ LEAN_EXPORT void lean_free_small(void * p);
 LEAN_EXPORT unsigned lean_small_mem_size(void * p);
 LEAN_EXPORT void lean_inc_heartbeat(void);
 
+/* Allocate the small objects of the current thread from a fresh arena until the matching `lean_arena_pop`.
+   Objects are still reference counted, but pages of the arena are not shared with other objects.
+   `lean_arena_pop(r)` moves the objects reachable only from `r` out of the arena, returns the new `r`, and releases
+   the pages of the arena that do not contain any live objects anymore. */
+LEAN_EXPORT void lean_arena_push(void);
+LEAN_EXPORT lean_object * lean_arena_pop(lean_object * r);
+
 #ifndef __cplusplus
 void * malloc(size_t);  // avoid including big `stdlib.h`
 #endif
@@ -856,6 +863,7 @@ LEAN_EXPORT lean_obj_res lean_byte_array_mk(lean_obj_arg a);
 LEAN_EXPORT lean_obj_res lean_byte_array_data(lean_obj_arg a);
 LEAN_EXPORT lean_obj_res lean_copy_byte_array(lean_obj_arg a);
 LEAN_EXPORT uint64_t lean_byte_array_hash(b_lean_obj_arg a);
+LEAN_EXPORT uint64_t lean_byte_array_hash_with_seed(b_lean_obj_arg a, uint64_t seed);
 
 static inline lean_obj_res lean_mk_empty_byte_array(b_lean_obj_arg capacity) {
     if (!lean_is_scalar(capacity)) lean_internal_panic_out_of_memory();
@@ -975,6 +983,204 @@ static inline lean_obj_res lean_float_array_set(lean_obj_arg a, b_lean_obj_arg i
     }
 }
 
+/* UInt16Array (special case of Array of Scalars) */
+
+LEAN_EXPORT lean_obj_res lean_uint16_array_mk(lean_obj_arg a);
+LEAN_EXPORT lean_obj_res lean_uint16_array_data(lean_obj_arg a);
+LEAN_EXPORT lean_obj_res lean_copy_uint16_array(lean_obj_arg a);
+
+static inline lean_obj_res lean_mk_empty_uint16_array(b_lean_obj_arg capacity) {
+    if (!lean_is_scalar(capacity)) lean_internal_panic_out_of_memory();
+    return lean_alloc_sarray(sizeof(uint16_t), 0, lean_unbox(capacity)); // NOLINT
+}
+
+static inline lean_obj_res lean_uint16_array_size(b_lean_obj_arg a) {
+    return lean_box(lean_sarray_size(a));
+}
+
+static inline uint16_t * lean_uint16_array_cptr(b_lean_obj_arg a) {
+    return (uint16_t*)(lean_sarray_cptr(a)); // NOLINT
+}
+
+static inline uint16_t lean_uint16_array_uget(b_lean_obj_arg a, size_t i) {
+    return lean_uint16_array_cptr(a)[i];
+}
+
+static inline uint16_t lean_uint16_array_fget(b_lean_obj_arg a, b_lean_obj_arg i) {
+    return lean_uint16_array_uget(a, lean_unbox(i));
+}
+
+static inline uint16_t lean_uint16_array_get(b_lean_obj_arg a, b_lean_obj_arg i) {
+    if (lean_is_scalar(i)) {
+        size_t idx = lean_unbox(i);
+        return idx < lean_sarray_size(a) ? lean_uint16_array_uget(a, idx) : 0;
+    } else {
+        /* The index must be out of bounds. Otherwise we would be out of memory. */
+        return 0;
+    }
+}
+
+LEAN_EXPORT lean_obj_res lean_uint16_array_push(lean_obj_arg a, uint16_t v);
+LEAN_EXPORT lean_obj_res lean_uint16_array_fill(lean_obj_arg a, uint16_t v);
+
+static inline lean_obj_res lean_uint16_array_uset(lean_obj_arg a, size_t i, uint16_t v) {
+    lean_obj_res r;
+    if (lean_is_exclusive(a)) r = a;
+    else r = lean_copy_uint16_array(a);
+    uint16_t * it = lean_uint16_array_cptr(r) + i;
+    *it = v;
+    return r;
+}
+
+static inline lean_obj_res lean_uint16_array_fset(lean_obj_arg a, b_lean_obj_arg i, uint16_t v) {
+    return lean_uint16_array_uset(a, lean_unbox(i), v);
+}
+
+static inline lean_obj_res lean_uint16_array_set(lean_obj_arg a, b_lean_obj_arg i, uint16_t v) {
+    if (!lean_is_scalar(i)) {
+        return a;
+    } else {
+        size_t idx = lean_unbox(i);
+        if (idx >= lean_sarray_size(a)) {
+            return a;
+        } else {
+            return lean_uint16_array_uset(a, idx, v);
+        }
+    }
+}
+
+/* UInt32Array (special case of Array of Scalars) */
+
+LEAN_EXPORT lean_obj_res lean_uint32_array_mk(lean_obj_arg a);
+LEAN_EXPORT lean_obj_res lean_uint32_array_data(lean_obj_arg a);
+LEAN_EXPORT lean_obj_res lean_copy_uint32_array(lean_obj_arg a);
+
+static inline lean_obj_res lean_mk_empty_uint32_array(b_lean_obj_arg capacity) {
+    if (!lean_is_scalar(capacity)) lean_internal_panic_out_of_memory();
+    return lean_alloc_sarray(sizeof(uint32_t), 0, lean_unbox(capacity)); // NOLINT
+}
+
+static inline lean_obj_res lean_uint32_array_size(b_lean_obj_arg a) {
+    return lean_box(lean_sarray_size(a));
+}
+
+static inline uint32_t * lean_uint32_array_cptr(b_lean_obj_arg a) {
+    return (uint32_t*)(lean_sarray_cptr(a)); // NOLINT
+}
+
+static inline uint32_t lean_uint32_array_uget(b_lean_obj_arg a, size_t i) {
+    return lean_uint32_array_cptr(a)[i];
+}
+
+static inline uint32_t lean_uint32_array_fget(b_lean_obj_arg a, b_lean_obj_arg i) {
+    return lean_uint32_array_uget(a, lean_unbox(i));
+}
+
+static inline uint32_t lean_uint32_array_get(b_lean_obj_arg a, b_lean_obj_arg i) {
+    if (lean_is_scalar(i)) {
+        size_t idx = lean_unbox(i);
+        return idx < lean_sarray_size(a) ? lean_uint32_array_uget(a, idx) : 0;
+    } else {
+        /* The index must be out of bounds. Otherwise we would be out of memory. */
+        return 0;
+    }
+}
+
+LEAN_EXPORT lean_obj_res lean_uint32_array_push(lean_obj_arg a, uint32_t v);
+LEAN_EXPORT lean_obj_res lean_uint32_array_fill(lean_obj_arg a, uint32_t v);
+
+static inline lean_obj_res lean_uint32_array_uset(lean_obj_arg a, size_t i, uint32_t v) {
+    lean_obj_res r;
+    if (lean_is_exclusive(a)) r = a;
+    else r = lean_copy_uint32_array(a);
+    uint32_t * it = lean_uint32_array_cptr(r) + i;
+    *it = v;
+    return r;
+}
+
+static inline lean_obj_res lean_uint32_array_fset(lean_obj_arg a, b_lean_obj_arg i, uint32_t v) {
+    return lean_uint32_array_uset(a, lean_unbox(i), v);
+}
+
+static inline lean_obj_res lean_uint32_array_set(lean_obj_arg a, b_lean_obj_arg i, uint32_t v) {
+    if (!lean_is_scalar(i)) {
+        return a;
+    } else {
+        size_t idx = lean_unbox(i);
+        if (idx >= lean_sarray_size(a)) {
+            return a;
+        } else {
+            return lean_uint32_array_uset(a, idx, v);
+        }
+    }
+}
+
+/* UInt64Array (special case of Array of Scalars) */
+
+LEAN_EXPORT lean_obj_res lean_uint64_array_mk(lean_obj_arg a);
+LEAN_EXPORT lean_obj_res lean_uint64_array_data(lean_obj_arg a);
+LEAN_EXPORT lean_obj_res lean_copy_uint64_array(lean_obj_arg a);
+
+static inline lean_obj_res lean_mk_empty_uint64_array(b_lean_obj_arg capacity) {
+    if (!lean_is_scalar(capacity)) lean_internal_panic_out_of_memory();
+    return lean_alloc_sarray(sizeof(uint64_t), 0, lean_unbox(capacity)); // NOLINT
+}
+
+static inline lean_obj_res lean_uint64_array_size(b_lean_obj_arg a) {
+    return lean_box(lean_sarray_size(a));
+}
+
+static inline uint64_t * lean_uint64_array_cptr(b_lean_obj_arg a) {
+    return (uint64_t*)(lean_sarray_cptr(a)); // NOLINT
+}
+
+static inline uint64_t lean_uint64_array_uget(b_lean_obj_arg a, size_t i) {
+    return lean_uint64_array_cptr(a)[i];
+}
+
+static inline uint64_t lean_uint64_array_fget(b_lean_obj_arg a, b_lean_obj_arg i) {
+    return lean_uint64_array_uget(a, lean_unbox(i));
+}
+
+static inline uint64_t lean_uint64_array_get(b_lean_obj_arg a, b_lean_obj_arg i) {
+    if (lean_is_scalar(i)) {
+        size_t idx = lean_unbox(i);
+        return idx < lean_sarray_size(a) ? lean_uint64_array_uget(a, idx) : 0;
+    } else {
+        /* The index must be out of bounds. Otherwise we would be out of memory. */
+        return 0;
+    }
+}
+
+LEAN_EXPORT lean_obj_res lean_uint64_array_push(lean_obj_arg a, uint64_t v);
+LEAN_EXPORT lean_obj_res lean_uint64_array_fill(lean_obj_arg a, uint64_t v);
+
+static inline lean_obj_res lean_uint64_array_uset(lean_obj_arg a, size_t i, uint64_t v) {
+    lean_obj_res r;
+    if (lean_is_exclusive(a)) r = a;
+    else r = lean_copy_uint64_array(a);
+    uint64_t * it = lean_uint64_array_cptr(r) + i;
+    *it = v;
+    return r;
+}
+
+static inline lean_obj_res lean_uint64_array_fset(lean_obj_arg a, b_lean_obj_arg i, uint64_t v) {
+    return lean_uint64_array_uset(a, lean_unbox(i), v);
+}
+
+static inline lean_obj_res lean_uint64_array_set(lean_obj_arg a, b_lean_obj_arg i, uint64_t v) {
+    if (!lean_is_scalar(i)) {
+        return a;
+    } else {
+        size_t idx = lean_unbox(i);
+        if (idx >= lean_sarray_size(a)) {
+            return a;
+        } else {
+            return lean_uint64_array_uset(a, idx, v);
+        }
+    }
+}
+
 /* Strings */
 
 static inline lean_obj_res lean_alloc_string(size_t size, size_t capacity, size_t len) {
@@ -1048,6 +1254,7 @@ LEAN_EXPORT bool lean_string_lt(b_lean_obj_arg s1, b_lean_obj_arg s2);
 static inline uint8_t lean_string_dec_eq(b_lean_obj_arg s1, b_lean_obj_arg s2) { return lean_string_eq(s1, s2); }
 static inline uint8_t lean_string_dec_lt(b_lean_obj_arg s1, b_lean_obj_arg s2) { return lean_string_lt(s1, s2); }
 LEAN_EXPORT uint64_t lean_string_hash(b_lean_obj_arg);
+LEAN_EXPORT uint64_t lean_string_hash_with_seed(b_lean_obj_arg, uint64_t seed);
 LEAN_EXPORT lean_obj_res lean_string_of_usize(size_t);
 
 /* Thunks */
@@ -1974,6 +2181,14 @@ LEAN_EXPORT lean_obj_res lean_st_ref_swap(b_lean_obj_arg, lean_obj_arg, lean_obj
 /* pointer address unsafe primitive  */
 static inline size_t lean_ptr_addr(b_lean_obj_arg a) { return (size_t)a; }
 
+/* Expression hash-consing, see `Lean.Expr.setHashConsing`. The flag is accessed with relaxed atomic operations. */
+LEAN_EXPORT extern uint8_t lean_expr_hash_consing;
+LEAN_EXPORT lean_obj_res lean_expr_hash_cons_core(lean_obj_arg e);
+
+static inline lean_obj_res lean_expr_hash_cons(lean_obj_arg e) {
+    return LEAN_LIKELY(!__atomic_load_n(&lean_expr_hash_consing, __ATOMIC_RELAXED)) ? e : lean_expr_hash_cons_core(e);
+}
+
 /* Name primitives */
 LEAN_EXPORT uint8_t lean_name_eq(b_lean_obj_arg n1, b_lean_obj_arg n2);
 
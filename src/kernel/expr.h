@@ -316,6 +316,8 @@ std::ostream & operator<<(std::ostream & out, expr const & e);
 
 void initialize_expr();
 void finalize_expr();
+void initialize_expr_hash_cons();
+void finalize_expr_hash_cons();
 
 /* ================= LEGACY ============== */
 inline bool has_expr_metavar(expr const & e) { return has_expr_mvar(e); }
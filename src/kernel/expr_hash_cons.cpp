@@ -0,0 +1,163 @@
+/*
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#include <mutex>
+#include <vector>
+#include <unordered_set>
+#include "runtime/io.h"
+#include "kernel/expr.h"
+
+/*
+Global hash-consing table for expressions, see `Lean.Expr.setHashConsing`.
+
+When hash-consing is enabled, the expression construction functions (`mkApp`, `mkConst`, ...)
+pass each new node to `lean_expr_hash_cons_core`, which returns an existing equal node if there is one.
+The children of a new node have usually been hash-consed already, so we compare children expressions
+by pointer, and only the other fields (names, levels, literals) structurally. A node whose children
+were not hash-consed is still correct, it is just not shared with equal nodes.
+
+The flag `lean_expr_hash_consing` may be changed while other threads build expressions. It is only a hint: a thread
+that observes a stale value merely hash-conses a few nodes more or less, so relaxed accesses suffice.
+
+The table is shared by all threads, so its nodes are marked as multi-threaded. It is split into
+shards with separate locks. The table holds a reference to each of its nodes. To avoid keeping
+expressions alive, a shard periodically removes the nodes only referenced by the table (see `sweep`).
+*/
+
+extern "C" {
+LEAN_EXPORT uint8_t lean_expr_hash_consing = 0;
+}
+
+namespace lean {
+
+static uint8 get_scalar_flag(object * o) {
+    // `binderInfo` of `lam`/`forallE` and `nonDep` of `letE` are stored after the cached `data` field
+    return lean_ctor_get_uint8(o, lean_ctor_num_objs(o)*sizeof(object*) + sizeof(uint64_t));
+}
+
+struct hash_cons_hash {
+    std::size_t operator()(object * o) const { return hash(TO_REF(expr, o)); }
+};
+
+struct hash_cons_eq {
+    bool operator()(object * o1, object * o2) const {
+        if (o1 == o2) return true;
+        expr const & a = TO_REF(expr, o1);
+        expr const & b = TO_REF(expr, o2);
+        if (a.kind() != b.kind() || hash(a) != hash(b))
+            return false;
+        switch (a.kind()) {
+        case expr_kind::BVar:  return bvar_idx(a) == bvar_idx(b);
+        case expr_kind::FVar:  return fvar_name(a) == fvar_name(b);
+        case expr_kind::MVar:  return mvar_name(a) == mvar_name(b);
+        case expr_kind::Sort:  return sort_level(a) == sort_level(b);
+        case expr_kind::Const: return const_name(a) == const_name(b) && const_levels(a) == const_levels(b);
+        case expr_kind::App:   return is_eqp(app_fn(a), app_fn(b)) && is_eqp(app_arg(a), app_arg(b));
+        case expr_kind::Lambda: case expr_kind::Pi:
+            return
+                is_eqp(binding_domain(a), binding_domain(b)) && is_eqp(binding_body(a), binding_body(b)) &&
+                binding_name(a) == binding_name(b) && get_scalar_flag(o1) == get_scalar_flag(o2);
+        case expr_kind::Let:
+            return
+                is_eqp(let_type(a), let_type(b)) && is_eqp(let_value(a), let_value(b)) &&
+                is_eqp(let_body(a), let_body(b)) && let_name(a) == let_name(b) &&
+                get_scalar_flag(o1) == get_scalar_flag(o2);
+        case expr_kind::Lit:   return lit_value(a) == lit_value(b);
+        case expr_kind::MData: return mdata_data(a).raw() == mdata_data(b).raw() && is_eqp(mdata_expr(a), mdata_expr(b));
+        case expr_kind::Proj:
+            return is_eqp(proj_expr(a), proj_expr(b)) && proj_idx(a) == proj_idx(b) && proj_sname(a) == proj_sname(b);
+        }
+        lean_unreachable();
+    }
+};
+
+static constexpr size_t g_min_sweep_at = 1024;
+
+class hash_cons_shard {
+    std::mutex m_mutex;
+    std::unordered_set<object *, hash_cons_hash, hash_cons_eq> m_nodes;
+    /* Number of nodes at which the next `sweep` happens. */
+    size_t m_sweep_at = g_min_sweep_at;
+
+    /* Removes the nodes only referenced by the table. */
+    void sweep() {
+        std::vector<object *> dead;
+        for (auto it = m_nodes.begin(); it != m_nodes.end();) {
+            object * o = *it;
+            // Another thread can only acquire a new reference to `o` through the table, and we hold the lock.
+            if (__atomic_load_n(&o->m_rc, __ATOMIC_ACQUIRE) == -1) {
+                dead.push_back(o);
+                it = m_nodes.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        for (object * o : dead)
+            lean_dec_ref(o);
+        m_sweep_at = std::max(g_min_sweep_at, 2 * m_nodes.size());
+    }
+public:
+    object * hash_cons(object * e) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_nodes.find(e);
+        if (it != m_nodes.end()) {
+            object * r = *it;
+            lean_inc_ref(r);
+            lean_dec_ref(e);
+            return r;
+        }
+        if (m_nodes.size() >= m_sweep_at)
+            sweep();
+        lean_mark_mt(e);
+        lean_inc_ref(e); // reference of the table
+        m_nodes.insert(e);
+        return e;
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_nodes.size();
+    }
+};
+
+static constexpr unsigned num_hash_cons_shards = 64;
+static hash_cons_shard * g_hash_cons_shards = nullptr;
+
+extern "C" LEAN_EXPORT object * lean_expr_hash_cons_core(object * e) {
+    if (!lean_is_exclusive(e)) {
+        // only new nodes are hash-consed, see `Expr.hashCons`
+        return e;
+    }
+    unsigned h = hash(TO_REF(expr, e));
+    return g_hash_cons_shards[h % num_hash_cons_shards].hash_cons(e);
+}
+
+/* Expr.setHashConsing (enabled : Bool) : BaseIO Unit */
+extern "C" LEAN_EXPORT obj_res lean_expr_set_hash_consing(uint8 enabled, obj_arg) {
+    __atomic_store_n(&lean_expr_hash_consing, enabled, __ATOMIC_RELAXED);
+    return io_result_mk_ok(box(0));
+}
+
+/* Expr.isHashConsing : BaseIO Bool */
+extern "C" LEAN_EXPORT obj_res lean_expr_is_hash_consing(obj_arg) {
+    return io_result_mk_ok(box(__atomic_load_n(&lean_expr_hash_consing, __ATOMIC_RELAXED)));
+}
+
+/* Expr.hashConsTableSize : BaseIO Nat */
+extern "C" LEAN_EXPORT obj_res lean_expr_hash_cons_table_size(obj_arg) {
+    size_t r = 0;
+    for (unsigned i = 0; i < num_hash_cons_shards; i++)
+        r += g_hash_cons_shards[i].size();
+    return io_result_mk_ok(lean_usize_to_nat(r));
+}
+
+void initialize_expr_hash_cons() {
+    g_hash_cons_shards = new hash_cons_shard[num_hash_cons_shards];
+}
+
+void finalize_expr_hash_cons() {
+    // The nodes themselves may still be referenced, so we do not release them.
+    delete[] g_hash_cons_shards;
+}
+}
@@ -18,6 +18,7 @@ namespace lean {
 void initialize_kernel_module() {
     initialize_level();
     initialize_expr();
+    initialize_expr_hash_cons();
     initialize_declaration();
     initialize_type_checker();
     initialize_environment();
@@ -35,6 +36,7 @@ void finalize_kernel_module() {
     finalize_environment();
     finalize_type_checker();
     finalize_declaration();
+    finalize_expr_hash_cons();
     finalize_expr();
     finalize_level();
 }
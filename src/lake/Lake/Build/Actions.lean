@@ -6,6 +6,7 @@ Authors: Gabriel Ebner, Sebastian Ullrich, Mac Malone, Siddharth Bhat
 import Lake.Util.Proc
 import Lake.Util.NativeLib
 import Lake.Util.IO
+import Lake.Build.LeanWorker
 
 /-! # Common Build Actions
 Low level actions to build common Lean artifacts via the Lean toolchain.
@@ -22,7 +23,8 @@ def compileLeanModule
   (leanPath : SearchPath := []) (rootDir : FilePath := ".")
   (dynlibs : Array FilePath := #[]) (dynlibPath : SearchPath := {})
   (leanArgs : Array String := #[]) (lean : FilePath := "lean")
-: LogIO Unit := do
+  (workers? : Option LeanWorkerPool := none)
+: LogIO IO.Process.ResourceUsage := do
   let mut args := leanArgs ++
     #[leanFile.toString, "-R", rootDir.toString]
   if let some oleanFile := oleanFile? then
@@ -37,18 +39,24 @@ def compileLeanModule
   if let some bcFile := bcFile? then
     createParentDirs bcFile
     args := args ++ #["-b", bcFile.toString]
-  for dynlib in dynlibs do
-    args := args.push s!"--load-dynlib={dynlib}"
-  args := args.push "--json"
+  let dynlibArgs := dynlibs.map (s!"--load-dynlib={·}")
+  args := (args ++ dynlibArgs).push "--json"
+  let env := #[
+    ("LEAN_PATH", some leanPath.toString),
+    (sharedLibPathEnvVar, some <| (← getSearchPath sharedLibPathEnvVar) ++ dynlibPath |>.toString)
+  ]
   withLogErrorPos do
-  let out ← rawProc {
-    args
-    cmd := lean.toString
-    env := #[
-      ("LEAN_PATH", leanPath.toString),
-      (sharedLibPathEnvVar, (← getSearchPath sharedLibPathEnvVar) ++ dynlibPath |>.toString)
-    ]
-  }
+  let (out, usage) ←
+    if let some workers := workers? then do
+      -- the module is passed in the request, the rest of the arguments configure the worker
+      let cfg := {lean, args := (leanArgs ++ dynlibArgs).push "--json", env : LeanWorkerConfig}
+      logVerbose s!"{mkCmdLog {cmd := lean.toString, args, env}} (in a build worker)"
+      match (← workers.build cfg leanFile rootDir oleanFile? ileanFile? cFile? bcFile? |>.toBaseIO) with
+      -- the resource usage of a single build in a shared worker process is not available
+      | .ok out => pure (out, ({} : IO.Process.ResourceUsage))
+      | .error err => error s!"failed to build in a Lean build worker: {err}"
+    else
+      rawProcWithUsage {args, cmd := lean.toString, env}
   unless out.stdout.isEmpty do
     let txt ← out.stdout.split (· == '\n') |>.foldlM (init := "") fun txt ln => do
       if let .ok (msg : SerialMessage) := Json.parse ln >>= fromJson? then
@@ -66,6 +74,7 @@ def compileLeanModule
     logInfo s!"stderr:\n{out.stderr}"
   if out.exitCode ≠ 0 then
     error s!"Lean exited with code {out.exitCode}"
+  return usage
 
 def compileO
   (oFile srcFile : FilePath)
@@ -0,0 +1,140 @@
+/-
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+import Lake.Util.Log
+import Lake.Build.Trace
+
+/-! # Artifact Cache
+A local, content-addressed store of build outputs that is shared between
+workspaces (e.g., branches, worktrees, or clean builds of the same project).
+It is enabled by setting `LAKE_ARTIFACT_CACHE` to a directory.
+
+Each entry is a directory named after its key (the hash of the input trace of
+the build that produced it). It contains a copy of each output file
+(named by its role, e.g., `olean`), the build's log (`log.json`), and
+a `used` file whose modification time records when the entry was last
+stored or restored. Files are hard-linked into and out of the cache when
+possible and copied otherwise, so builds must remove an output before
+recreating it (see `buildUnlessUpToDate?`) rather than write to it in place.
+-/
+
+open System Lean
+
+namespace Lake
+
+/-- The description of the outputs of a build to save to (or restore from) an `ArtifactCache`. -/
+structure CachedOutputs where
+  /--
+  The key of the outputs. It must determine their contents
+  (e.g., the hash of the build's input trace).
+  -/
+  key : Hash
+  /-- The output files, each paired with a name unique among them. -/
+  files : Array (String × FilePath)
+
+/-- A handle to a local artifact cache directory. -/
+structure ArtifactCache where
+  /-- The root directory of the cache. -/
+  dir : FilePath
+  /-- The size (in bytes) the cache is trimmed to at the end of a build. -/
+  limit : Nat
+  /-- Whether an entry was stored during this build (i.e., whether to trim the cache). -/
+  dirty : IO.Ref Bool
+
+namespace ArtifactCache
+
+/-- The directory of the entry for `key`. -/
+def entryDir (cache : ArtifactCache) (key : Hash) : FilePath :=
+  cache.dir / key.toString
+
+/-- Creates `dst` as a hard link to `src`, or as a copy if that fails (e.g., across file systems). -/
+def linkOrCopyFile (src dst : FilePath) : IO Unit := do
+  createParentDirs dst
+  removeFileIfExists dst
+  try
+    IO.FS.hardLink src dst
+  catch _ =>
+    IO.FS.writeBinFile dst (← IO.FS.readBinFile src)
+
+/-- Marks the entry in `dir` as recently used (for eviction). -/
+def touchEntry (dir : FilePath) : IO Unit :=
+  IO.FS.writeFile (dir / "used") ""
+
+/--
+Restores the outputs of the entry for `outputs.key` (if any) to their paths.
+Returns the log of the build that produced them on a hit.
+-/
+def restore? (cache : ArtifactCache) (outputs : CachedOutputs) : IO (Option Log) := do
+  let dir := cache.entryDir outputs.key
+  let logFile := dir / "log.json"
+  unless (← logFile.pathExists) do
+    return none
+  let log ← IO.ofExcept <| Json.parse (← IO.FS.readFile logFile) >>= fromJson?
+  for (name, file) in outputs.files do
+    linkOrCopyFile (dir / name) file
+  touchEntry dir
+  return some log
+
+/--
+Saves the files of `outputs` and their build `log` to the cache.
+The entry is assembled in a temporary directory and then renamed into place,
+so concurrent builds never observe a partial entry. If the entry already exists,
+the cache is left as is.
+-/
+def store (cache : ArtifactCache) (outputs : CachedOutputs) (log : Log) : IO Unit := do
+  let dir := cache.entryDir outputs.key
+  if (← dir.pathExists) then
+    return
+  let tmpDir := cache.dir / s!".tmp-{outputs.key}-{← IO.monoNanosNow}"
+  IO.FS.createDirAll tmpDir
+  try
+    for (name, file) in outputs.files do
+      linkOrCopyFile file (tmpDir / name)
+    IO.FS.writeFile (tmpDir / "log.json") (toJson log).compress
+    touchEntry tmpDir
+    try
+      IO.FS.rename tmpDir dir
+      cache.dirty.set true
+    catch e =>
+      -- another build may have stored the same entry concurrently
+      unless (← dir.pathExists) do throw e
+  finally
+    if (← tmpDir.pathExists) then
+      IO.FS.removeDirAll tmpDir
+
+/-- Computes the total size (in bytes) of the files in an entry directory. -/
+def entrySize (dir : FilePath) : IO Nat := do
+  (← dir.readDir).foldlM (init := 0) fun size ent => do
+    return size + (← ent.path.metadata).byteSize.toNat
+
+/--
+Evicts the least recently used entries until the cache's total size is at
+most its `limit`. Does nothing if no entry was stored since the last trim.
+Entries that vanish or cannot be inspected (e.g., due to a concurrent trim
+by another process) are skipped.
+-/
+def trim (cache : ArtifactCache) : IO Unit := do
+  unless (← cache.dirty.swap false) do
+    return
+  let mut entries : Array (IO.FS.SystemTime × Nat × FilePath) := #[]
+  let mut total := 0
+  for ent in (← cache.dir.readDir) do
+    if ent.fileName.startsWith "." then
+      continue
+    let .ok used ← (ent.path / "used").metadata.toBaseIO
+      | continue
+    let .ok size ← (entrySize ent.path).toBaseIO
+      | continue
+    entries := entries.push (used.modified, size, ent.path)
+    total := total + size
+  if total ≤ cache.limit then
+    return
+  let entries := entries.qsort (·.1 < ·.1)
+  for (_, size, dir) in entries do
+    if total ≤ cache.limit then
+      break
+    if (← (IO.FS.removeDirAll dir).toBaseIO) matches .ok _ then
+      total := total - size
+
+end ArtifactCache
@@ -8,6 +8,9 @@ import Lake.Util.Exit
 import Lake.Util.Lift
 import Lake.Config.Context
 import Lake.Build.Trace
+import Lake.Build.ArtifactCache
+import Lake.Build.Schedule
+import Lake.Build.LeanWorker
 
 open System
 namespace Lake
@@ -39,6 +42,17 @@ structure BuildConfig where
   out : OutStream := .stderr
   /-- Whether to use ANSI escape codes in build output. -/
   ansiMode : AnsiMode := .auto
+  /--
+  Whether to write a report of the module jobs of the build (e.g., their timing
+  and resource use) to `report.json` in the root package's build directory
+  and print a summary of it.
+  -/
+  report : Bool := false
+  /--
+  Whether to elaborate modules in long-lived `lean --build-worker` processes
+  (see `LeanWorkerPool`) rather than in a new `lean` process per module.
+  -/
+  leanWorkers : Bool := false
 
 /--
 Whether the build should show progress information.
@@ -72,6 +86,12 @@ abbrev OpaqueJob := JobCore OpaqueJobTask
 structure BuildContext extends BuildConfig, Context where
   leanTrace : BuildTrace
   registeredJobs : IO.Ref (Array OpaqueJob)
+  /-- The local artifact cache to reuse build outputs from (if enabled). -/
+  artifactCache? : Option ArtifactCache := none
+  /-- The module timings and job priorities of the build. -/
+  schedule : BuildSchedule
+  /-- The Lean build workers to elaborate modules in (if enabled). -/
+  leanWorkers? : Option LeanWorkerPool := none
 
 /-- A transformer to equip a monad with a `BuildContext`. -/
 abbrev BuildT := ReaderT BuildContext
@@ -86,6 +106,15 @@ abbrev MonadBuild (m : Type → Type u) :=
 @[inline] def getLeanTrace [Functor m] [MonadBuild m] : m BuildTrace :=
   (·.leanTrace) <$> getBuildContext
 
+@[inline] def getArtifactCache? [Functor m] [MonadBuild m] : m (Option ArtifactCache) :=
+  (·.artifactCache?) <$> getBuildContext
+
+@[inline] def getBuildSchedule [Functor m] [MonadBuild m] : m BuildSchedule :=
+  (·.schedule) <$> getBuildContext
+
+@[inline] def getLeanWorkers? [Functor m] [MonadBuild m] : m (Option LeanWorkerPool) :=
+  (·.leanWorkers?) <$> getBuildContext
+
 @[inline] def getBuildConfig [Functor m] [MonadBuild m] : m BuildConfig :=
   (·.toBuildConfig) <$> getBuildContext
 
@@ -95,11 +95,20 @@ If up-to-date, replay the build log stored in `traceFile`.
 
 If `traceFile` does not exist, checks that `info` has a newer modification time
 then `depTrace` / `oldTrace`. No log will be replayed.
+
+**Artifact Cache**
+
+If `cached?` describes the output files of `build` and an `ArtifactCache` is
+enabled, an out-of-date `info` is first restored from the cache entry of
+`cached?.key` (replaying its log). On a miss, the outputs are saved to the cache
+after `build`. Outputs are removed before `build` runs as they may be links to
+files in the cache.
 -/
 @[specialize] def buildUnlessUpToDate?
   [CheckExists ι] [GetMTime ι] (info : ι)
   (depTrace : BuildTrace) (traceFile : FilePath) (build : JobM PUnit)
   (action : JobAction := .build) (oldTrace := depTrace.mtime)
+  (cached? : Option CachedOutputs := none)
 : JobM Bool := do
   if (← traceFile.pathExists) then
     if let some data ← readTraceFile? traceFile then
@@ -120,14 +129,30 @@ then `depTrace` / `oldTrace`. No log will be replayed.
       go
 where
   go := do
+    if let some cached := cached? then
+      if let some cache ← getArtifactCache? then
+        match (← (cache.restore? cached).toBaseIO) with
+        | .ok (some log) =>
+          updateAction .fetch
+          log.replay
+          writeTraceFile traceFile depTrace log
+          return false
+        | .ok none => pure ()
+        | .error e => logVerbose s!"{traceFile}: failed to restore from artifact cache: {e}"
     if (← getNoBuild) then
       IO.Process.exit noBuildCode.toUInt8
     else
       updateAction action
       let iniPos ← getLogPos
+      if let some cached := cached? then
+        cached.files.forM fun (_, file) => removeFileIfExists file
       build -- fatal errors will not produce a trace (or cache their log)
       let log := (← getLog).takeFrom iniPos
       writeTraceFile traceFile depTrace log
+      if let some cached := cached? then
+        if let some cache ← getArtifactCache? then
+          if let .error e ← (cache.store cached log).toBaseIO then
+            logWarning s!"{traceFile}: failed to save to artifact cache: {e}"
       return false
 
 /--
@@ -141,8 +166,9 @@ See `buildUnlessUpToDate?` for more details on how Lake determines whether
   [CheckExists ι] [GetMTime ι] (info : ι)
   (depTrace : BuildTrace) (traceFile : FilePath) (build : JobM PUnit)
   (action : JobAction := .build) (oldTrace := depTrace.mtime)
+  (cached? : Option CachedOutputs := none)
 : JobM PUnit := do
-  discard <| buildUnlessUpToDate? info depTrace traceFile build action oldTrace
+  discard <| buildUnlessUpToDate? info depTrace traceFile build action oldTrace cached?
 
 /-- Computes the hash of a file and saves it to a `.hash` file. -/
 def cacheFileHash (file : FilePath) : IO Unit := do
@@ -152,12 +178,8 @@ def cacheFileHash (file : FilePath) : IO Unit := do
   IO.FS.writeFile hashFile hash.toString
 
 /-- Remove the cached hash of a file (its `.hash` file). -/
-def clearFileHash (file : FilePath) : IO Unit := do
-  try
-    IO.FS.removeFile <| file.toString ++ ".hash"
-  catch
-    | .noFileOrDirectory .. => pure ()
-    | e => throw e
+def clearFileHash (file : FilePath) : IO Unit :=
+  removeFileIfExists <| file.toString ++ ".hash"
 
 /--
 Fetches the hash of a file that may already be cached in a `.hash` file.
@@ -191,13 +213,20 @@ a `.log.json` file and replayed from there if the build is skipped.
 For example, given `file := "foo.c"`, compares `depTrace` with that in
 `foo.c.trace` with the hash cached in `foo.c.hash` and the log cached in
 `foo.c.trace`.
+
+If `cache` is set, `file` is shared through the artifact cache (if enabled)
+keyed by `depTrace` and the file's extension. This is only sound if
+`depTrace` determines the contents of `file` independently of its location.
 -/
 def buildFileUnlessUpToDate
-  (file : FilePath) (depTrace : BuildTrace) (build : JobM PUnit)
+  (file : FilePath) (depTrace : BuildTrace) (build : JobM PUnit) (cache := false)
 : JobM BuildTrace := do
   let traceFile := FilePath.mk <| file.toString ++ ".trace"
-  buildUnlessUpToDate file depTrace traceFile do
-    build
+  let cached? : Option CachedOutputs := if cache then
+    some {key := depTrace.hash.mix <| .ofString (file.extension.getD ""), files := #[("out", file)]}
+  else
+    none
+  unless (← buildUnlessUpToDate? file depTrace traceFile build (cached? := cached?)) do
     clearFileHash file
   fetchFileTrace file
 
@@ -207,11 +236,11 @@ trace (and/or `extraDepTrace`) has changed.
 -/
 @[inline] def buildFileAfterDep
   (file : FilePath) (dep : BuildJob α) (build : α → JobM PUnit)
-  (extraDepTrace : JobM _ := pure BuildTrace.nil)
+  (extraDepTrace : JobM _ := pure BuildTrace.nil) (cache := false)
 : SpawnM (BuildJob FilePath) :=
   dep.bindSync fun depInfo depTrace => do
     let depTrace := depTrace.mix (← extraDepTrace)
-    let trace ← buildFileUnlessUpToDate file depTrace <| build depInfo
+    let trace ← buildFileUnlessUpToDate file depTrace (build depInfo) cache
     return (file, trace)
 
 /-- Build `file` using `build` after `deps` have built if any of their traces change. -/
@@ -284,7 +313,7 @@ which will be computed in the resulting `BuildJob` before building.
 : SpawnM (BuildJob FilePath) :=
   let extraDepTrace :=
     return (← getLeanTrace).mix <| (pureHash traceArgs).mix platformTrace
-  buildFileAfterDep oFile srcJob (extraDepTrace := extraDepTrace) fun srcFile => do
+  buildFileAfterDep oFile srcJob (extraDepTrace := extraDepTrace) (cache := true) fun srcFile => do
      compileO oFile srcFile (weakArgs ++ traceArgs) (← getLeanc)
 
 /-- Build a static library from object file jobs using the `ar` packaged with Lean. -/
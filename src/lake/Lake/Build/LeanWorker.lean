@@ -0,0 +1,153 @@
+/-
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+import Lake.Util.Log
+
+/-! # Lean Build Workers
+With `lake build --lean-workers`, Lake elaborates modules in long-lived
+`lean --build-worker` processes instead of spawning a fresh `lean` for each
+module. A worker reads the `.olean` files of imports only once, which avoids
+most of the startup cost of a module build in workspaces with many small modules.
+
+A worker is configured by its command line and environment, which are shared
+by all modules it builds. Each request names the module's file, its root
+directory, and its output files (see `lean --help`). Lean's output for the
+request is followed by `LeanWorker.doneMarker` and the exit code on stdout,
+and by `LeanWorker.doneMarker` on stderr.
+-/
+
+open System
+
+namespace Lake
+
+/-- The process configuration of a Lean build worker. Modules share workers only if they agree on it. -/
+structure LeanWorkerConfig where
+  /-- The `lean` executable. -/
+  lean : FilePath
+  /-- The arguments of the worker (e.g., options and dynlibs to load). -/
+  args : Array String
+  /-- The environment of the worker (e.g., the `LEAN_PATH`). -/
+  env : Array (String × Option String)
+  deriving BEq, Hashable
+
+/-- A `lean --build-worker` process. -/
+structure LeanWorker where
+  /-- The worker process. -/
+  child : IO.Process.Child {stdin := .piped, stdout := .piped, stderr := .piped}
+
+namespace LeanWorker
+
+/--
+The character that ends the output of a request. It is not necessarily at the
+beginning of a line, as the output may not end with a newline.
+-/
+def doneMarker : Char := '\x1e'
+
+/-- Starts a new worker. -/
+def spawn (cfg : LeanWorkerConfig) : IO LeanWorker := do
+  let child ← IO.Process.spawn {
+    cmd := cfg.lean.toString
+    args := cfg.args.push "--build-worker"
+    env := cfg.env
+    stdin := .piped, stdout := .piped, stderr := .piped
+  }
+  return {child}
+
+/--
+Reads the output of the worker's current request from `h` up to `doneMarker`.
+Returns the output and the rest of the line after the marker.
+-/
+private partial def readUntilDone (h : IO.FS.Handle) (out : String := "") : IO (String × String) := do
+  let line ← h.getLine
+  if line.isEmpty then
+    throw <| IO.userError "Lean build worker exited unexpectedly"
+  let pos := line.posOf doneMarker
+  if pos < line.endPos then
+    return (out ++ line.extract 0 pos, line.extract (line.next pos) line.endPos)
+  readUntilDone h (out ++ line)
+
+/-- Reads the output of the worker's current request (see `build`). -/
+private def readOutput (worker : LeanWorker) : IO IO.Process.Output := do
+  -- read stderr concurrently, so that the worker cannot block on a full stderr pipe
+  let stderr ← IO.asTask (prio := .dedicated) <| readUntilDone worker.child.stderr
+  let (stdout, exitCode) ← readUntilDone worker.child.stdout
+  let (stderr, _) ← IO.ofExcept stderr.get
+  let some exitCode := exitCode.trim.toNat?
+    | throw <| IO.userError s!"Lean build worker sent an invalid exit code: {exitCode}"
+  return {exitCode := exitCode.toUInt32, stdout, stderr}
+
+/--
+Builds the module `leanFile` (with the given root directory and output files).
+Returns the output of Lean for the build.
+-/
+def build
+  (worker : LeanWorker) (leanFile rootDir : FilePath)
+  (oleanFile? ileanFile? cFile? bcFile? : Option FilePath)
+: IO IO.Process.Output := do
+  let field (file? : Option FilePath) := file?.map (·.toString) |>.getD ""
+  let request := "\t".intercalate [
+    leanFile.toString, rootDir.toString,
+    field oleanFile?, field ileanFile?, field cFile?, field bcFile?
+  ]
+  worker.child.stdin.putStrLn request
+  worker.child.stdin.flush
+  worker.readOutput
+
+/-- Asks the worker to exit and waits for it to do so. -/
+def shutdown (worker : LeanWorker) : IO Unit := do
+  worker.child.stdin.putStrLn ""
+  worker.child.stdin.flush
+  discard <| worker.child.wait
+
+end LeanWorker
+
+/-- The Lean build workers of a build, started on demand. -/
+structure LeanWorkerPool where
+  /-- The workers not currently building a module, by configuration. -/
+  idle : IO.Ref (Lean.HashMap LeanWorkerConfig (Array LeanWorker))
+  /-- All workers started by the build. -/
+  workers : IO.Ref (Array LeanWorker)
+
+namespace LeanWorkerPool
+
+/-- Creates an empty pool. -/
+def new : BaseIO LeanWorkerPool :=
+  return {idle := ← IO.mkRef {}, workers := ← IO.mkRef #[]}
+
+/-- Takes an idle worker with configuration `cfg` from the pool, or starts a new one. -/
+def acquire (pool : LeanWorkerPool) (cfg : LeanWorkerConfig) : IO LeanWorker := do
+  let worker? ← pool.idle.modifyGet fun idle =>
+    let workers := idle.findD cfg #[]
+    (workers.back?, idle.insert cfg workers.pop)
+  if let some worker := worker? then
+    return worker
+  let worker ← LeanWorker.spawn cfg
+  pool.workers.modify (·.push worker)
+  return worker
+
+/-- Returns a worker acquired with `cfg` to the pool. -/
+def release (pool : LeanWorkerPool) (cfg : LeanWorkerConfig) (worker : LeanWorker) : BaseIO Unit :=
+  pool.idle.modify fun idle => idle.insert cfg <| (idle.findD cfg #[]).push worker
+
+/--
+Builds a module in a worker with configuration `cfg` (see `LeanWorker.build`).
+If the build fails with an I/O error (e.g., because the worker crashed),
+the worker is not reused.
+-/
+def build
+  (pool : LeanWorkerPool) (cfg : LeanWorkerConfig) (leanFile rootDir : FilePath)
+  (oleanFile? ileanFile? cFile? bcFile? : Option FilePath)
+: IO IO.Process.Output := do
+  let worker ← pool.acquire cfg
+  let out ← worker.build leanFile rootDir oleanFile? ileanFile? cFile? bcFile?
+  pool.release cfg worker
+  return out
+
+/-- Shuts down all workers of the pool. Errors (e.g., of workers that already exited) are ignored. -/
+def shutdown (pool : LeanWorkerPool) : BaseIO Unit := do
+  for worker in (← pool.workers.swap #[]) do
+    discard <| worker.shutdown.toBaseIO
+  pool.idle.set {}
+
+end LeanWorkerPool
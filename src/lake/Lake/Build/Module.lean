@@ -158,23 +158,53 @@ def Module.cacheOutputHashes (mod : Module) : IO PUnit := do
   if Lean.Internal.hasLLVMBackend () then
     cacheFileHash mod.bcFile
 
+/--
+The module build outputs to share through the artifact cache (if enabled),
+keyed by the module's input trace and name.
+-/
+def Module.cachedOutputs (mod : Module) (modTrace : BuildTrace) : CachedOutputs :=
+  let files := #[("olean", mod.oleanFile), ("ilean", mod.ileanFile), ("c", mod.cFile)]
+  let files := if Lean.Internal.hasLLVMBackend () then files.push ("bc", mod.bcFile) else files
+  {key := modTrace.hash.mix <| .ofString mod.name.toString, files}
+
 /--
 Recursively build a Lean module.
 Fetch its dependencies and then elaborate the Lean source file, producing
 all possible artifacts (i.e., `.olean`, `ilean`, `.c`, and `.bc`).
+
+The job is prioritized by the module's position on the critical path
+estimated from previous builds, and records its elaboration time for
+future ones (see `BuildSchedule`).
 -/
 def Module.recBuildLean (mod : Module) : FetchM (BuildJob Unit) := do
   withRegisterJob mod.name.toString do
-  (← mod.deps.fetch).bindSync fun (dynlibPath, dynlibs) depTrace => do
+  let imports := (← mod.imports.fetch).map (·.name)
+  let schedule ← getBuildSchedule
+  let spawned ← schedule.now
+  (← mod.deps.fetch).bindSync (prio := schedule.priority mod.name) fun (dynlibPath, dynlibs) depTrace => do
+    let start ← schedule.now
     let argTrace : BuildTrace := pureHash mod.leanArgs
     let srcTrace : BuildTrace ← computeTrace { path := mod.leanFile : TextFilePath }
     let modTrace := (← getLeanTrace).mix <| argTrace.mix <| srcTrace.mix depTrace
-    let upToDate ← buildUnlessUpToDate? (oldTrace := srcTrace.mtime) mod modTrace mod.traceFile do
-      compileLeanModule mod.leanFile mod.oleanFile mod.ileanFile mod.cFile mod.bcFile?
+    let elab ← IO.mkRef (none : Option (Nat × IO.Process.ResourceUsage))
+    let upToDate ← buildUnlessUpToDate? (oldTrace := srcTrace.mtime)
+      (cached? := mod.cachedOutputs modTrace) mod modTrace mod.traceFile do
+      let elabStart ← IO.monoMsNow
+      let usage ← compileLeanModule mod.leanFile mod.oleanFile mod.ileanFile mod.cFile mod.bcFile?
         (← getLeanPath) mod.rootDir dynlibs dynlibPath (mod.weakLeanArgs ++ mod.leanArgs) (← getLean)
+        (← getLeanWorkers?)
+      elab.set <| some ((← IO.monoMsNow) - elabStart, usage)
       mod.clearOutputHashes
     unless upToDate && (← getTrustHash) do
       mod.cacheOutputHashes
+    let elab? ← elab.get
+    let time := elab?.map (·.1) |>.getD (schedule.prevTime mod.name)
+    let usage := elab?.map (·.2) |>.getD {}
+    schedule.record {name := mod.name, time, imports} {
+      name := mod.name, spawned, start, finish := ← schedule.now, built := elab?.isSome
+      cpuTime := (usage.userTime + usage.systemTime).toNat / 1000
+      maxRss := usage.maxRss.toNat
+    }
     return ((), depTrace)
 
 /-- The `ModuleFacetConfig` for the builtin `leanArtsFacet`. -/
@@ -0,0 +1,132 @@
+/-
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+import Lake.Build.Schedule
+
+/-! # Build Reports
+A build report (produced by `lake build --report`) summarizes how the module
+jobs of a build were scheduled: when each started and finished, how long it
+was blocked on its imports or waiting for a free thread, and the resources
+used by its `lean` process. It also identifies the critical path through the
+modules elaborated by the build and the modules on it whose splitting would
+shorten it the most.
+-/
+
+open System Lean
+
+namespace Lake
+
+/-- A module job in a build report. Times are in milliseconds since the start of the build. -/
+structure ModuleJobReport where
+  /-- The name of the module. -/
+  name : Name
+  /-- When the job was created. -/
+  spawned : Nat
+  /-- When the job started running. -/
+  start : Nat
+  /-- When the job finished. -/
+  finish : Nat
+  /-- How long (in milliseconds) the job was blocked on the jobs of its imports. -/
+  blocked : Nat
+  /-- How long (in milliseconds) the job waited for a thread after its imports finished. -/
+  queued : Nat
+  /-- Whether `lean` elaborated the module. -/
+  built : Bool
+  /-- The wall time (in milliseconds) of elaborating the module (`0` if not elaborated). -/
+  elabTime : Nat
+  /-- The CPU time (in milliseconds) of the `lean` process. -/
+  cpuTime : Nat
+  /-- The peak resident set size (in bytes) of the `lean` process. -/
+  maxRss : Nat
+  deriving Inhabited, ToJson
+
+/-- A module on the critical path whose splitting would shorten it. -/
+structure SplitCandidate where
+  /-- The name of the module. -/
+  module : Name
+  /-- The elaboration time (in milliseconds) of the module. -/
+  time : Nat
+  /--
+  By how much (in milliseconds) the critical path would shorten if the module
+  were split into two halves that can be elaborated in parallel.
+  -/
+  savings : Nat
+  deriving Inhabited, ToJson
+
+/-- The report of a build. -/
+structure BuildReport where
+  /-- The wall time (in milliseconds) of the build. -/
+  wallTime : Nat
+  /-- The module jobs of the build, in order of their start. -/
+  jobs : Array ModuleJobReport
+  /-- The critical path through the modules elaborated by the build, in build order. -/
+  criticalPath : Array Name
+  /-- The length (in milliseconds) of `criticalPath`. -/
+  criticalPathTime : Nat
+  /-- The modules on the critical path whose splitting would shorten it the most. -/
+  splitCandidates : Array SplitCandidate
+  deriving Inhabited, ToJson
+
+/-- The maximum number of split candidates in a report. -/
+def maxSplitCandidates : Nat := 5
+
+namespace BuildReport
+
+/-- Computes the report of a build from its schedule. -/
+def compute (schedule : BuildSchedule) : BaseIO BuildReport := do
+  let wallTime ← schedule.now
+  let timings ← schedule.timings.get
+  let jobs ← schedule.jobs.get
+  let finishes : NameMap Nat := jobs.foldl (init := {}) fun m job => m.insert job.name job.finish
+  let jobs := jobs.qsort (·.start < ·.start) |>.map fun job =>
+    let imports := timings.find? job.name |>.map (·.imports) |>.getD #[]
+    let importsDone := imports.foldl (init := job.spawned) fun t imp => max t (finishes.findD imp 0)
+    let importsDone := min importsDone job.start
+    let elabTime := if job.built then timings.find? job.name |>.map (·.time) |>.getD 0 else 0
+    {
+      name := job.name, spawned := job.spawned, start := job.start, finish := job.finish
+      blocked := importsDone - job.spawned, queued := job.start - importsDone
+      built := job.built, elabTime, cpuTime := job.cpuTime, maxRss := job.maxRss
+      : ModuleJobReport
+    }
+  let built := jobs.foldl (init := ({} : NameSet)) fun s job => if job.built then s.insert job.name else s
+  let builtTimings := timings.restrict built
+  let criticalPath := builtTimings.criticalPath
+  let criticalPathTime := builtTimings.criticalPathTime
+  let splitCandidates : Array SplitCandidate := criticalPath.filterMap fun module => do
+    let t ← builtTimings.find? module
+    let split := builtTimings.insert module {t with time := t.time - t.time / 2}
+    let savings := criticalPathTime - split.criticalPathTime
+    if savings = 0 then none else some {module, time := t.time, savings}
+  let splitCandidates := splitCandidates.qsort (·.savings > ·.savings) |>.extract 0 maxSplitCandidates
+  return {wallTime, jobs, criticalPath, criticalPathTime, splitCandidates}
+
+/-- A human-readable summary of the report. -/
+def summary (self : BuildReport) : String := Id.run do
+  let built := self.jobs.filter (·.built)
+  let busyTime := built.foldl (init := 0) (· + ·.elabTime)
+  let parallelism := if self.wallTime = 0 then 0 else busyTime * 10 / self.wallTime
+  let mut out := s!"Build report: {formatMs self.wallTime} wall time, \
+    {self.jobs.size} module jobs ({built.size} elaborated), \
+    average parallelism {parallelism / 10}.{parallelism % 10}\n"
+  unless self.criticalPath.isEmpty do
+    let elabTimes : NameMap Nat := built.foldl (init := {}) fun m job => m.insert job.name job.elabTime
+    let path := self.criticalPath.toList.map fun mod => s!"{mod} ({formatMs <| elabTimes.findD mod 0})"
+    out := out ++ s!"Critical path ({formatMs self.criticalPathTime}): {" → ".intercalate path}\n"
+  unless self.splitCandidates.isEmpty do
+    out := out ++ "Splitting these modules would shorten the critical path the most:\n"
+    for c in self.splitCandidates do
+      out := out ++ s!"- {c.module} ({formatMs c.time}): up to {formatMs c.savings} shorter\n"
+  let maxRssJob? := built.foldl (init := none) fun max? job =>
+    if job.maxRss > (max?.map (·.maxRss) |>.getD 0) then some job else max?
+  if let some job := maxRssJob? then
+    out := out ++ s!"Largest peak memory use: {job.name} ({job.maxRss / (1024 * 1024)} MiB)\n"
+  return out
+
+/-- Writes the report to `file` as JSON. -/
+def save (self : BuildReport) (file : FilePath) : IO Unit := do
+  createParentDirs file
+  IO.FS.writeFile file (toJson self).pretty
+
+end BuildReport
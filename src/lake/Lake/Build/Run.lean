@@ -5,6 +5,7 @@ Authors: Mac Malone, Gabriel Ebner, Sebastian Ullrich
 -/
 import Lake.Util.Lock
 import Lake.Build.Index
+import Lake.Build.Report
 
 /-! # Build Runner
 
@@ -23,6 +24,10 @@ def mkBuildContext (ws : Workspace) (config : BuildConfig) : BaseIO BuildContext
     toBuildConfig := config,
     registeredJobs := ← IO.mkRef #[],
     leanTrace := Hash.ofString ws.lakeEnv.leanGithash
+    artifactCache? := ← ws.lakeEnv.artifactCacheDir?.mapM fun dir => do
+      return {dir, limit := ws.lakeEnv.artifactCacheLimit, dirty := ← IO.mkRef false}
+    schedule := ← BuildSchedule.load (ws.root.buildDir / "timings.json")
+    leanWorkers? := ← if config.leanWorkers then some <$> LeanWorkerPool.new else pure none
   }
 
 /-- Unicode icons that make up the spinner in animation order. -/
@@ -230,6 +235,29 @@ def Workspace.runFetchM
   let minAction := if cfg.verbosity = .verbose then .unknown else .fetch
   let failures ← monitorJobs jobs out failLv outLv minAction useAnsi showProgress
     (resetCtrl := resetCtrl) (initFailures := failures)
+  if let some workers := ctx.leanWorkers? then
+    workers.shutdown
+  -- Build Timings
+  if let .error e ← ctx.schedule.save.toBaseIO then
+    print! out s!"warning: failed to save module build timings: {e}\n"
+  if cfg.verbosity == .verbose then
+    if let some (predicted, actual) ← ctx.schedule.builtCriticalPaths? then
+      let total ← ctx.schedule.now
+      print! out s!"Critical path of built modules: {formatMs actual} \
+        (predicted {formatMs predicted}); total build time: {formatMs total}\n"
+  if cfg.report then
+    let report ← BuildReport.compute ctx.schedule
+    let reportFile := ws.root.buildDir / "report.json"
+    if let .error e ← (report.save reportFile).toBaseIO then
+      print! out s!"warning: failed to write build report: {e}\n"
+    print! out report.summary
+    print! out s!"Full report written to '{reportFile}'\n"
+  flush out
+  -- Artifact Cache
+  if let some cache := ctx.artifactCache? then
+    if let .error e ← cache.trim.toBaseIO then
+      print! out s!"warning: failed to trim the artifact cache: {e}\n"
+      flush out
   -- Failure Report
   if failures.isEmpty then
     let some a := a?
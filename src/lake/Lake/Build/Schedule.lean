@@ -0,0 +1,224 @@
+/-
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+import Lean.Data.Json
+import Lean.Data.NameMap
+import Lake.Util.IO
+
+/-! # Build Scheduling
+Lake records how long each module took to elaborate (in `timings.json` in the
+root package's build directory). Later builds use these timings to estimate
+the critical path of the import graph and spawn module jobs with task
+priorities proportional to the length of the longest chain of builds still
+waiting on them, so that the Lean task manager starts the modules on the
+critical path first.
+-/
+
+open System Lean
+
+namespace Lake
+
+/-- Information recorded about a module's build, used to estimate critical paths. -/
+structure ModuleTiming where
+  /-- The name of the module. -/
+  name : Name
+  /-- The time (in milliseconds) the module last took to elaborate. -/
+  time : Nat
+  /-- The names of the module's direct local imports. -/
+  imports : Array Name
+  deriving Inhabited, ToJson, FromJson
+
+/-- Module timings indexed by module name. -/
+abbrev ModuleTimings := NameMap ModuleTiming
+
+namespace ModuleTimings
+
+/-- Reads timings from `file`. Returns no timings if the file is missing or invalid. -/
+def load (file : FilePath) : BaseIO ModuleTimings := do
+  let .ok contents ← IO.FS.readFile file |>.toBaseIO
+    | return {}
+  let .ok (entries : Array ModuleTiming) := Json.parse contents >>= fromJson?
+    | return {}
+  return entries.foldl (init := {}) fun timings t => timings.insert t.name t
+
+/-- Writes timings to `file`. -/
+def save (file : FilePath) (timings : ModuleTimings) : IO Unit := do
+  createParentDirs file
+  let entries := timings.fold (init := #[]) fun entries _ t => entries.push t
+  IO.FS.writeFile file (toJson entries).compress
+
+/-- Restricts the timings to the modules in `names` (and the imports between them). -/
+def restrict (timings : ModuleTimings) (names : NameSet) : ModuleTimings :=
+  timings.fold (init := {}) fun restricted name t =>
+    if names.contains name then
+      restricted.insert name {t with imports := t.imports.filter names.contains}
+    else
+      restricted
+
+private partial def tailOf
+  (timings : ModuleTimings) (dependents : NameMap (Array Name)) (name : Name)
+: StateM (NameMap Nat) Nat := do
+  if let some tail := (← get).find? name then
+    return tail
+  modify (·.insert name 0) -- cut cycles (which can only stem from stale timings)
+  let mut tail := 0
+  for dep in dependents.findD name #[] do
+    tail := max tail (← tailOf timings dependents dep)
+  let tail := tail + (timings.find? name |>.map (·.time) |>.getD 0)
+  modify (·.insert name tail)
+  return tail
+
+/-- Maps each module to the modules that directly import it. -/
+def dependents (timings : ModuleTimings) : NameMap (Array Name) := Id.run do
+  let mut dependents : NameMap (Array Name) := {}
+  for (name, t) in timings do
+    for imp in t.imports do
+      dependents := dependents.insert imp <| (dependents.findD imp #[]).push name
+  return dependents
+
+/--
+Computes the *tail* of each module: the estimated time from the start of its
+build to the end of the longest chain of builds of modules importing it
+(including itself). The largest tail is the length of the critical path.
+-/
+def tails (timings : ModuleTimings) : NameMap Nat :=
+  let dependents := timings.dependents
+  let go := timings.forM fun name _ => discard <| tailOf timings dependents name
+  (go.run {}).2
+
+/-- The estimated length (in milliseconds) of the critical path through the modules. -/
+def criticalPathTime (timings : ModuleTimings) : Nat :=
+  timings.tails.fold (init := 0) fun m _ tail => max m tail
+
+/-- Returns the name with the largest value in `tails` among `names` (if any). -/
+private def maxTailOf (tails : NameMap Nat) (names : Array Name) : Option Name :=
+  Prod.fst <$> names.foldl (init := none) fun best name =>
+    let tail := tails.findD name 0
+    match best with
+    | some (_, bestTail) => if tail > bestTail then some (name, tail) else best
+    | none => some (name, tail)
+
+/-- The modules on the critical path through the modules, in build order. -/
+def criticalPath (timings : ModuleTimings) : Array Name := Id.run do
+  let tails := timings.tails
+  let dependents := timings.dependents
+  let some first := maxTailOf tails (timings.fold (init := #[]) fun ns n _ => ns.push n)
+    | return #[]
+  let mut path := #[first]
+  let mut cur := first
+  for _ in [0:timings.size] do -- bounded in case of cycles
+    let some next := maxTailOf tails (dependents.findD cur #[])
+      | break
+    path := path.push next
+    cur := next
+  return path
+
+end ModuleTimings
+
+/-- Formats a duration given in milliseconds (e.g., `12.3s`). -/
+def formatMs (ms : Nat) : String :=
+  s!"{ms / 1000}.{ms % 1000 / 100}s"
+
+/--
+What happened in the build job of a module.
+Times are in milliseconds since the start of the build.
+-/
+structure ModuleJob where
+  /-- The name of the module. -/
+  name : Name
+  /-- When the job was created (i.e., before any of its dependencies were built). -/
+  spawned : Nat
+  /-- When the job started running. -/
+  start : Nat
+  /-- When the job finished. -/
+  finish : Nat
+  /-- Whether `lean` elaborated the module (rather than it being up-to-date or restored). -/
+  built : Bool
+  /-- The CPU time (user and system, in milliseconds) of the `lean` process. -/
+  cpuTime : Nat := 0
+  /-- The peak resident set size (in bytes) of the `lean` process. -/
+  maxRss : Nat := 0
+  deriving Inhabited, ToJson, FromJson
+
+/-- The scheduling state of a build. -/
+structure BuildSchedule where
+  /-- The file module timings are persisted to. -/
+  file : FilePath
+  /-- The module timings recorded by previous builds. -/
+  prevTimings : ModuleTimings := {}
+  /-- The tails (see `ModuleTimings.tails`) of the modules according to `prevTimings`. -/
+  tails : NameMap Nat := {}
+  /-- The largest of `tails`. -/
+  maxTail : Nat := 0
+  /-- The monotonic time (in milliseconds) at which the build started. -/
+  startTime : Nat
+  /-- The timings of the modules visited by this build. -/
+  timings : IO.Ref ModuleTimings
+  /-- The module jobs run by this build. -/
+  jobs : IO.Ref (Array ModuleJob)
+
+namespace BuildSchedule
+
+/-- Creates the schedule of a build from the timings persisted in `file`. -/
+def load (file : FilePath) : BaseIO BuildSchedule := do
+  let prevTimings ← ModuleTimings.load file
+  let tails := prevTimings.tails
+  let maxTail := tails.fold (init := 0) fun m _ tail => max m tail
+  return {
+    file, prevTimings, tails, maxTail
+    startTime := ← IO.monoMsNow
+    timings := ← IO.mkRef {}
+    jobs := ← IO.mkRef #[]
+  }
+
+/-- The time (in milliseconds) elapsed since the start of the build. -/
+def now (self : BuildSchedule) : BaseIO Nat :=
+  return (← IO.monoMsNow) - self.startTime
+
+/--
+The task priority of a module's build job. It is proportional to the module's tail,
+from `Task.Priority.default` for modules without recorded timings up to
+`Task.Priority.max` for the first module on the estimated critical path.
+-/
+def priority (self : BuildSchedule) (mod : Name) : Task.Priority :=
+  if self.maxTail = 0 then
+    .default
+  else
+    Task.Priority.max * self.tails.findD mod 0 / self.maxTail
+
+/-- The elaboration time of `mod` recorded by a previous build (or `0`). -/
+def prevTime (self : BuildSchedule) (mod : Name) : Nat :=
+  self.prevTimings.find? mod |>.map (·.time) |>.getD 0
+
+/-- Records the timing and job of a module visited by this build. -/
+def record (self : BuildSchedule) (timing : ModuleTiming) (job : ModuleJob) : BaseIO Unit := do
+  self.timings.modify (·.insert timing.name timing)
+  self.jobs.modify (·.push job)
+
+/-- The modules elaborated by this build. -/
+def built (self : BuildSchedule) : BaseIO NameSet := do
+  return (← self.jobs.get).foldl (init := {}) fun s job =>
+    if job.built then s.insert job.name else s
+
+/-- Persists the previous timings updated with those of this build (if any). -/
+def save (self : BuildSchedule) : IO Unit := do
+  let timings ← self.timings.get
+  if timings.isEmpty then
+    return
+  let timings := timings.fold (init := self.prevTimings) fun ts name t => ts.insert name t
+  timings.save self.file
+
+/--
+The estimated (from previous builds) and actual length of the critical path
+through the modules elaborated by this build, if any were.
+-/
+def builtCriticalPaths? (self : BuildSchedule) : BaseIO (Option (Nat × Nat)) := do
+  let built ← self.built
+  if built.isEmpty then
+    return none
+  let predicted := self.prevTimings.restrict built |>.criticalPathTime
+  let actual := (← self.timings.get).restrict built |>.criticalPathTime
+  return some (predicted, actual)
+
+end BuildSchedule
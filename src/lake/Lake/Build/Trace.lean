@@ -140,14 +140,13 @@ instance [ComputeHash α m] : ComputeTrace α m Hash := ⟨ComputeHash.computeHa
 instance : ComputeHash String Id := ⟨Hash.ofString⟩
 
 def computeFileHash (file : FilePath) : IO Hash :=
-  Hash.ofByteArray <$> IO.FS.readBinFile file
+  return ⟨← IO.FS.hashFile file⟩ -- same as `Hash.ofByteArray <$> IO.FS.readBinFile file`
 
 instance : ComputeHash FilePath IO := ⟨computeFileHash⟩
 
 def computeTextFileHash (file : FilePath) : IO Hash := do
-  let text ← IO.FS.readFile file
-  let text := text.crlfToLf
-  return Hash.ofString text
+  -- same as `Hash.ofString (← IO.FS.readFile file).crlfToLf`
+  return Hash.mix Hash.nil ⟨← IO.FS.hashFile file (normalizeEol := true)⟩
 
 /--
   A wrapper around `FilePath` that adjusts its `ComputeHash` implementation
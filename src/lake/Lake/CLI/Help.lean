@@ -47,6 +47,8 @@ BASIC OPTIONS:
   --update, -U          update manifest before building
   --reconfigure, -R     elaborate configuration files instead of using OLeans
   --no-build            exit immediately if a build target is not up-to-date
+  --lean-workers        elaborate modules in long-lived Lean processes that
+                        load each imported module only once
 
 OUTPUT OPTIONS:
   --quiet, -q           hide informational logs and the progress indicator
@@ -59,6 +61,8 @@ OUTPUT OPTIONS:
                         (same as --fail-level=info)
   --wfail               fail build if warnings are logged
                         (same as --fail-level=warning)
+  --report              write a report of module build timings and resource use
+                        (to `report.json` in the build directory) and summarize it
 
 
 See `lake help <command>` for more information on a specific command."
@@ -43,6 +43,8 @@ structure LakeOptions where
   failLv : LogLevel := .error
   outLv? : Option LogLevel := .none
   ansiMode : AnsiMode := .auto
+  report : Bool := false
+  leanWorkers : Bool := false
 
 def LakeOptions.outLv (opts : LakeOptions) : LogLevel :=
   opts.outLv?.getD opts.verbosity.minLogLv
@@ -88,6 +90,8 @@ def LakeOptions.mkBuildConfig (opts : LakeOptions) (out := OutStream.stderr) : B
   failLv := opts.failLv
   outLv := opts.outLv
   ansiMode := opts.ansiMode
+  report := opts.report
+  leanWorkers := opts.leanWorkers
   out := out
 
 export LakeOptions (mkLoadConfig mkBuildConfig)
@@ -184,6 +188,8 @@ def lakeLongOption : (opt : String) → CliM PUnit
   modifyThe LakeOptions ({· with failLv})
 | "--ansi"        => modifyThe LakeOptions ({· with ansiMode := .ansi})
 | "--no-ansi"     => modifyThe LakeOptions ({· with ansiMode := .noAnsi})
+| "--report"      => modifyThe LakeOptions ({· with report := true})
+| "--lean-workers" => modifyThe LakeOptions ({· with leanWorkers := true})
 | "--dir"         => do
   let rootDir ← takeOptArg "--dir" "path"
   modifyThe LakeOptions ({· with rootDir})
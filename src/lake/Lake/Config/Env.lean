@@ -31,6 +31,13 @@ structure Env where
   githashOverride : String
   /-- A name-to-URL mapping of URL overrides for the named packages. -/
   pkgUrlMap : NameMap String
+  /-- The directory of the local artifact cache (i.e., `LAKE_ARTIFACT_CACHE`), if enabled. -/
+  artifactCacheDir? : Option FilePath
+  /--
+  The size (in bytes) Lake trims the local artifact cache to after a build.
+  Set in megabytes via `LAKE_ARTIFACT_CACHE_LIMIT`.
+  -/
+  artifactCacheLimit : Nat
   /-- The initial Elan toolchain of the environment (i.e., `ELAN_TOOLCHAIN`). -/
   initToolchain : String
   /-- The initial Lean library search path of the environment (i.e., `LEAN_PATH`). -/
@@ -45,12 +52,18 @@ structure Env where
 
 namespace Env
 
+/-- The default size of the local artifact cache (10 GiB). -/
+def defaultArtifactCacheLimit : Nat := 10 * 1024 * 1024 * 1024
+
 /-- Compute an `Lake.Env` object from the given installs and set environment variables. -/
 def compute (lake : LakeInstall) (lean : LeanInstall) (elan? : Option ElanInstall) : EIO String Env := do
   let reservoirBaseUrl ← getUrlD "RESERVOIR_API_BASE_URL" "https://reservoir.lean-lang.org/api"
   return {
     lake, lean, elan?,
     pkgUrlMap := ← computePkgUrlMap
+    artifactCacheDir? := (← IO.getEnv "LAKE_ARTIFACT_CACHE").bind fun dir =>
+      if dir.isEmpty then none else some ⟨dir⟩
+    artifactCacheLimit := ← computeArtifactCacheLimit
     reservoirApiUrl := ← getUrlD "RESERVOIR_API_URL" s!"{reservoirBaseUrl}/v1"
     githashOverride := (← IO.getEnv "LEAN_GITHASH").getD ""
     initToolchain := (← IO.getEnv "ELAN_TOOLCHAIN").getD ""
@@ -65,6 +78,12 @@ where
     match Json.parse urlMapStr |>.bind fromJson? with
     | .ok urlMap => return urlMap
     | .error e => throw s!"'LAKE_PKG_URL_MAP' has invalid JSON: {e}"
+  computeArtifactCacheLimit := do
+    let some limit ← IO.getEnv "LAKE_ARTIFACT_CACHE_LIMIT"
+      | return defaultArtifactCacheLimit
+    let some mb := limit.trim.toNat?
+      | throw s!"'LAKE_ARTIFACT_CACHE_LIMIT' is not a number of megabytes: {limit}"
+    return mb * 1024 * 1024
   @[macro_inline] getUrlD var default := do
     if let some url ← IO.getEnv var then
       return if url.back == '/' then url.dropRight 1 else url
@@ -136,6 +155,8 @@ def baseVars (env : Env) : Array (String × Option String)  :=
     ("LAKE", env.lake.lake.toString),
     ("LAKE_HOME", env.lake.home.toString),
     ("LAKE_PKG_URL_MAP", toJson env.pkgUrlMap |>.compress),
+    ("LAKE_ARTIFACT_CACHE", env.artifactCacheDir?.map (·.toString)),
+    ("LAKE_ARTIFACT_CACHE_LIMIT", toString (env.artifactCacheLimit / (1024 * 1024))),
     ("LEAN_GITHASH", env.leanGithash),
     ("LEAN_SYSROOT", env.lean.sysroot.toString),
     ("LEAN_AR", env.lean.ar.toString),
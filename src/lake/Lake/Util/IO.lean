@@ -9,3 +9,11 @@ namespace Lake
 /-- Creates any missing parent directories of `path`. -/
 def createParentDirs (path : System.FilePath) : IO Unit := do
   if let some dir := path.parent then IO.FS.createDirAll dir
+
+/-- Removes the file at `path`, if it exists. -/
+def removeFileIfExists (path : System.FilePath) : IO Unit := do
+  try
+    IO.FS.removeFile path
+  catch
+    | .noFileOrDirectory .. => pure ()
+    | e => throw e
@@ -29,6 +29,16 @@ def mkCmdLog (args : IO.Process.SpawnArgs) : String :=
   | .ok out => return out
   | .error err => error s!"failed to execute '{args.cmd}': {err}"
 
+/-- Like `rawProc`, but also returns the resources consumed by the process. -/
+@[inline] def rawProcWithUsage
+  (args : IO.Process.SpawnArgs) (quiet := false)
+: LogIO (IO.Process.Output × IO.Process.ResourceUsage) := do
+  withLogErrorPos do
+  unless quiet do logVerbose (mkCmdLog args)
+  match (← IO.Process.outputWithUsage args |>.toBaseIO) with
+  | .ok out => return out
+  | .error err => error s!"failed to execute '{args.cmd}': {err}"
+
 def proc (args : IO.Process.SpawnArgs) (quiet := false) : LogIO Unit := do
   withLogErrorPos do
   let out ← rawProc args
@@ -0,0 +1 @@
+rm -rf .lake lake-manifest.json cache Foo.lean produced.out
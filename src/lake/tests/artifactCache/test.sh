@@ -0,0 +1,48 @@
+#!/usr/bin/env bash
+set -euxo pipefail
+
+LAKE=${LAKE:-../../.lake/build/bin/lake}
+
+./clean.sh
+
+# ---
+# Tests the local artifact cache (`LAKE_ARTIFACT_CACHE`)
+# ---
+
+export LAKE_ARTIFACT_CACHE="$PWD/cache"
+
+# Tests that a build populates the cache
+echo $'def foo := "foo"\n#eval IO.println "elaborated Foo"' > Foo.lean
+$LAKE build | grep --color "Built Foo"
+test -n "`ls cache`"
+
+# Tests that a clean build restores the module from the cache
+# and replays its log
+rm -rf .lake
+$LAKE build > produced.out
+grep --color "Fetched Foo" produced.out
+grep --color "elaborated Foo" produced.out
+test -f .lake/build/lib/Foo.olean
+test -f .lake/build/lib/Foo.ilean
+$LAKE build --no-build
+
+# Tests that rebuilding a restored module does not corrupt the cache
+cp .lake/build/lib/Foo.olean produced.out
+echo $'def foo := "bar"' > Foo.lean
+$LAKE build | grep --color "Built Foo"
+echo $'def foo := "foo"\n#eval IO.println "elaborated Foo"' > Foo.lean
+$LAKE build | grep --color "Fetched Foo"
+cmp .lake/build/lib/Foo.olean produced.out
+
+# Tests that object files are restored from the cache
+$LAKE build +Foo:c.o | grep --color "Built Foo:c.o"
+rm -rf .lake
+$LAKE build +Foo:c.o | grep --color "Fetched Foo:c.o"
+
+# Tests that the cache is trimmed to its limit
+rm -rf .lake cache
+LAKE_ARTIFACT_CACHE_LIMIT=0 $LAKE build | grep --color "Built Foo"
+test -z "`ls cache`"
+
+# Tests that an invalid limit is reported
+(LAKE_ARTIFACT_CACHE_LIMIT=foo $LAKE build 2>&1 || true) | grep --color "LAKE_ARTIFACT_CACHE_LIMIT"
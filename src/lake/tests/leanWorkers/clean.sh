@@ -0,0 +1 @@
+rm -rf .lake lake-manifest.json Foo Foo.lean
@@ -0,0 +1,34 @@
+#!/usr/bin/env bash
+set -euxo pipefail
+
+LAKE=${LAKE:-../../.lake/build/bin/lake}
+
+./clean.sh
+
+# ---
+# Tests building modules in long-lived Lean build workers
+# ---
+
+mkdir -p Foo
+echo 'def a := 1' > Foo/A.lean
+echo 'import Foo.A def b := a + 1' > Foo/B.lean
+echo 'import Foo.A import Foo.B def c := a + b' > Foo.lean
+
+# Tests that a build in workers produces the module outputs
+$LAKE build --lean-workers -v | grep --color "build worker"
+test -f .lake/build/lib/Foo/A.olean
+test -f .lake/build/lib/Foo/B.olean
+test -f .lake/build/lib/Foo.olean
+test -f .lake/build/lib/Foo.ilean
+
+# Tests that modules built in workers are up-to-date for a normal build
+$LAKE build --no-build
+
+# Tests that a worker reports the errors of a module and the build fails
+echo 'def a : Nat := "x"' > Foo/A.lean
+($LAKE build --lean-workers 2>&1 && exit 1 || true) | grep --color "type mismatch"
+
+# Tests that a worker sees the new version of a module rebuilt in the same build
+echo 'def a := 2' > Foo/A.lean
+echo 'import Foo.A def b := a + 1 example : b = 3 := rfl' > Foo/B.lean
+$LAKE build --lean-workers | grep --color "Built Foo.B"
@@ -0,0 +1,39 @@
+#!/usr/bin/env bash
+set -euxo pipefail
+
+LAKE=${LAKE:-../../.lake/build/bin/lake}
+
+./clean.sh
+
+# ---
+# Tests the recording of module build timings used for job scheduling
+# ---
+
+mkdir -p Foo
+echo 'def a := 1' > Foo/A.lean
+echo 'def b := 2' > Foo/B.lean
+echo 'import Foo.A import Foo.B' > Foo.lean
+
+# Tests that a build records timings and reports the critical path
+$LAKE build -v | grep --color "Critical path of built modules"
+grep --color '"Foo.A"' .lake/build/timings.json
+grep --color '"imports":\["Foo.A","Foo.B"\]' .lake/build/timings.json
+
+# Tests that an up-to-date build reports no critical path
+$LAKE build -v | grep --color "Critical path" && exit 1 || true
+
+# Tests that a rebuild uses the recorded timings
+echo 'def a := 3' > Foo/A.lean
+$LAKE build -v | grep --color "predicted"
+
+# Tests that invalid timings are ignored
+echo 'invalid' > .lake/build/timings.json
+echo 'def a := 4' > Foo/A.lean
+$LAKE build | grep --color "Built Foo.A"
+grep --color '"Foo.A"' .lake/build/timings.json
+
+# Tests that a build can write a report
+echo 'def a := 5' > Foo/A.lean
+$LAKE build --report | grep --color "Build report"
+grep --color '"criticalPath"' .lake/build/report.json
+grep --color '"maxRss"' .lake/build/report.json
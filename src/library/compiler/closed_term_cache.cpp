@@ -5,6 +5,7 @@ Released under Apache 2.0 license as described in the file LICENSE.
 Author: Leonardo de Moura
 */
 #include "library/util.h"
+#include "library/compiler/util.h"
 
 namespace lean {
 extern "C" object * lean_cache_closed_term_name(object * env, object * e, object * n);
@@ -15,6 +16,7 @@ optional<name> get_closed_term_name(environment const & env, expr const & e) {
 }
 
 environment cache_closed_term_name(environment const & env, expr const & e, name const & n) {
+    log_codegen_update(codegen_update::ClosedTerm, e, n);
     return environment(lean_cache_closed_term_name(env.to_obj_arg(), e.to_obj_arg(), n.to_obj_arg()));
 }
 }
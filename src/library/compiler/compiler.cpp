@@ -4,11 +4,17 @@ Released under Apache 2.0 license as described in the file LICENSE.
 
 Author: Leonardo de Moura
 */
+#include <algorithm>
+#include <unordered_set>
+#include <vector>
+#include "runtime/alloc.h"
+#include "runtime/array_ref.h"
 #include "util/option_declarations.h"
 #include "util/io.h"
 #include "kernel/type_checker.h"
 #include "kernel/kernel_exception.h"
 #include "kernel/trace.h"
+#include "kernel/for_each_fn.h"
 #include "library/max_sharing.h"
 #include "library/time_task.h"
 #include "library/compiler/util.h"
@@ -23,6 +29,7 @@ Author: Leonardo de Moura
 #include "library/compiler/implemented_by_attribute.h"
 #include "library/compiler/lambda_lifting.h"
 #include "library/compiler/extract_closed.h"
+#include "library/compiler/closed_term_cache.h"
 #include "library/compiler/reduce_arity.h"
 #include "library/compiler/ll_infer_type.h"
 #include "library/compiler/simp_app_args.h"
@@ -34,9 +41,20 @@ Author: Leonardo de Moura
 
 namespace lean {
 static name * g_extract_closed = nullptr;
+static name * g_compiler_arena = nullptr;
 
 bool is_extract_closed_enabled(options const & opts) { return opts.get_bool(*g_extract_closed, true); }
 
+static bool is_arena_enabled(options const & opts) { return opts.get_bool(*g_compiler_arena, false); }
+
+/* Execute the compiler pass `f` allocating its objects in a separate arena (see `scoped_arena`) if `use_arena` is true.
+   Most of them are garbage after the pass, and the pages of the arena are released at once. */
+template<typename F> static comp_decls apply_in_arena(bool use_arena, F && f) {
+    scoped_arena arena(use_arena);
+    comp_decls r = f();
+    return comp_decls(arena.pop(r.steal()));
+}
+
 static name get_real_name(name const & n) {
     if (optional<name> new_n = is_unsafe_rec_name(n))
         return *new_n;
@@ -65,6 +83,54 @@ comp_decls apply(F && f, comp_decls const & ds) {
     return map(ds, [&](comp_decl const & d) { return comp_decl(d.fst(), f(d.snd())); });
 }
 
+/* Number of distinct expression nodes in `ds`. */
+static uint64 get_num_nodes(comp_decls const & ds) {
+    std::unordered_set<object *> visited;
+    buffer<expr> todo;
+    for (comp_decl const & d : ds)
+        todo.push_back(d.snd());
+    while (!todo.empty()) {
+        expr e = todo.back();
+        todo.pop_back();
+        if (!visited.insert(e.raw()).second)
+            continue;
+        switch (e.kind()) {
+        case expr_kind::App:
+            todo.push_back(app_fn(e)); todo.push_back(app_arg(e)); break;
+        case expr_kind::Lambda: case expr_kind::Pi:
+            todo.push_back(binding_domain(e)); todo.push_back(binding_body(e)); break;
+        case expr_kind::Let:
+            todo.push_back(let_type(e)); todo.push_back(let_value(e)); todo.push_back(let_body(e)); break;
+        case expr_kind::MData:
+            todo.push_back(mdata_expr(e)); break;
+        case expr_kind::Proj:
+            todo.push_back(proj_expr(e)); break;
+        default:
+            break;
+        }
+    }
+    return visited.size();
+}
+
+/* Execute the compiler pass `fn` updating `ds` as a nested `time_task`. When profiling, also report the number of
+   small object allocations of the pass and the number of expression nodes of `ds` before and after it. The sizes are
+   computed outside of the measured interval of the task. */
+static void profile_pass(char const * pass, options const & opts, name const & decl, comp_decls & ds,
+                         std::function<void()> const & fn) {
+    if (!time_task::is_enabled(opts)) {
+        fn();
+        return;
+    }
+    uint64 size_before = get_num_nodes(ds);
+    time_task t(std::string("compilation ") + pass, opts, decl);
+    uint64 num_allocs  = get_num_heartbeats();
+    fn();
+    t.stop();
+    t.report_counter("allocations", get_num_heartbeats() - num_allocs);
+    t.report_counter("size before", size_before);
+    t.report_counter("size after", get_num_nodes(ds));
+}
+
 void trace_comp_decl(comp_decl const & d) {
     tout() << ">> " << d.fst() << "\n" << trace_pp_expr(d.snd()) << "\n";
 }
@@ -204,24 +270,27 @@ environment compile(environment const & env, options const & opts, names cs) {
     // scope_traces_as_string trace_scope;
     auto simp  = [&](environment const & env, expr const & e) { return csimp(env, e, cfg); };
     auto esimp = [&](environment const & env, expr const & e) { return cesimp(env, e, cfg); };
+    bool use_arena = is_arena_enabled(opts);
+    name decl = head(cs);
+    auto pass = [&](char const * pass_name, std::function<void()> const & fn) { profile_pass(pass_name, opts, decl, ds, fn); };
     trace_compiler(name({"compiler", "input"}), ds);
-    ds = apply(eta_expand, env, ds);
+    pass("eta_expand", [&]() { ds = apply(eta_expand, env, ds); });
     trace_compiler(name({"compiler", "eta_expand"}), ds);
-    ds = apply(to_lcnf, env, ds);
-    ds = apply(find_jp, env, ds);
+    pass("to_lcnf", [&]() { ds = apply_in_arena(use_arena, [&]() { return apply(to_lcnf, env, ds); }); });
+    pass("find_jp", [&]() { ds = apply(find_jp, env, ds); });
     // trace(ds);
     trace_compiler(name({"compiler", "lcnf"}), ds);
     // trace(ds);
-    ds = apply(cce, env, ds);
+    pass("cce", [&]() { ds = apply(cce, env, ds); });
     trace_compiler(name({"compiler", "cce"}), ds);
-    ds = apply(csimp_replace_constants, env, ds);
-    ds = apply(simp, env, ds);
+    pass("csimp_replace_constants", [&]() { ds = apply(csimp_replace_constants, env, ds); });
+    pass("simp", [&]() { ds = apply_in_arena(use_arena, [&]() { return apply(simp, env, ds); }); });
     trace_compiler(name({"compiler", "simp"}), ds);
     // trace(ds);
     environment new_env = env;
-    std::tie(new_env, ds) = eager_lambda_lifting(new_env, ds, cfg);
+    pass("eager_lambda_lifting", [&]() { std::tie(new_env, ds) = eager_lambda_lifting(new_env, ds, cfg); });
     trace_compiler(name({"compiler", "eager_lambda_lifting"}), ds);
-    ds = apply(max_sharing, ds);
+    pass("max_sharing", [&]() { ds = apply(max_sharing, ds); });
     trace_compiler(name({"compiler", "stage1"}), ds);
     new_env = cache_stage1(new_env, ds);
     if (is_matcher(new_env, ds)) {
@@ -233,40 +302,40 @@ environment compile(environment const & env, options const & opts, names cs) {
            when it is partially applied. Then, we can mark all `match` auxiliary functions as `[strong_inline]` */
         return new_env;
     }
-    std::tie(new_env, ds) = specialize(new_env, ds, cfg);
+    pass("specialize", [&]() { std::tie(new_env, ds) = specialize(new_env, ds, cfg); });
     // The following check is incorrect. It was exposed by issue #1812.
     // We will not fix the check since we will delete the compiler.
     // lean_assert(lcnf_check_let_decls(new_env, ds));
     trace_compiler(name({"compiler", "specialize"}), ds);
-    ds = apply(elim_dead_let, ds);
+    pass("elim_dead_let", [&]() { ds = apply(elim_dead_let, ds); });
     trace_compiler(name({"compiler", "elim_dead_let"}), ds);
-    ds = apply(erase_irrelevant, new_env, ds);
+    pass("erase_irrelevant", [&]() { ds = apply_in_arena(use_arena, [&]() { return apply(erase_irrelevant, new_env, ds); }); });
     trace_compiler(name({"compiler", "erase_irrelevant"}), ds);
-    ds = apply(struct_cases_on, new_env, ds);
+    pass("struct_cases_on", [&]() { ds = apply(struct_cases_on, new_env, ds); });
     trace_compiler(name({"compiler", "struct_cases_on"}), ds);
-    ds = apply(esimp, new_env, ds);
+    pass("esimp", [&]() { ds = apply_in_arena(use_arena, [&]() { return apply(esimp, new_env, ds); }); });
     trace_compiler(name({"compiler", "simp"}), ds);
-    ds = reduce_arity(new_env, ds);
+    pass("reduce_arity", [&]() { ds = reduce_arity(new_env, ds); });
     trace_compiler(name({"compiler", "reduce_arity"}), ds);
-    std::tie(new_env, ds) = lambda_lifting(new_env, ds);
+    pass("lambda_lifting", [&]() { std::tie(new_env, ds) = lambda_lifting(new_env, ds); });
     trace_compiler(name({"compiler", "lambda_lifting"}), ds);
     // trace(ds);
-    ds = apply(esimp, new_env, ds);
+    pass("esimp", [&]() { ds = apply_in_arena(use_arena, [&]() { return apply(esimp, new_env, ds); }); });
     trace_compiler(name({"compiler", "simp"}), ds);
     new_env = cache_stage2(new_env, ds);
     trace_compiler(name({"compiler", "stage2"}), ds);
     if (is_extract_closed_enabled(opts)) {
-        std::tie(new_env, ds) = extract_closed(new_env, ds);
-        ds = apply(elim_dead_let, ds);
-        ds = apply(esimp, new_env, ds);
+        pass("extract_closed", [&]() { std::tie(new_env, ds) = extract_closed(new_env, ds); });
+        pass("elim_dead_let", [&]() { ds = apply(elim_dead_let, ds); });
+        pass("esimp", [&]() { ds = apply_in_arena(use_arena, [&]() { return apply(esimp, new_env, ds); }); });
         trace_compiler(name({"compiler", "extract_closed"}), ds);
     }
     new_env = cache_new_stage2(new_env, ds);
-    ds = apply(esimp, new_env, ds);
+    pass("esimp", [&]() { ds = apply_in_arena(use_arena, [&]() { return apply(esimp, new_env, ds); }); });
     trace_compiler(name({"compiler", "simp"}), ds);
-    ds = apply(simp_app_args, new_env, ds);
-    ds = apply(ecse, new_env, ds);
-    ds = apply(elim_dead_let, ds);
+    pass("simp_app_args", [&]() { ds = apply(simp_app_args, new_env, ds); });
+    pass("ecse", [&]() { ds = apply(ecse, new_env, ds); });
+    pass("elim_dead_let", [&]() { ds = apply(elim_dead_let, ds); });
     trace_compiler(name({"compiler", "simp_app_args"}), ds);
     // std::cout << trace_scope.get_string() << "\n";
     /* compile IR. */
@@ -279,10 +348,207 @@ extern "C" LEAN_EXPORT object * lean_compile_decls(object * env, object * opts,
         });
 }
 
+extern "C" object* lean_add_specialization_info(object* env, object* fn, object* info);
+extern "C" object* lean_cache_specialization(object* env, object* e, object* fn);
+
+/* Replay the environment updates recorded by a `scoped_codegen_log` on top of `env`. */
+static environment replay_codegen_log(environment env, array_ref<object_ref> const & log) {
+    for (object_ref const & u : log) {
+        object_ref const & arg1 = cnstr_get_ref(u, 0);
+        object_ref const & arg2 = cnstr_get_ref(u, 1);
+        switch (static_cast<codegen_update>(cnstr_tag(u.raw()))) {
+        case codegen_update::Decl:
+            env = env.add(static_cast<declaration const &>(arg1), false);
+            break;
+        case codegen_update::SpecInfo:
+            env = environment(lean_add_specialization_info(env.to_obj_arg(), arg1.to_obj_arg(), arg2.to_obj_arg()));
+            break;
+        case codegen_update::SpecCache:
+            env = environment(lean_cache_specialization(env.to_obj_arg(), arg1.to_obj_arg(), arg2.to_obj_arg()));
+            break;
+        case codegen_update::ClosedTerm:
+            env = cache_closed_term_name(env, static_cast<expr const &>(arg1), static_cast<name const &>(arg2));
+            break;
+        case codegen_update::IRDecl:
+            env = ir::add_decl(env, arg1);
+            break;
+        case codegen_update::BoxedVersion:
+            env = ir::add_boxed_version(env, arg1);
+            break;
+        case codegen_update::FunctionSummary:
+            env = ir::add_function_summary(env, static_cast<name const &>(arg1), arg2);
+            break;
+        }
+    }
+    return env;
+}
+
+/* Task body for `compile_groups`: compile `group` and return the code generation log, or the kernel exception. */
+static obj_res compile_group_fn(obj_arg env, obj_arg opts, obj_arg group, obj_arg) {
+    return catch_kernel_exceptions<object_ref>([&]() {
+            scoped_codegen_log log;
+            compile(environment(env), options(opts), names(group));
+            return object_ref(to_array(log.get_log()));
+        });
+}
+
+/* Add to `ds` the groups in `group_of` that the code of `c` uses. Besides direct references, the code uses the targets
+   of `implemented_by` attributes and of `@[csimp]` replacements. */
+static void get_decl_group_uses(environment const & env, name const & c, name_map<unsigned> const & group_of,
+                                std::vector<unsigned> & ds) {
+    auto visit = [&](name const & n) {
+        if (unsigned const * j = group_of.find(n))
+            ds.push_back(*j);
+    };
+    optional<constant_info> info = env.find(c);
+    if (info && info->has_value()) {
+        for_each(csimp_replace_constants(env, info->get_value()), [&](expr const & e) {
+                if (is_constant(e)) {
+                    visit(const_name(e));
+                    if (optional<name> impl = get_implemented_by_attribute(env, const_name(e)))
+                        visit(*impl);
+                }
+                return true;
+            });
+    }
+}
+
+/* Compute the previous groups that each declaration group uses, and store in `group_of` the group of each declaration.
+   Recursive definitions compiled as `f._unsafe_rec` are also registered under their real name `f`, which is what
+   later declarations refer to. */
+static void get_group_deps(environment const & env, buffer<names> const & groups, std::vector<std::vector<unsigned>> & deps,
+                           name_map<unsigned> & group_of) {
+    for (unsigned i = 0; i < groups.size(); i++) {
+        std::vector<unsigned> ds;
+        for (name const & c : groups[i])
+            get_decl_group_uses(env, c, group_of, ds);
+        std::sort(ds.begin(), ds.end());
+        ds.erase(std::unique(ds.begin(), ds.end()), ds.end());
+        deps.push_back(ds);
+        for (name const & c : groups[i]) {
+            group_of.insert(c, i);
+            group_of.insert(get_real_name(c), i);
+        }
+    }
+}
+
+/* Compute the scheduling level of each declaration group: a group must be compiled after every previous group it
+   uses, see `get_group_deps`. */
+static unsigned get_group_levels(environment const & env, buffer<names> const & groups, buffer<unsigned> & levels) {
+    std::vector<std::vector<unsigned>> deps;
+    name_map<unsigned> group_of;
+    get_group_deps(env, groups, deps, group_of);
+    unsigned max_level = 0;
+    for (unsigned i = 0; i < groups.size(); i++) {
+        unsigned level = 0;
+        for (unsigned j : deps[i])
+            level = std::max(level, levels[j] + 1);
+        levels.push_back(level);
+        max_level = std::max(max_level, level);
+    }
+    return max_level;
+}
+
+/* Compile the declaration groups `groups` (in elaboration order), each one using the corresponding options in `opts`,
+   and return `Except KernelException Environment`. Groups at the same level are independent, they are compiled in parallel against the same environment, and their
+   code generation logs are then replayed in the original order. Thus, the result only depends on `groups` and not on
+   the scheduling of the tasks. */
+static object * compile_groups(environment env, buffer<names> const & groups, buffer<options> const & opts) {
+    buffer<unsigned> levels;
+    unsigned max_level = get_group_levels(env, groups, levels);
+    for (unsigned level = 0; level <= max_level; level++) {
+        buffer<unsigned> idxs;
+        for (unsigned i = 0; i < groups.size(); i++) {
+            if (levels[i] == level)
+                idxs.push_back(i);
+        }
+        if (idxs.size() == 1) {
+            object * r = catch_kernel_exceptions<environment>([&]() { return compile(env, opts[idxs[0]], groups[idxs[0]]); });
+            if (cnstr_tag(r) == 0)
+                return r;
+            env = environment(cnstr_get(r, 0), true);
+            dec_ref(r);
+            continue;
+        }
+        buffer<object *> tasks;
+        for (unsigned i : idxs) {
+            object * c = lean_alloc_closure((void*)compile_group_fn, 4, 3);
+            lean_closure_set(c, 0, env.to_obj_arg());
+            lean_closure_set(c, 1, opts[i].to_obj_arg());
+            lean_closure_set(c, 2, groups[i].to_obj_arg());
+            tasks.push_back(lean_task_spawn_core(c, 0, false));
+        }
+        object * error = nullptr;
+        for (object * t : tasks) {
+            object * r = lean_task_get(t);
+            if (!error && cnstr_tag(r) == 0) {
+                inc(r);
+                error = r;
+            } else if (!error) {
+                array_ref<object_ref> log(cnstr_get(r, 0), true);
+                object * r2 = catch_kernel_exceptions<environment>([&]() { return replay_codegen_log(env, log); });
+                if (cnstr_tag(r2) == 0) {
+                    error = r2;
+                } else {
+                    env = environment(cnstr_get(r2, 0), true);
+                    dec_ref(r2);
+                }
+            }
+            dec_ref(t);
+        }
+        if (error)
+            return error;
+    }
+    return mk_except_ok(env);
+}
+
+extern "C" LEAN_EXPORT object * lean_compile_decl_groups(object * env, object * groups) {
+    buffer<names> gs;
+    buffer<options> opts;
+    for (object_ref const & g : list_ref<object_ref>(groups, true)) {
+        gs.push_back(names(cnstr_get(g.raw(), 0), true));
+        opts.push_back(options(cnstr_get(g.raw(), 1), true));
+    }
+    return compile_groups(environment(env), gs, opts);
+}
+
+/* Return a `List Bool` marking the groups in `groups : List (List Name × Options)` that the code of `c` uses, directly
+   or indirectly. */
+extern "C" LEAN_EXPORT object * lean_get_decl_groups_used_by(object * env, b_obj_arg groups, b_obj_arg c) {
+    environment new_env(env);
+    buffer<names> gs;
+    for (object_ref const & g : list_ref<object_ref>(groups, true))
+        gs.push_back(names(cnstr_get(g.raw(), 0), true));
+    std::vector<std::vector<unsigned>> deps;
+    name_map<unsigned> group_of;
+    get_group_deps(new_env, gs, deps, group_of);
+    std::vector<unsigned> todo;
+    if (unsigned const * i = group_of.find(TO_REF(name, c)))
+        todo.push_back(*i);
+    else
+        get_decl_group_uses(new_env, TO_REF(name, c), group_of, todo);
+    std::vector<bool> used(gs.size(), false);
+    while (!todo.empty()) {
+        unsigned i = todo.back();
+        todo.pop_back();
+        if (!used[i]) {
+            used[i] = true;
+            todo.insert(todo.end(), deps[i].begin(), deps[i].end());
+        }
+    }
+    buffer<object_ref> r;
+    for (bool b : used)
+        r.push_back(object_ref(box(b)));
+    return list_ref<object_ref>(r.begin(), r.end()).steal();
+}
+
 void initialize_compiler() {
     g_extract_closed = new name{"compiler", "extract_closed"};
     mark_persistent(g_extract_closed->raw());
     register_bool_option(*g_extract_closed, true, "(compiler) enable/disable closed term caching");
+    g_compiler_arena = new name{"compiler", "arena"};
+    mark_persistent(g_compiler_arena->raw());
+    register_bool_option(*g_compiler_arena, false, "(compiler) allocate the objects of the main compiler passes in memory arenas");
     register_trace_class("compiler");
     register_trace_class({"compiler", "input"});
     register_trace_class({"compiler", "inline"});
@@ -325,5 +591,6 @@ void initialize_compiler() {
 
 void finalize_compiler() {
     delete g_extract_closed;
+    delete g_compiler_arena;
 }
 }
@@ -239,7 +239,7 @@ class eager_lambda_lifting_fn {
                other definitions that use `n`.
                We used a similar hack at `specialize.cpp`. */
             declaration aux_ax = mk_axiom(n, names(), type, true /* meta */);
-            m_st.env() = env().add(aux_ax, false);
+            m_st.env() = add_codegen_decl(env(), aux_ax);
             m_new_decls.push_back(comp_decl(n, code));
             return mk_app(mk_constant(n), new_params);
         } catch (exception &) {
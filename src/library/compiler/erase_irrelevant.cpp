@@ -219,23 +219,14 @@ class erase_irrelevant_fn {
                            binding_body(minor));
     }
 
-    expr elim_float_array_cases(buffer<expr> & args) {
+    /* Eliminate `cases_on` of a scalar array type (e.g., `ByteArray`) using its `data` function. */
+    expr elim_sarray_cases(name const & data_name, buffer<expr> & args) {
         lean_always_assert(args.size() == 3);
         expr major       = visit(args[1]);
         expr minor       = visit_minor(args[2]);
         lean_always_assert(is_lambda(minor));
         return
-            ::lean::mk_let(next_name(), mk_enf_object_type(), mk_app(mk_constant(get_float_array_data_name()), major),
-                           binding_body(minor));
-    }
-
-    expr elim_byte_array_cases(buffer<expr> & args) {
-        lean_always_assert(args.size() == 3);
-        expr major       = visit(args[1]);
-        expr minor       = visit_minor(args[2]);
-        lean_always_assert(is_lambda(minor));
-        return
-            ::lean::mk_let(next_name(), mk_enf_object_type(), mk_app(mk_constant(get_byte_array_data_name()), major),
+            ::lean::mk_let(next_name(), mk_enf_object_type(), mk_app(mk_constant(data_name), major),
                            binding_body(minor));
     }
 
@@ -275,9 +266,15 @@ class erase_irrelevant_fn {
         } else if (I_name == get_array_name()) {
             return elim_array_cases(args);
         } else if (I_name == get_float_array_name()) {
-            return elim_float_array_cases(args);
+            return elim_sarray_cases(get_float_array_data_name(), args);
         } else if (I_name == get_byte_array_name()) {
-            return elim_byte_array_cases(args);
+            return elim_sarray_cases(get_byte_array_data_name(), args);
+        } else if (I_name == get_uint16_array_name()) {
+            return elim_sarray_cases(get_uint16_array_data_name(), args);
+        } else if (I_name == get_uint32_array_name()) {
+            return elim_sarray_cases(get_uint32_array_data_name(), args);
+        } else if (I_name == get_uint64_array_name()) {
+            return elim_sarray_cases(get_uint64_array_data_name(), args);
         } else if (I_name == get_uint8_name() || I_name == get_uint16_name() || I_name == get_uint32_name() || I_name == get_uint64_name() || I_name == get_usize_name()) {
           return elim_uint_cases(I_name, args);
         } else if (I_name == get_decidable_name()) {
@@ -101,10 +101,27 @@ std::string decl_to_string(decl const & d) {
     return r.to_std_string();
 }
 environment add_decl(environment const & env, decl const & d) {
+    log_codegen_update(codegen_update::IRDecl, d);
     return environment(lean_ir_add_decl(env.to_obj_arg(), d.to_obj_arg()));
 }
+
+/*
+@[export lean_ir_add_function_summary]
+def addFunctionSummary (env : Environment) (fid : FunId) (v : Value) : Environment :=
+*/
+extern "C" object * lean_ir_add_function_summary(object * env, object * fn, object * v);
+environment add_function_summary(environment const & env, name const & fn, object_ref const & v) {
+    log_codegen_update(codegen_update::FunctionSummary, fn, v);
+    return environment(lean_ir_add_function_summary(env.to_obj_arg(), fn.to_obj_arg(), v.to_obj_arg()));
+}
 }
 
+/*
+@[export lean_ir_get_function_summary]
+def getFunctionSummary? (env : Environment) (fid : FunId) : Option Value :=
+*/
+extern "C" object * lean_ir_get_function_summary(object * env, object * fn);
+
 static ir::type to_ir_type(expr const & e) {
     if (is_constant(e)) {
         if (e == mk_enf_object_type()) {
@@ -510,6 +527,23 @@ decl to_ir_decl(environment const & env, comp_decl const & d) {
     return to_ir_fn(env)(d);
 }
 
+/* Record the IR declarations (and their boxed versions) and the function summaries computed by `elimDeadBranches`
+   added by `compile` in the code generation log. */
+static void log_ir_decls(environment const & env, comp_decls const & decls) {
+    buffer<decl> boxed;
+    for (comp_decl const & d : decls) {
+        if (optional<decl> ir_decl = find_ir_decl(env, d.fst()).get())
+            log_codegen_update(codegen_update::IRDecl, *ir_decl);
+        option_ref<object_ref> summary(lean_ir_get_function_summary(env.to_obj_arg(), d.fst().to_obj_arg()));
+        if (optional<object_ref> v = summary.get())
+            log_codegen_update(codegen_update::FunctionSummary, d.fst(), *v);
+        if (optional<decl> ir_decl = find_ir_decl(env, name(d.fst(), "_boxed")).get())
+            boxed.push_back(*ir_decl);
+    }
+    for (decl const & d : boxed)
+        log_codegen_update(codegen_update::IRDecl, d);
+}
+
 /*
 @[export lean.ir.compile_core]
 def compile (env : Environment) (opts : Options) (decls : Array Decl) : Log × (Except String Environment) :=
@@ -537,6 +571,7 @@ environment compile(environment const & env, options const & opts, comp_decls co
     } else {
         environment new_env(cnstr_get(v, 0), true);
         dec_ref(r);
+        log_ir_decls(new_env, decls);
         return new_env;
     }
 }
@@ -547,6 +582,7 @@ def addBoxedVersion (env : Environment) (decl : Decl) : Except String Environmen
 */
 extern "C" object * lean_ir_add_boxed_version(object * env, object * decl);
 environment add_boxed_version(environment const & env, decl const & d) {
+    log_codegen_update(codegen_update::BoxedVersion, d);
     object * v = lean_ir_add_boxed_version(env.to_obj_arg(), d.to_obj_arg());
     if (cnstr_tag(v) == 0) {
         string_ref error(cnstr_get(v, 0), true);
@@ -589,6 +625,21 @@ string_ref emit_c(environment const & env, name const & mod_name) {
     }
 }
 
+extern "C" object * lean_ir_emit_c_shards(object * env, object * mod_name, object * num_shards);
+
+array_ref<string_ref> emit_c_shards(environment const & env, name const & mod_name, unsigned num_shards) {
+    object * r = lean_ir_emit_c_shards(env.to_obj_arg(), mod_name.to_obj_arg(), mk_nat_obj(num_shards));
+    if (cnstr_tag(r) == 0) {
+        string_ref error(cnstr_get(r, 0), true);
+        dec_ref(r);
+        throw exception(error.to_std_string());
+    } else {
+        array_ref<string_ref> shards(cnstr_get(r, 0), true);
+        dec_ref(r);
+        return shards;
+    }
+}
+
 /*
 inductive CtorFieldInfo
 | irrelevant
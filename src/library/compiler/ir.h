@@ -6,6 +6,8 @@ Author: Leonardo de Moura
 */
 #pragma once
 #include <string>
+#include "runtime/option_ref.h"
+#include "runtime/array_ref.h"
 #include "kernel/environment.h"
 #include "library/compiler/util.h"
 namespace lean {
@@ -36,7 +38,13 @@ std::string decl_to_string(decl const & d);
 void test(decl const & d);
 environment compile(environment const & env, options const & opts, comp_decls const & decls);
 environment add_extern(environment const & env, name const & fn);
+environment add_decl(environment const & env, decl const & d);
+environment add_boxed_version(environment const & env, decl const & d);
+option_ref<decl> find_ir_decl(environment const & env, name const & n);
+environment add_function_summary(environment const & env, name const & fn, object_ref const & v);
 string_ref emit_c(environment const & env, name const & mod_name);
+/* Emit the C code of the module split into `num_shards` translation units, see `emitCShards`. */
+array_ref<string_ref> emit_c_shards(environment const & env, name const & mod_name, unsigned num_shards);
 void emit_llvm(environment const & env, name const & mod_name, std::string const &filepath);
 }
 void initialize_ir();
@@ -1070,9 +1070,32 @@ uint32 run_main(environment const & env, options const & opts, int argv, char *
     return interpreter::with_interpreter<uint32>(env, opts, "main", [&](interpreter & interp) { return interp.run_main(argv, argc); });
 }
 
+/*
+@[export lean_compile_pending_decls_for]
+private def compilePendingDeclsForEval (env : Environment) (declName : Name) : Except String Environment
+*/
+extern "C" object * lean_compile_pending_decls_for(object * env, object * decl_name);
+
+/* Return `env` extended with the code of the declarations postponed by `compiler.parallel` that `c` uses. */
+static environment compile_pending_decls(environment const & env, name const & c) {
+    /* When `c` has been compiled, the declarations it depends on were compiled at the same time or before. */
+    if (find_ir_decl(env, c))
+        return env;
+    object * r = lean_compile_pending_decls_for(env.to_obj_arg(), c.to_obj_arg());
+    if (cnstr_tag(r) == 1) {
+        environment new_env(cnstr_get(r, 0), true);
+        dec_ref(r);
+        return new_env;
+    }
+    std::string msg = string_to_std(cnstr_get(r, 0));
+    dec_ref(r);
+    throw exception(msg);
+}
+
 extern "C" LEAN_EXPORT object * lean_eval_const(object * env, object * opts, object * c) {
     try {
-        return mk_cnstr(1, run_boxed(TO_REF(environment, env), TO_REF(options, opts), TO_REF(name, c), 0, 0)).steal();
+        environment new_env = compile_pending_decls(TO_REF(environment, env), TO_REF(name, c));
+        return mk_cnstr(1, run_boxed(new_env, TO_REF(options, opts), TO_REF(name, c), 0, 0)).steal();
     } catch (exception & ex) {
         return mk_cnstr(0, string_ref(ex.what())).steal();
     }
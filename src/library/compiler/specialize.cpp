@@ -104,6 +104,7 @@ extern "C" object* lean_add_specialization_info(object* env, object* fn, object*
 extern "C" object* lean_get_specialization_info(object* env, object* fn);
 
 static environment save_specialization_info(environment const & env, name const & fn, spec_info const & si) {
+    log_codegen_update(codegen_update::SpecInfo, fn, si);
     return environment(lean_add_specialization_info(env.to_obj_arg(), fn.to_obj_arg(), si.to_obj_arg()));
 }
 
@@ -256,6 +257,7 @@ extern "C" object* lean_cache_specialization(object* env, object* e, object* fn)
 extern "C" object* lean_get_cached_specialization(object* env, object* e);
 
 static environment cache_specialization(environment const & env, expr const & k, name const & fn) {
+    log_codegen_update(codegen_update::SpecCache, k, fn);
     return environment(lean_cache_specialization(env.to_obj_arg(), k.to_obj_arg(), fn.to_obj_arg()));
 }
 
@@ -969,7 +971,7 @@ class specialize_fn {
         try {
             expr type = cheap_beta_reduce(type_checker(m_st).infer(code));
             declaration aux_ax = mk_axiom(n, names(), type, true /* meta */);
-            m_st.env() = env().add(aux_ax, false);
+            m_st.env() = add_codegen_decl(env(), aux_ax);
         } catch (exception &) {
             /* We may fail to infer the type of code, since it may be recursive
                This is a workaround. When we re-implement the compiler in Lean,
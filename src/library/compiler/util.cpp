@@ -392,6 +392,9 @@ bool is_runtime_builtin_type(name const & n) {
         n == get_mut_quot_name()  ||
         n == get_byte_array_name()  ||
         n == get_float_array_name()  ||
+        n == get_uint16_array_name()  ||
+        n == get_uint32_array_name()  ||
+        n == get_uint64_array_name()  ||
         n == get_nat_name()    ||
         n == get_int_name();
 }
@@ -554,9 +557,29 @@ expr mk_runtime_type(type_checker::state & st, local_ctx const & lctx, expr e) {
     }
 }
 
+LEAN_THREAD_PTR(buffer<object_ref>, g_codegen_log);
+
+scoped_codegen_log::scoped_codegen_log():m_old_log(g_codegen_log) {
+    g_codegen_log = &m_log;
+}
+
+scoped_codegen_log::~scoped_codegen_log() {
+    g_codegen_log = m_old_log;
+}
+
+void log_codegen_update(codegen_update k, object_ref const & arg1, object_ref const & arg2) {
+    if (g_codegen_log)
+        g_codegen_log->push_back(mk_cnstr(static_cast<unsigned>(k), arg1, arg2));
+}
+
+environment add_codegen_decl(environment const & env, declaration const & d) {
+    log_codegen_update(codegen_update::Decl, d);
+    return env.add(d, false);
+}
+
 environment register_stage1_decl(environment const & env, name const & n, names const & ls, expr const & t, expr const & v) {
     declaration aux_decl = mk_definition(mk_cstage1_name(n), ls, t, v, reducibility_hints::mk_opaque(), definition_safety::unsafe);
-    return env.add(aux_decl, false);
+    return add_codegen_decl(env, aux_decl);
 }
 
 bool is_stage2_decl(environment const & env, name const & n) {
@@ -566,7 +589,7 @@ bool is_stage2_decl(environment const & env, name const & n) {
 environment register_stage2_decl(environment const & env, name const & n, expr const & t, expr const & v) {
     declaration aux_decl = mk_definition(mk_cstage2_name(n), names(), t,
                                          v, reducibility_hints::mk_opaque(), definition_safety::unsafe);
-    return env.add(aux_decl, false);
+    return add_codegen_decl(env, aux_decl);
 }
 
 /* @[export lean.get_num_lit_core]
@@ -168,6 +168,24 @@ bool depends_on(expr const & e, name_hash_set const & s);
 bool is_stage2_decl(environment const & env, name const & n);
 environment register_stage1_decl(environment const & env, name const & n, names const & ls, expr const & t, expr const & v);
 environment register_stage2_decl(environment const & env, name const & n, expr const & t, expr const & v);
+/* Add the auxiliary declaration `d` created by the code generator to `env`. */
+environment add_codegen_decl(environment const & env, declaration const & d);
+
+/* Environment updates performed by the code generator. */
+enum class codegen_update { Decl, SpecInfo, SpecCache, ClosedTerm, IRDecl, BoxedVersion, FunctionSummary };
+
+/* While a `scoped_codegen_log` is active, the environment updates performed by the code generator in the current
+   thread are recorded as `cnstr(kind, arg1, arg2)` objects. They can be replayed on top of a different environment,
+   and are used to compile independent declaration groups in parallel. */
+class scoped_codegen_log {
+    buffer<object_ref> * m_old_log;
+    buffer<object_ref>   m_log;
+public:
+    scoped_codegen_log();
+    ~scoped_codegen_log();
+    buffer<object_ref> const & get_log() const { return m_log; }
+};
+void log_codegen_update(codegen_update k, object_ref const & arg1, object_ref const & arg2 = object_ref(box(0)));
 
 /* Return `some n` iff `e` is of the forms `expr.lit (literal.nat n)` or `uint*.of_nat (expr.lit (literal.nat n))` */
 optional<nat> get_num_lit_ext(expr const & e);
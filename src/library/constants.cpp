@@ -107,6 +107,12 @@ name const * g_uint8 = nullptr;
 name const * g_uint16 = nullptr;
 name const * g_uint32 = nullptr;
 name const * g_uint64 = nullptr;
+name const * g_uint16_array = nullptr;
+name const * g_uint16_array_data = nullptr;
+name const * g_uint32_array = nullptr;
+name const * g_uint32_array_data = nullptr;
+name const * g_uint64_array = nullptr;
+name const * g_uint64_array_data = nullptr;
 name const * g_usize = nullptr;
 void initialize_constants() {
     g_absurd = new name{"absurd"};
@@ -317,6 +323,18 @@ void initialize_constants() {
     mark_persistent(g_uint32->raw());
     g_uint64 = new name{"UInt64"};
     mark_persistent(g_uint64->raw());
+    g_uint16_array = new name{"UInt16Array"};
+    mark_persistent(g_uint16_array->raw());
+    g_uint16_array_data = new name{"UInt16Array", "data"};
+    mark_persistent(g_uint16_array_data->raw());
+    g_uint32_array = new name{"UInt32Array"};
+    mark_persistent(g_uint32_array->raw());
+    g_uint32_array_data = new name{"UInt32Array", "data"};
+    mark_persistent(g_uint32_array_data->raw());
+    g_uint64_array = new name{"UInt64Array"};
+    mark_persistent(g_uint64_array->raw());
+    g_uint64_array_data = new name{"UInt64Array", "data"};
+    mark_persistent(g_uint64_array_data->raw());
     g_usize = new name{"USize"};
     mark_persistent(g_usize->raw());
 }
@@ -425,6 +443,12 @@ void finalize_constants() {
     delete g_uint16;
     delete g_uint32;
     delete g_uint64;
+    delete g_uint16_array;
+    delete g_uint16_array_data;
+    delete g_uint32_array;
+    delete g_uint32_array_data;
+    delete g_uint64_array;
+    delete g_uint64_array_data;
     delete g_usize;
 }
 name const & get_absurd_name() { return *g_absurd; }
@@ -531,5 +555,11 @@ name const & get_uint8_name() { return *g_uint8; }
 name const & get_uint16_name() { return *g_uint16; }
 name const & get_uint32_name() { return *g_uint32; }
 name const & get_uint64_name() { return *g_uint64; }
+name const & get_uint16_array_name() { return *g_uint16_array; }
+name const & get_uint16_array_data_name() { return *g_uint16_array_data; }
+name const & get_uint32_array_name() { return *g_uint32_array; }
+name const & get_uint32_array_data_name() { return *g_uint32_array_data; }
+name const & get_uint64_array_name() { return *g_uint64_array; }
+name const & get_uint64_array_data_name() { return *g_uint64_array_data; }
 name const & get_usize_name() { return *g_usize; }
 }
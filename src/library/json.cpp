@@ -0,0 +1,570 @@
+/*
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <utility>
+#include <vector>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "runtime/object_ref.h"
+#include "runtime/utf8.h"
+
+/*
+Native implementations of `Lean.Json.parseNative`, `Lean.Json.parseUTF8Native` and `Lean.Json.compressNative`
+(see `src/Lean/Data/Json/Native.lean`). They construct and consume the objects of the Lean `Json` type directly
+and must agree with `Json.parse` and `Json.compress` on all inputs (except for the wording of error messages).
+
+The scanning of string contents for characters that end the string or must be escaped, the UTF-8 validation
+of the input and the counting of characters of the strings created use SSE2 when available and process 16
+bytes at a time.
+*/
+
+namespace lean {
+extern "C" object * lean_json_number_to_string(object * n);
+
+/*
+inductive Json where
+  | null | bool (b : Bool) | num (n : JsonNumber) | str (s : String)
+  | arr (elems : Array Json) | obj (kvPairs : RBNode String (fun _ => Json))
+*/
+enum class json_kind { Null, Bool, Num, Str, Arr, Obj };
+
+/* inductive RBColor where | red | black */
+enum class rb_color : uint8 { Red, Black };
+
+/* Return a pointer to the first byte in `[it, end)` that is `"`, `\` or smaller than `0x20`, or `end`. */
+static char const * find_string_special(char const * it, char const * end) {
+#if defined(__SSE2__)
+    __m128i const quote     = _mm_set1_epi8('"');
+    __m128i const backslash = _mm_set1_epi8('\\');
+    __m128i const ctrl_max  = _mm_set1_epi8(0x1f);
+    while (end - it >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(it));
+        __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash));
+        /* unsigned `v <= 0x1f` */
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(_mm_min_epu8(v, ctrl_max), v));
+        int mask = _mm_movemask_epi8(m);
+        if (mask != 0)
+            return it + __builtin_ctz(mask);
+        it += 16;
+    }
+#endif
+    for (; it != end; ++it) {
+        unsigned char c = *it;
+        if (c == '"' || c == '\\' || c < 0x20)
+            return it;
+    }
+    return end;
+}
+
+/* Return the number of unicode scalar values of the valid UTF-8 string `[it, end)`. */
+static size_t count_utf8_chars(char const * it, char const * end) {
+    size_t n = 0;
+#if defined(__SSE2__)
+    /* continuation bytes `0x80-0xbf` are the signed bytes smaller than `-0x40` */
+    __m128i const cont_max = _mm_set1_epi8(-0x41);
+    while (end - it >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(it));
+        int mask = _mm_movemask_epi8(_mm_cmpgt_epi8(v, cont_max));
+        n += __builtin_popcount(mask);
+        it += 16;
+    }
+#endif
+    for (; it != end; ++it) {
+        if ((static_cast<unsigned char>(*it) & 0xc0) != 0x80)
+            n++;
+    }
+    return n;
+}
+
+/* Return true if `[str, str + size)` is valid UTF-8 (in the sense of `String.validateUTF8`). */
+static bool validate_utf8_fast(uint8_t const * str, size_t size) {
+    size_t pos = 0;
+    while (pos < size) {
+#if defined(__SSE2__)
+        /* skip blocks of ASCII characters */
+        if (size - pos >= 16 &&
+            _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const *>(str + pos))) == 0) {
+            pos += 16;
+            continue;
+        }
+#endif
+        if (!validate_utf8_one(str, size, pos))
+            return false;
+    }
+    return true;
+}
+
+static object * mk_json_string(char const * begin, char const * end) {
+    return lean_mk_string_unchecked(begin, end - begin, count_utf8_chars(begin, end));
+}
+
+/* An error at byte offset `m_pos` of the input. */
+struct json_parse_error {
+    size_t       m_pos;
+    char const * m_msg;
+};
+
+/* Maximum nesting depth of arrays and objects accepted by the parser, to bound its stack usage. */
+static constexpr unsigned json_max_depth = 10000;
+
+class json_parser {
+    char const * m_begin;
+    char const * m_it;
+    char const * m_end;
+    unsigned     m_depth = 0;
+    std::string  m_buffer; // contents of strings containing escapes
+
+    [[noreturn]] void error(char const * msg, char const * at) const { throw json_parse_error{size_t(at - m_begin), msg}; }
+    [[noreturn]] void error(char const * msg) const { error(msg, m_it); }
+
+    bool at_end() const { return m_it == m_end; }
+    char peek() const {
+        if (at_end()) error("unexpected end of input");
+        return *m_it;
+    }
+    char next() {
+        char c = peek();
+        m_it++;
+        return c;
+    }
+    static bool is_digit(char c) { return '0' <= c && c <= '9'; }
+
+    void skip_ws() {
+        while (!at_end() && (*m_it == ' ' || *m_it == '\n' || *m_it == '\r' || *m_it == '\t'))
+            m_it++;
+    }
+
+    void expect_keyword(char const * kw) {
+        size_t len = strlen(kw);
+        if (size_t(m_end - m_it) < len || memcmp(m_it, kw, len) != 0) {
+            if (strcmp(kw, "false") == 0) error("expected: false");
+            if (strcmp(kw, "true") == 0) error("expected: true");
+            error("expected: null");
+        }
+        m_it += len;
+    }
+
+    unsigned hex_char() {
+        char c = next();
+        if ('0' <= c && c <= '9') return c - '0';
+        if ('a' <= c && c <= 'f') return c - 'a' + 10;
+        if ('A' <= c && c <= 'F') return c - 'A' + 10;
+        error("invalid hex character");
+    }
+
+    void escaped_char() {
+        switch (next()) {
+        case '\\': m_buffer += '\\'; break;
+        case '"':  m_buffer += '"'; break;
+        case '/':  m_buffer += '/'; break;
+        case 'b':  m_buffer += '\x08'; break;
+        case 'f':  m_buffer += '\x0c'; break;
+        case 'n':  m_buffer += '\n'; break;
+        case 'r':  m_buffer += '\x0d'; break;
+        case 't':  m_buffer += '\t'; break;
+        case 'u': {
+            unsigned u1 = hex_char(); unsigned u2 = hex_char(); unsigned u3 = hex_char(); unsigned u4 = hex_char();
+            unsigned code = 4096*u1 + 256*u2 + 16*u3 + u4;
+            /* `Char.ofNat` maps surrogates to `'\0'` */
+            if (0xd800 <= code && code <= 0xdfff)
+                code = 0;
+            push_unicode_scalar(m_buffer, code);
+            break;
+        }
+        default:
+            error("illegal \\u escape");
+        }
+    }
+
+    /* Parse the rest of a string after the opening quote. */
+    object * string_core() {
+        char const * start = m_it;
+        m_it = find_string_special(m_it, m_end);
+        if (at_end()) error("unexpected end of input");
+        if (*m_it == '"') {
+            object * r = mk_json_string(start, m_it);
+            m_it++;
+            return r;
+        }
+        m_buffer.assign(start, m_it);
+        while (true) {
+            char c = next();
+            if (c == '"') {
+                return mk_json_string(m_buffer.data(), m_buffer.data() + m_buffer.size());
+            } else if (c == '\\') {
+                escaped_char();
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                error("unexpected character in string");
+            } else {
+                m_buffer += c;
+                char const * run = m_it;
+                m_it = find_string_special(m_it, m_end);
+                m_buffer.append(run, m_it);
+            }
+        }
+    }
+
+    /* Parse a sequence of at least one digit. */
+    char const * digits(char const * desc) {
+        char const * start = m_it;
+        if (!is_digit(peek())) error(desc);
+        while (!at_end() && is_digit(*m_it))
+            m_it++;
+        return start;
+    }
+
+    static object * mk_nat_from_digits(std::string const & ds) {
+        if (ds.size() <= 18) {
+            return lean_usize_to_nat(std::stoull(ds));
+        }
+        return lean_cstr_to_nat(ds.c_str());
+    }
+
+    /* See `Lean.Json.Parser.num`. */
+    object * num() {
+        bool neg = false;
+        if (peek() == '-') {
+            neg = true;
+            m_it++;
+        }
+        std::string mantissa;
+        if (peek() == '0') {
+            m_it++;
+            mantissa = "0";
+        } else {
+            if (!('1' <= peek() && peek() <= '9')) error("expected 1-9");
+            char const * start = digits("expected 1-9");
+            mantissa.assign(start, m_it);
+        }
+        size_t exponent = 0;
+        if (!at_end() && *m_it == '.') {
+            m_it++;
+            char const * start = digits("expected digit");
+            mantissa.append(start, m_it);
+            exponent = m_it - start;
+        }
+        object_ref exp_obj;
+        bool big_exponent = false;
+        if (!at_end() && (*m_it == 'e' || *m_it == 'E')) {
+            m_it++;
+            if (peek() == '-') {
+                m_it++;
+                char const * start = digits("expected digit");
+                object_ref shift(mk_nat_from_digits(std::string(start, m_it)));
+                object_ref exp(lean_usize_to_nat(exponent));
+                exp_obj = object_ref(lean_nat_add(shift.raw(), exp.raw()));
+                big_exponent = true;
+            } else {
+                if (peek() == '+') m_it++;
+                char const * start = digits("expected digit");
+                std::string shift_str(start, m_it);
+                shift_str.erase(0, std::min(shift_str.find_first_not_of('0'), shift_str.size()));
+                if (shift_str.size() > 20 || (shift_str.size() == 20 && shift_str > "18446744073709551616"))
+                    error("exp too large");
+                size_t shift = shift_str.empty() ? 0 : std::stoull(shift_str);
+                if (shift <= exponent) {
+                    exponent -= shift;
+                } else {
+                    if (mantissa.find_first_not_of('0') != std::string::npos)
+                        mantissa.append(shift - exponent, '0');
+                    exponent = 0;
+                }
+            }
+        }
+        if (!big_exponent)
+            exp_obj = object_ref(lean_usize_to_nat(exponent));
+        object * m = lean_nat_to_int(mk_nat_from_digits(mantissa));
+        if (neg) {
+            object * n = lean_int_neg(m);
+            lean_dec(m);
+            m = n;
+        }
+        object * r = lean_alloc_ctor(0, 2, 0);
+        lean_ctor_set(r, 0, m);
+        lean_ctor_set(r, 1, exp_obj.steal());
+        return r;
+    }
+
+    static object * mk_rbnode(std::vector<std::pair<object_ref, object_ref>> & kvs, size_t lo, size_t hi,
+                              unsigned depth, unsigned red_depth) {
+        if (lo == hi)
+            return box(0);
+        size_t mid = lo + (hi - lo) / 2;
+        object * l = mk_rbnode(kvs, lo, mid, depth + 1, red_depth);
+        object * r = mk_rbnode(kvs, mid + 1, hi, depth + 1, red_depth);
+        object * n = lean_alloc_ctor(1, 4, 1);
+        lean_ctor_set(n, 0, l);
+        lean_ctor_set(n, 1, kvs[mid].first.steal());
+        lean_ctor_set(n, 2, kvs[mid].second.steal());
+        lean_ctor_set(n, 3, r);
+        lean_ctor_set_uint8(n, sizeof(void*)*4, static_cast<uint8>(depth == red_depth ? rb_color::Red : rb_color::Black));
+        return n;
+    }
+
+    /*
+    Build a red-black tree from the key-value pairs of an object. Keys are sorted by their UTF-8 bytes, which
+    agrees with `compare` on `String`. As in `Json.Parser.objectCore`, the first occurrence of a key wins.
+    The tree is balanced by construction: all levels but the deepest are full, and the nodes of the deepest
+    level (if any below the root) are red.
+    */
+    static object * mk_obj(std::vector<std::pair<object_ref, object_ref>> & kvs) {
+        auto key_lt = [](std::pair<object_ref, object_ref> const & a, std::pair<object_ref, object_ref> const & b) {
+            object * ka = a.first.raw(); object * kb = b.first.raw();
+            size_t sa = lean_string_size(ka) - 1; size_t sb = lean_string_size(kb) - 1;
+            int c = memcmp(lean_string_cstr(ka), lean_string_cstr(kb), std::min(sa, sb));
+            return c < 0 || (c == 0 && sa < sb);
+        };
+        std::stable_sort(kvs.begin(), kvs.end(), key_lt);
+        auto last = std::unique(kvs.begin(), kvs.end(), [&](auto const & a, auto const & b) {
+            return !key_lt(a, b) && !key_lt(b, a);
+        });
+        kvs.erase(last, kvs.end());
+        unsigned height = 0;
+        while ((size_t(2) << height) <= kvs.size())
+            height++;
+        return mk_rbnode(kvs, 0, kvs.size(), 0, height == 0 ? UINT_MAX : height);
+    }
+
+    object * mk_json(json_kind k, object * o) {
+        object * r = lean_alloc_ctor(static_cast<unsigned>(k), 1, 0);
+        lean_ctor_set(r, 0, o);
+        return r;
+    }
+
+    /* See `Lean.Json.Parser.anyCore`. */
+    object * any_core() {
+        char c = peek();
+        if (c == '[' || c == '{') {
+            if (++m_depth > json_max_depth) error("maximum nesting depth exceeded");
+            m_it++;
+            skip_ws();
+            object * r;
+            if (c == '[') {
+                std::vector<object_ref> elems;
+                if (peek() == ']') {
+                    m_it++;
+                } else {
+                    while (true) {
+                        elems.push_back(object_ref(any_core()));
+                        char d = next();
+                        if (d == ']') break;
+                        if (d != ',') error("unexpected character in array", m_it);
+                        skip_ws();
+                    }
+                }
+                object * a = lean_alloc_array(elems.size(), elems.size());
+                for (size_t i = 0; i < elems.size(); i++)
+                    lean_array_set_core(a, i, elems[i].steal());
+                r = mk_json(json_kind::Arr, a);
+            } else {
+                std::vector<std::pair<object_ref, object_ref>> kvs;
+                if (peek() == '}') {
+                    m_it++;
+                } else {
+                    while (true) {
+                        if (peek() != '"') error("expected \"");
+                        m_it++;
+                        object_ref k(string_core());
+                        skip_ws();
+                        if (peek() != ':') error("expected :");
+                        m_it++;
+                        skip_ws();
+                        object_ref v(any_core());
+                        kvs.emplace_back(std::move(k), std::move(v));
+                        char d = next();
+                        if (d == '}') break;
+                        if (d != ',') error("unexpected character in object", m_it);
+                        skip_ws();
+                    }
+                }
+                r = mk_json(json_kind::Obj, mk_obj(kvs));
+            }
+            m_depth--;
+            skip_ws();
+            return r;
+        } else if (c == '"') {
+            m_it++;
+            object * s = string_core();
+            skip_ws();
+            return mk_json(json_kind::Str, s);
+        } else if (c == 'f' || c == 't') {
+            expect_keyword(c == 'f' ? "false" : "true");
+            skip_ws();
+            object * r = lean_alloc_ctor(static_cast<unsigned>(json_kind::Bool), 0, 1);
+            lean_ctor_set_uint8(r, 0, c == 't');
+            return r;
+        } else if (c == 'n') {
+            expect_keyword("null");
+            skip_ws();
+            return box(static_cast<unsigned>(json_kind::Null));
+        } else if (c == '-' || is_digit(c)) {
+            object * n = num();
+            skip_ws();
+            return mk_json(json_kind::Num, n);
+        } else {
+            error("unexpected input");
+        }
+    }
+
+public:
+    json_parser(char const * begin, size_t size):m_begin(begin), m_it(begin), m_end(begin + size) {}
+
+    /* Return `Except String Json`. */
+    object * parse() {
+        try {
+            skip_ws();
+            object_ref r(any_core());
+            if (!at_end()) error("expected end of input");
+            return mk_except_ok(r);
+        } catch (json_parse_error & e) {
+            std::string msg = "offset " + std::to_string(e.m_pos) + ": " + e.m_msg;
+            return mk_except_error_string(msg.c_str());
+        } catch (std::exception & e) {
+            return mk_except_error_string(e.what());
+        }
+    }
+};
+
+/* Json.parseNative (s : @& String) : Except String Json */
+extern "C" LEAN_EXPORT object * lean_json_parse(b_obj_arg s) {
+    return json_parser(lean_string_cstr(s), lean_string_size(s) - 1).parse();
+}
+
+/* Json.parseUTF8Native (bytes : @& ByteArray) : Except String Json */
+extern "C" LEAN_EXPORT object * lean_json_parse_utf8(b_obj_arg bytes) {
+    uint8_t const * data = lean_sarray_cptr(bytes);
+    size_t size = lean_sarray_size(bytes);
+    if (!validate_utf8_fast(data, size))
+        return mk_except_error_string("invalid UTF-8");
+    return json_parser(reinterpret_cast<char const *>(data), size).parse();
+}
+
+/* Append `s` rendered as by `Json.renderString`. */
+static void render_string(std::string & out, b_obj_arg s) {
+    static char const hex[] = "0123456789abcdef";
+    char const * it  = lean_string_cstr(s);
+    char const * end = it + lean_string_size(s) - 1;
+    out += '"';
+    while (true) {
+        char const * special = find_string_special(it, end);
+        out.append(it, special);
+        if (special == end)
+            break;
+        unsigned char c = *special;
+        if (c == '"') {
+            out += "\\\"";
+        } else if (c == '\\') {
+            out += "\\\\";
+        } else if (c == '\n') {
+            out += "\\n";
+        } else if (c == '\r') {
+            out += "\\r";
+        } else {
+            out += "\\u00";
+            out += hex[c / 16];
+            out += hex[c % 16];
+        }
+        it = special + 1;
+    }
+    out += '"';
+}
+
+static void render_number(std::string & out, b_obj_arg n) {
+    object * m = lean_ctor_get(n, 0);
+    object * e = lean_ctor_get(n, 1);
+    if (lean_is_scalar(m) && e == box(0)) {
+        out += std::to_string(lean_scalar_to_int64(m));
+    } else {
+        lean_inc(n);
+        object * s = lean_json_number_to_string(n);
+        out.append(lean_string_cstr(s), lean_string_size(s) - 1);
+        lean_dec(s);
+    }
+}
+
+/* Collect the key-value pairs of `t` in descending order of keys (the order in which `Json.compress` renders them). */
+static void collect_kvs_desc(b_obj_arg t, std::vector<std::pair<object *, object *>> & kvs) {
+    while (!lean_is_scalar(t)) {
+        collect_kvs_desc(lean_ctor_get(t, 3), kvs);
+        kvs.emplace_back(lean_ctor_get(t, 1), lean_ctor_get(t, 2));
+        t = lean_ctor_get(t, 0);
+    }
+}
+
+/* A partially rendered array or object. */
+struct compress_frame {
+    object *                                  m_arr = nullptr;
+    std::vector<std::pair<object *, object *>> m_kvs;
+    size_t                                    m_idx = 0;
+};
+
+/* Append `j`, or its opening bracket if it is an array or an object (pushing a frame for it to `stack`). */
+static void compress_value(std::string & out, b_obj_arg j, std::vector<compress_frame> & stack) {
+    if (lean_is_scalar(j)) {
+        out += "null";
+        return;
+    }
+    switch (static_cast<json_kind>(lean_ptr_tag(j))) {
+    case json_kind::Null:
+        out += "null";
+        break;
+    case json_kind::Bool:
+        out += lean_ctor_get_uint8(j, 0) ? "true" : "false";
+        break;
+    case json_kind::Num:
+        render_number(out, lean_ctor_get(j, 0));
+        break;
+    case json_kind::Str:
+        render_string(out, lean_ctor_get(j, 0));
+        break;
+    case json_kind::Arr:
+        out += '[';
+        stack.emplace_back();
+        stack.back().m_arr = lean_ctor_get(j, 0);
+        break;
+    case json_kind::Obj:
+        out += '{';
+        stack.emplace_back();
+        collect_kvs_desc(lean_ctor_get(j, 0), stack.back().m_kvs);
+        break;
+    }
+}
+
+/* Json.compressNative (j : @& Json) : String */
+extern "C" LEAN_EXPORT object * lean_json_compress(b_obj_arg j) {
+    std::string out;
+    std::vector<compress_frame> stack;
+    compress_value(out, j, stack);
+    while (!stack.empty()) {
+        compress_frame & top = stack.back();
+        if (top.m_arr) {
+            if (top.m_idx == lean_array_size(top.m_arr)) {
+                out += ']';
+                stack.pop_back();
+                continue;
+            }
+            if (top.m_idx > 0) out += ',';
+            object * elem = lean_array_get_core(top.m_arr, top.m_idx++);
+            compress_value(out, elem, stack);
+        } else {
+            if (top.m_idx == top.m_kvs.size()) {
+                out += '}';
+                stack.pop_back();
+                continue;
+            }
+            if (top.m_idx > 0) out += ',';
+            auto kv = top.m_kvs[top.m_idx++];
+            render_string(out, kv.first);
+            out += ':';
+            compress_value(out, kv.second, stack);
+        }
+    }
+    return mk_json_string(out.data(), out.data() + out.size());
+}
+}
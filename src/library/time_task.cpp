@@ -7,11 +7,13 @@ Author: Sebastian Ullrich
 #include <string>
 #include <map>
 #include "library/time_task.h"
+#include "runtime/trace_events.h"
 #include "kernel/trace.h"
 
 namespace lean {
 
 static std::map<std::string, second_duration> * g_cum_times;
+static std::map<std::string, uint64_t> * g_cum_counters;
 static mutex * g_cum_times_mutex;
 LEAN_THREAD_PTR(time_task, g_current_time_task);
 
@@ -20,6 +22,11 @@ void report_profiling_time(std::string const & category, second_duration time) {
     (*g_cum_times)[category] += time;
 }
 
+void report_profiling_counter(std::string const & category, char const * counter, uint64_t value) {
+    lock_guard<mutex> _(*g_cum_times_mutex);
+    (*g_cum_counters)[category + " " + counter] += value;
+}
+
 void display_cumulative_profiling_times(std::ostream & out) {
     if (g_cum_times->empty())
         return;
@@ -27,6 +34,11 @@ void display_cumulative_profiling_times(std::ostream & out) {
     ss << "cumulative profiling times:\n";
     for (auto const & p : *g_cum_times)
         ss << "\t" << p.first << " " << display_profiling_time{p.second} << "\n";
+    if (!g_cum_counters->empty()) {
+        ss << "cumulative profiling counters:\n";
+        for (auto const & p : *g_cum_counters)
+            ss << "\t" << p.first << " " << p.second << "\n";
+    }
     // output atomically, like IO.print
     out << ss.str();
 }
@@ -34,9 +46,11 @@ void display_cumulative_profiling_times(std::ostream & out) {
 void initialize_time_task() {
     g_cum_times_mutex = new mutex;
     g_cum_times = new std::map<std::string, second_duration>;
+    g_cum_counters = new std::map<std::string, uint64_t>;
 }
 
 void finalize_time_task() {
+    delete g_cum_counters;
     delete g_cum_times;
     delete g_cum_times_mutex;
 }
@@ -49,16 +63,50 @@ time_task::time_task(std::string const & category, options const & opts, name de
             ss << m_category;
             if (decl)
                 ss << " of " << decl;
-            ss << " took " << display_profiling_time{duration} << "\n";
+            ss << " took " << display_profiling_time{duration};
+            if (!m_counters.empty())
+                ss << " (" << m_counters << ")";
+            ss << "\n";
             // output atomically, like IO.print
             tout() << ss.str();
         });
         m_parent_task = g_current_time_task;
         g_current_time_task = this;
     }
+    if (trace_events_enabled()) {
+        m_trace_event = true;
+        trace_event_begin("profiler", m_category, decl ? "\"decl\":" + json_escape(decl.to_string()) : std::string());
+    }
+}
+
+void time_task::report_counter(char const * counter, uint64_t value) {
+    if (m_timeit) {
+        if (!m_counters.empty())
+            m_counters += ", ";
+        m_counters += std::string(counter) + ": " + std::to_string(value);
+        report_profiling_counter(m_category, counter, value);
+    }
+    if (m_trace_event) {
+        if (!m_trace_args.empty())
+            m_trace_args += ",";
+        m_trace_args += json_escape(counter) + ":" + std::to_string(value);
+    }
+}
+
+bool time_task::is_enabled(options const & opts) {
+    return get_profiler(opts) || trace_events_enabled();
+}
+
+void time_task::stop() {
+    if (m_timeit)
+        m_timeit->stop();
+    if (m_trace_event && !m_trace_end)
+        m_trace_end = trace_event_timestamp();
 }
 
 time_task::~time_task() {
+    if (m_trace_event)
+        trace_event_end("profiler", m_category, m_trace_args, m_trace_end ? m_trace_end : trace_event_timestamp());
     if (m_timeit) {
         g_current_time_task = m_parent_task;
         report_profiling_time(m_category, m_timeit->get_elapsed());
@@ -12,16 +12,32 @@ Author: Sebastian Ullrich
 
 namespace lean {
 void report_profiling_time(std::string const & category, second_duration time);
+void report_profiling_counter(std::string const & category, char const * counter, uint64_t value);
 void display_cumulative_profiling_times(std::ostream & out);
 
-/** Measure time of some task and report it for the final cumulative profile. */
+/** Measure time of some task and report it for the final cumulative profile.
+    Also records it as a duration event if trace events are enabled (see `runtime/trace_events.h`). */
 class time_task {
     std::string     m_category;
+    std::string     m_counters; // counters reported so far, in `name: value, ...` form
+    std::string     m_trace_args;
     optional<xtimeit> m_timeit;
     time_task *     m_parent_task;
+    bool            m_trace_event{false};
+    uint64_t        m_trace_end{0};     // timestamp of `stop`, if any
 public:
     time_task(std::string const & category, options const & opts, name decl = name());
     ~time_task();
+    /** \brief Return true if the task is measured, i.e., if reporting counters has any effect. */
+    bool is_enabled() const { return m_timeit || m_trace_event; }
+    /** \brief Return true if tasks created with the given options are measured. */
+    static bool is_enabled(options const & opts);
+    /** \brief Attach a counter to this task. It is shown next to the time of the task, accumulated in the cumulative
+        profile, and added to the trace event of the task. */
+    void report_counter(char const * counter, uint64_t value);
+    /** \brief End the measured interval of the task. Counters can still be reported until the task is destroyed,
+        so that computing them is not part of its time. */
+    void stop();
 };
 
 void initialize_time_task();
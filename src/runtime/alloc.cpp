@@ -5,6 +5,8 @@ Released under Apache 2.0 license as described in the file LICENSE.
 Author: Leonardo de Moura
 */
 #include <vector>
+#include <unordered_map>
+#include <cstring>
 #include <lean/lean.h>
 #include "runtime/thread.h"
 #include "runtime/debug.h"
@@ -44,6 +46,11 @@ static atomic<uint64> g_num_segments(0);
 static atomic<uint64> g_num_pages(0);
 static atomic<uint64> g_num_exports(0);
 static atomic<uint64> g_num_recycled_pages(0);
+static atomic<uint64> g_num_arenas(0);
+static atomic<uint64> g_num_arena_pages(0);
+static atomic<uint64> g_num_released_pages(0);
+static atomic<uint64> g_num_promoted(0);
+static atomic<uint64> g_num_escaped(0);
 struct alloc_stats {
     ~alloc_stats() {
         std::cerr << "num. alloc.:         " << g_num_alloc << "\n";
@@ -54,6 +61,11 @@ struct alloc_stats {
         std::cerr << "num. pages:          " << g_num_pages << "\n";
         std::cerr << "num. recycled pages: " << g_num_recycled_pages << "\n";
         std::cerr << "num. exports:        " << g_num_exports << "\n";
+        std::cerr << "num. arenas:         " << g_num_arenas << "\n";
+        std::cerr << "num. arena pages:    " << g_num_arena_pages << "\n";
+        std::cerr << "num. released pages: " << g_num_released_pages << "\n";
+        std::cerr << "num. promoted objs.: " << g_num_promoted << "\n";
+        std::cerr << "num. escaped objs.:  " << g_num_escaped << "\n";
     }
 };
 static alloc_stats g_alloc_stats;
@@ -61,6 +73,16 @@ static alloc_stats g_alloc_stats;
 
 struct heap;
 struct page;
+struct arena;
+
+enum class page_kind : uint8_t {
+    regular,
+    /* Page owned by an active arena. Its free objects are only reused by that arena. */
+    arena,
+    /* Page of a popped arena that still contains live objects. It is released as soon as they have been freed. */
+    retired
+};
+
 struct page_header {
     atomic<heap *>   m_heap;
     page *           m_next;
@@ -71,6 +93,8 @@ struct page_header {
     unsigned         m_num_free;
     unsigned         m_slot_idx;
     bool             m_in_page_free_list;
+    page_kind        m_kind;
+    arena *          m_arena;
 };
 
 struct page {
@@ -84,6 +108,7 @@ struct page {
     heap * get_heap() { return m_header.m_heap; }
     bool has_many_free() const { return m_header.m_num_free > m_header.m_max_free / 4; }
     bool in_page_free_list() const { return m_header.m_in_page_free_list; }
+    bool is_empty() const { return m_header.m_num_free == m_header.m_max_free; }
     unsigned get_slot_idx() const { return m_header.m_slot_idx; }
     void push_free_obj(void * o);
 };
@@ -112,11 +137,31 @@ struct segment {
     }
 };
 
+/* A region of pages for allocating the small objects of a computation whose intermediate data all dies together.
+   Objects are still reference counted and freed as usual, but they do not share pages with objects allocated
+   outside the arena, so that most of its pages can be released at once for reuse by any size class when the arena
+   is popped. */
+struct arena {
+    arena *   m_prev{nullptr}; /* enclosing arena of the same thread */
+    /* As in `heap`, the pages of each size class are either in `m_curr_page` or, when many of their objects have been
+       freed, in `m_page_free_list`, and the latter are reused before new pages are allocated. */
+    page *    m_curr_page[LEAN_NUM_SLOTS];
+    page *    m_page_free_list[LEAN_NUM_SLOTS];
+    arena() {
+        std::fill(m_curr_page, m_curr_page + LEAN_NUM_SLOTS, nullptr);
+        std::fill(m_page_free_list, m_page_free_list + LEAN_NUM_SLOTS, nullptr);
+    }
+};
+
 struct heap {
     segment * m_curr_segment{nullptr};
     heap *    m_next_orphan{nullptr};
     page *    m_curr_page[LEAN_NUM_SLOTS];
     page *    m_page_free_list[LEAN_NUM_SLOTS];
+    /* Innermost active arena of the thread owning this heap. */
+    arena *   m_arena{nullptr};
+    /* Released pages of popped arenas, linked using `m_next`. */
+    page *    m_free_pages{nullptr};
     /* Objects that must be sent to other heaps. */
     void *    m_to_export_list{nullptr};
     unsigned  m_to_export_list_size{0};
@@ -201,11 +246,35 @@ static inline page * page_list_pop(page * & head) {
     return r;
 }
 
+static void release_page(heap * h, page * p) {
+    LEAN_RUNTIME_STAT_CODE(g_num_released_pages++);
+    p->set_next(h->m_free_pages);
+    h->m_free_pages = p;
+}
+
 void page::push_free_obj(void * o) {
     lean_assert(get_page_of(o) == this);
     set_next_obj(o, m_header.m_free_list);
     m_header.m_free_list = o;
     m_header.m_num_free++;
+    if (LEAN_UNLIKELY(m_header.m_kind != page_kind::regular)) {
+        if (m_header.m_kind == page_kind::retired) {
+            if (is_empty())
+                release_page(get_heap(), this);
+            return;
+        }
+        if (!in_page_free_list() && has_many_free()) {
+            arena * a = m_header.m_arena;
+            unsigned slot_idx = m_header.m_slot_idx;
+            if (this != a->m_curr_page[slot_idx]) {
+                LEAN_RUNTIME_STAT_CODE(g_num_recycled_pages++);
+                m_header.m_in_page_free_list = true;
+                page_list_remove(a->m_curr_page[slot_idx], this);
+                page_list_insert(a->m_page_free_list[slot_idx], this);
+            }
+        }
+        return;
+    }
     if (!in_page_free_list() && has_many_free()) {
         heap * h = get_heap();
         unsigned slot_idx = m_header.m_slot_idx;
@@ -276,19 +345,25 @@ void heap::alloc_segment() {
     m_curr_segment = s;
 }
 
-static page * alloc_page(heap * h, unsigned obj_size) {
+static page * new_page(heap * h, unsigned obj_size) {
     lean_assert(lean_align(obj_size, LEAN_OBJECT_SIZE_DELTA) == obj_size);
-    segment * s = h->m_curr_segment;
-    LEAN_RUNTIME_STAT_CODE(g_num_pages++);
-    page * p    = new (s->m_next_page_mem) page();
-    s->m_next_page_mem += LEAN_PAGE_SIZE;
-    if (s->is_full()) {
-        /* s is full, we need to allocate a new one. */
-        h->alloc_segment();
+    void * mem;
+    if (h->m_free_pages) {
+        mem = h->m_free_pages;
+        h->m_free_pages = h->m_free_pages->get_next();
+    } else {
+        segment * s = h->m_curr_segment;
+        LEAN_RUNTIME_STAT_CODE(g_num_pages++);
+        mem = s->m_next_page_mem;
+        s->m_next_page_mem += LEAN_PAGE_SIZE;
+        if (s->is_full()) {
+            /* s is full, we need to allocate a new one. */
+            h->alloc_segment();
+        }
     }
+    page * p                 = new (mem) page();
     unsigned slot_idx        = lean_get_slot_idx(obj_size);
     p->m_header.m_heap       = h;
-    page_list_insert(h->m_curr_page[slot_idx], p);
     p->m_header.m_slot_idx   = slot_idx;
     p->m_header.m_obj_size   = obj_size;
     char * curr_free         = p->m_data;
@@ -318,6 +393,23 @@ static page * alloc_page(heap * h, unsigned obj_size) {
     p->m_header.m_max_free   = num_free;
     p->m_header.m_num_free   = num_free;
     p->m_header.m_in_page_free_list = false;
+    p->m_header.m_kind       = page_kind::regular;
+    p->m_header.m_arena      = nullptr;
+    return p;
+}
+
+static page * alloc_page(heap * h, unsigned obj_size) {
+    page * p = new_page(h, obj_size);
+    page_list_insert(h->m_curr_page[p->get_slot_idx()], p);
+    return p;
+}
+
+static page * alloc_arena_page(heap * h, arena * a, unsigned obj_size) {
+    LEAN_RUNTIME_STAT_CODE(g_num_arena_pages++);
+    page * p = new_page(h, obj_size);
+    p->m_header.m_kind  = page_kind::arena;
+    p->m_header.m_arena = a;
+    page_list_insert(a->m_curr_page[p->get_slot_idx()], p);
     return p;
 }
 
@@ -381,9 +473,36 @@ void * lean_alloc_small_cold(unsigned sz, unsigned slot_idx, page * p) {
     return r;
 }
 
+LEAN_NOINLINE
+static void * arena_alloc_small(arena * a, unsigned sz, unsigned slot_idx) {
+    page * p = a->m_curr_page[slot_idx];
+    if (p == nullptr || p->m_header.m_free_list == nullptr) {
+        if (a->m_page_free_list[slot_idx] == nullptr) {
+            /* g_heap->import_objs() may add objects to p->m_header.m_free_list or to a->m_page_free_list */
+            g_heap->import_objs();
+        }
+        if (p != nullptr && p->m_header.m_free_list != nullptr) {
+            /* reuse objects imported into the current page */
+        } else if (a->m_page_free_list[slot_idx] != nullptr) {
+            p = page_list_pop(a->m_page_free_list[slot_idx]);
+            p->m_header.m_in_page_free_list = false;
+            page_list_insert(a->m_curr_page[slot_idx], p);
+        } else {
+            p = alloc_arena_page(g_heap, a, sz);
+        }
+    }
+    void * r = p->m_header.m_free_list;
+    p->m_header.m_free_list = get_next_obj(r);
+    p->m_header.m_num_free--;
+    lean_assert(get_page_of(r) == p);
+    return r;
+}
+
 extern "C" LEAN_EXPORT void * lean_alloc_small(unsigned sz, unsigned slot_idx) {
-    page * p = g_heap->m_curr_page[slot_idx];
     g_heap->m_heartbeat++;
+    if (LEAN_UNLIKELY(g_heap->m_arena != nullptr))
+        return arena_alloc_small(g_heap->m_arena, sz, slot_idx);
+    page * p = g_heap->m_curr_page[slot_idx];
     void * r = p->m_header.m_free_list;
     if (LEAN_UNLIKELY(r == nullptr)) {
         return lean_alloc_small_cold(sz, slot_idx, p);
@@ -451,6 +570,174 @@ extern "C" LEAN_EXPORT unsigned lean_small_mem_size(void * o) {
     return p->m_header.m_obj_size;
 }
 
+/* Return `true` if `o` is a single-threaded object allocated in the arena `a` that `arena_promote` may move. */
+static bool is_movable_kind(arena * a, lean_object * o) {
+    if (lean_is_scalar(o) || o->m_rc <= 0)
+        return false;
+    uint8_t tag = lean_ptr_tag(o);
+    if (tag > LeanMaxCtorTag) {
+        switch (tag) {
+        case LeanClosure: case LeanMPZ:
+            break;
+        case LeanArray: case LeanScalarArray: case LeanString:
+            if (lean_object_byte_size(o) > LEAN_MAX_SMALL_OBJECT_SIZE)
+                return false;
+            break;
+        default:
+            /* Thunks, tasks, references and external objects are never moved. */
+            return false;
+        }
+    }
+    return get_page_of(o)->m_header.m_arena == a;
+}
+
+template<typename F> static void for_each_field(lean_object * o, F && f) {
+    uint8_t tag = lean_ptr_tag(o);
+    lean_object ** it;
+    lean_object ** end;
+    if (tag <= LeanMaxCtorTag) {
+        it  = lean_ctor_obj_cptr(o);
+        end = it + lean_ctor_num_objs(o);
+    } else if (tag == LeanClosure) {
+        it  = lean_closure_arg_cptr(o);
+        end = it + lean_closure_num_fixed(o);
+    } else if (tag == LeanArray) {
+        it  = lean_array_cptr(o);
+        end = it + lean_array_size(o);
+    } else {
+        return;
+    }
+    for (; it != end; ++it) f(it);
+}
+
+struct promote_info {
+    /* Number of references from objects of the subgraph. */
+    unsigned      m_refs{0};
+    /* `true` if the object may be referenced from outside the subgraph, directly or indirectly. */
+    bool          m_pinned{false};
+    lean_object * m_copy{nullptr};
+};
+
+/* Move the objects of arena `a` that are only reachable from `root` out of the arena, i.e., copy them into the
+   current allocation context, and free the originals. As reference counts are exact, an object can be moved if all
+   its references come from objects that are moved as well. This is the same kind of graph traversal as
+   `lean_mark_persistent`, but restricted to the objects of `a`. */
+static lean_object * arena_promote(arena * a, lean_object * root) {
+    if (!is_movable_kind(a, root))
+        return root;
+    std::unordered_map<lean_object *, promote_info> info;
+    std::vector<lean_object *> objs;
+    std::vector<lean_object *> todo;
+    info[root].m_refs = 1; // reference owned by the caller
+    todo.push_back(root);
+    while (!todo.empty()) {
+        lean_object * o = todo.back();
+        todo.pop_back();
+        objs.push_back(o);
+        for_each_field(o, [&](lean_object ** c) {
+            if (is_movable_kind(a, *c)) {
+                auto r = info.emplace(*c, promote_info());
+                r.first->second.m_refs++;
+                if (r.second)
+                    todo.push_back(*c);
+            }
+        });
+    }
+    for (lean_object * o : objs) {
+        promote_info & i = info[o];
+        if (static_cast<unsigned>(o->m_rc) != i.m_refs) {
+            i.m_pinned = true;
+            todo.push_back(o);
+        }
+    }
+    while (!todo.empty()) {
+        lean_object * o = todo.back();
+        todo.pop_back();
+        for_each_field(o, [&](lean_object ** c) {
+            auto it = info.find(*c);
+            if (it != info.end() && !it->second.m_pinned) {
+                it->second.m_pinned = true;
+                todo.push_back(*c);
+            }
+        });
+    }
+    if (info[root].m_pinned)
+        return root;
+    for (lean_object * o : objs) {
+        promote_info & i = info[o];
+        if (!i.m_pinned) {
+            unsigned sz = lean_small_object_size(o);
+            i.m_copy    = lean_alloc_small_object(sz);
+            memcpy(i.m_copy, o, sz);
+        }
+    }
+    for (lean_object * o : objs) {
+        promote_info & i = info[o];
+        if (i.m_copy) {
+            for_each_field(i.m_copy, [&](lean_object ** c) {
+                auto it = info.find(*c);
+                if (it != info.end() && it->second.m_copy)
+                    *c = it->second.m_copy;
+            });
+            // the fields are now owned by the copy
+            lean_free_small_object(o);
+            LEAN_RUNTIME_STAT_CODE(g_num_promoted++);
+        }
+    }
+    return info[root].m_copy;
+}
+
+extern "C" LEAN_EXPORT void lean_arena_push() {
+    if (LEAN_UNLIKELY(g_heap == nullptr)) {
+        init_heap(false);
+    }
+    LEAN_RUNTIME_STAT_CODE(g_num_arenas++);
+    arena * a  = new arena();
+    a->m_prev  = g_heap->m_arena;
+    g_heap->m_arena = a;
+}
+
+/* Release the empty pages of the list `p` of a popped arena, and mark the other ones as retired. */
+static void retire_arena_pages(heap * h, page * p) {
+    while (p) {
+        page * next = p->get_next();
+        p->m_header.m_arena = nullptr;
+        p->m_header.m_in_page_free_list = false;
+        if (p->is_empty()) {
+            release_page(h, p);
+        } else {
+            /* Some objects escaped the arena, e.g., because they were stored in a reference or returned by the
+               computation but shared with other data. */
+            LEAN_RUNTIME_STAT_CODE(g_num_escaped += p->m_header.m_max_free - p->m_header.m_num_free);
+            p->m_header.m_kind = page_kind::retired;
+        }
+        p = next;
+    }
+}
+
+extern "C" LEAN_EXPORT lean_obj_res lean_arena_pop(lean_obj_arg r) {
+    heap * h = g_heap;
+    arena * a = h->m_arena;
+    lean_assert(a);
+    h->m_arena = a->m_prev;
+    r = arena_promote(a, r);
+    for (unsigned i = 0; i < LEAN_NUM_SLOTS; i++) {
+        retire_arena_pages(h, a->m_curr_page[i]);
+        retire_arena_pages(h, a->m_page_free_list[i]);
+    }
+    delete a;
+    return r;
+}
+
+#else
+
+extern "C" LEAN_EXPORT void lean_arena_push() {
+}
+
+extern "C" LEAN_EXPORT lean_obj_res lean_arena_pop(lean_obj_arg r) {
+    return r;
+}
+
 #endif
 
 void initialize_alloc() {
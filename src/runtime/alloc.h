@@ -7,6 +7,7 @@ Author: Leonardo de Moura
 #pragma once
 #include <stddef.h>
 #include <stdint.h>
+#include <lean/lean.h>
 
 namespace lean {
 void init_thread_heap();
@@ -16,4 +17,19 @@ void add_heartbeats(uint64_t count);
 uint64_t get_num_heartbeats();
 void initialize_alloc();
 void finalize_alloc();
+
+/* Allocate the small objects of the current thread from a fresh arena while this object is alive.
+   See `lean_arena_push`. */
+class scoped_arena {
+    bool m_active;
+public:
+    explicit scoped_arena(bool enable = true):m_active(enable) { if (m_active) lean_arena_push(); }
+    ~scoped_arena() { if (m_active) lean_arena_pop(lean_box(0)); }
+    /* End the arena before destruction, moving `r` out of it if possible. */
+    lean_object * pop(lean_object * r) {
+        if (!m_active) return r;
+        m_active = false;
+        return lean_arena_pop(r);
+    }
+};
 }
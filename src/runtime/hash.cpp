@@ -4,6 +4,8 @@ Released under Apache 2.0 license as described in the file LICENSE.
 
 Author: Leonardo de Moura
 */
+#include <cstring>
+#include <algorithm>
 #include "runtime/hash.h"
 
 namespace lean {
@@ -55,4 +57,143 @@ uint64 hash_str(size_t len, unsigned char const * str, uint64 init_value) {
     return MurmurHash64A(str, len, init_value);
 }
 
+static const uint64 g_murmur_m = 0xc6a4a7935bd1e995;
+static const int    g_murmur_r = 47;
+
+murmur_hasher::murmur_hasher(size_t len, uint64 init_value):
+    m_h(init_value ^ (len * g_murmur_m)), m_pending(0) {}
+
+void murmur_hasher::add(unsigned char const * str, size_t len) {
+    auto absorb = [&](unsigned char const * block) {
+        uint64 k;
+        memcpy(&k, block, sizeof(k));
+        k *= g_murmur_m;
+        k ^= k >> g_murmur_r;
+        k *= g_murmur_m;
+        m_h ^= k;
+        m_h *= g_murmur_m;
+    };
+    if (m_pending > 0) {
+        size_t n = std::min(len, sizeof(m_buf) - m_pending);
+        memcpy(m_buf + m_pending, str, n);
+        m_pending += n;
+        str += n;
+        len -= n;
+        if (m_pending < sizeof(m_buf))
+            return;
+        absorb(m_buf);
+        m_pending = 0;
+    }
+    for (; len >= sizeof(m_buf); str += sizeof(m_buf), len -= sizeof(m_buf))
+        absorb(str);
+    memcpy(m_buf, str, len);
+    m_pending = len;
+}
+
+uint64 murmur_hasher::get() const {
+    uint64 h = m_h;
+    if (m_pending > 0) {
+        for (size_t i = m_pending; i > 0; i--)
+            h ^= uint64(m_buf[i - 1]) << (8 * (i - 1));
+        h *= g_murmur_m;
+    }
+    h ^= h >> g_murmur_r;
+    h *= g_murmur_m;
+    h ^= h >> g_murmur_r;
+    return h;
+}
+
+//-----------------------------------------------------------------------------
+// Based on wyhash (final version 4), by Wang Yi
+// https://github.com/wangyi-fudan/wyhash
+static const uint64 wyp[4] = {0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull};
+
+static inline void wymum(uint64 * a, uint64 * b) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = *a;
+    r *= *b;
+    *a = static_cast<uint64>(r);
+    *b = static_cast<uint64>(r >> 64);
+#else
+    uint64 ha = *a >> 32, hb = *b >> 32, la = static_cast<uint32_t>(*a), lb = static_cast<uint32_t>(*b);
+    uint64 rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32), c = t < rl;
+    uint64 lo = t + (rm1 << 32);
+    c += lo < t;
+    uint64 hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+    *a = lo;
+    *b = hi;
+#endif
+}
+
+static inline uint64 wymix(uint64 a, uint64 b) {
+    wymum(&a, &b);
+    return a ^ b;
+}
+
+// Remark: we assume little-endian platforms, as does the rest of the runtime.
+static inline uint64 wyr8(unsigned char const * p) { uint64 v; memcpy(&v, p, 8); return v; }
+static inline uint64 wyr4(unsigned char const * p) { uint32_t v; memcpy(&v, p, 4); return v; }
+static inline uint64 wyr3(unsigned char const * p, size_t k) {
+    return (static_cast<uint64>(p[0]) << 16) | (static_cast<uint64>(p[k >> 1]) << 8) | p[k - 1];
+}
+
+static inline uint64 wyinit(uint64 seed) {
+    return seed ^ wymix(seed ^ wyp[0], wyp[1]);
+}
+
+/* Absorb a 48-byte stripe. */
+static inline void wystripe(unsigned char const * p, uint64 & seed, uint64 & see1, uint64 & see2) {
+    seed = wymix(wyr8(p) ^ wyp[1], wyr8(p + 8) ^ seed);
+    see1 = wymix(wyr8(p + 16) ^ wyp[2], wyr8(p + 24) ^ see1);
+    see2 = wymix(wyr8(p + 32) ^ wyp[3], wyr8(p + 40) ^ see2);
+}
+
+/* Hash the final `i` bytes at `p` of an input longer than 16 bytes. When `i < 16`,
+   the bytes before `p` must contain the preceding input. */
+static inline uint64 wyfinish(unsigned char const * p, size_t i, size_t len, uint64 seed) {
+    while (i > 16) {
+        seed = wymix(wyr8(p) ^ wyp[1], wyr8(p + 8) ^ seed);
+        i -= 16;
+        p += 16;
+    }
+    uint64 a = wyr8(p + i - 16) ^ wyp[1];
+    uint64 b = wyr8(p + i - 8) ^ seed;
+    wymum(&a, &b);
+    return wymix(a ^ wyp[0] ^ len, b ^ wyp[1]);
+}
+
+/* Hash inputs of at most 16 bytes. */
+static inline uint64 wysmall(unsigned char const * p, size_t len, uint64 seed) {
+    uint64 a, b;
+    if (len >= 4) {
+        a = (wyr4(p) << 32) | wyr4(p + ((len >> 3) << 2));
+        b = (wyr4(p + len - 4) << 32) | wyr4(p + len - 4 - ((len >> 3) << 2));
+    } else if (len > 0) {
+        a = wyr3(p, len);
+        b = 0;
+    } else {
+        a = b = 0;
+    }
+    a ^= wyp[1];
+    b ^= seed;
+    wymum(&a, &b);
+    return wymix(a ^ wyp[0] ^ len, b ^ wyp[1]);
+}
+
+uint64 hash_bytes(size_t len, unsigned char const * p, uint64 seed) {
+    seed = wyinit(seed);
+    if (len <= 16)
+        return wysmall(p, len, seed);
+    size_t i = len;
+    if (i > 48) {
+        uint64 see1 = seed, see2 = seed;
+        do {
+            wystripe(p, seed, see1, see2);
+            p += 48;
+            i -= 48;
+        } while (i > 48);
+        seed ^= see1 ^ see2;
+    }
+    return wyfinish(p, i, len, seed);
+}
 }
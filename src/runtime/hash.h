@@ -10,8 +10,26 @@ Author: Leonardo de Moura
 
 namespace lean {
 
+/* MurmurHash64A. Hash values produced by this function are stored in .olean files
+   (e.g., `Name` hashes), so it must not be changed. */
 uint64 hash_str(size_t len, unsigned char const * str, uint64 init_value);
 
+/* Streaming interface for `hash_str`. MurmurHash64A mixes the length into its initial
+   state, so the total number of bytes must be known in advance. */
+class murmur_hasher {
+    uint64        m_h;
+    size_t        m_pending;
+    unsigned char m_buf[8];
+public:
+    murmur_hasher(size_t len, uint64 init_value);
+    void add(unsigned char const * str, size_t len);
+    uint64 get() const;
+};
+
+/* Fast seedable hash (wyhash) for in-memory tables. Unlike `hash_str`, its values
+   must not be persisted since the algorithm may change between versions. */
+uint64 hash_bytes(size_t len, unsigned char const * str, uint64 seed);
+
 inline uint64 hash(uint64 h, uint64 k) {
     uint64 m = 0xc6a4a7935bd1e995;
     uint64 r = 47;
@@ -12,6 +12,7 @@ Author: Leonardo de Moura
 #include "runtime/stack_overflow.h"
 #include "runtime/process.h"
 #include "runtime/mutex.h"
+#include "runtime/trace_events.h"
 #include "runtime/init_module.h"
 
 namespace lean {
@@ -24,11 +25,13 @@ extern "C" LEAN_EXPORT void lean_initialize_runtime_module() {
     initialize_mutex();
     initialize_process();
     initialize_stack_overflow();
+    initialize_trace_events();
 }
 void initialize_runtime_module() {
     lean_initialize_runtime_module();
 }
 void finalize_runtime_module() {
+    finalize_trace_events();
     finalize_stack_overflow();
     finalize_process();
     finalize_mutex();
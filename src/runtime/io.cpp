@@ -39,6 +39,9 @@ Authors: Leonardo de Moura, Sebastian Ullrich
 #include <cstdlib>
 #include <cctype>
 #include <sys/stat.h>
+#include <algorithm>
+#include <cstring>
+#include <memory>
 #include "util/io.h"
 #include "runtime/alloc.h"
 #include "runtime/io.h"
@@ -46,6 +49,7 @@ Authors: Leonardo de Moura, Sebastian Ullrich
 #include "runtime/object.h"
 #include "runtime/thread.h"
 #include "runtime/allocprof.h"
+#include "runtime/hash.h"
 
 #ifdef _MSC_VER
 #define S_ISDIR(mode) ((mode & _S_IFDIR) != 0)
@@ -251,6 +255,42 @@ extern "C" LEAN_EXPORT obj_res lean_decode_io_error(int errnum, b_obj_arg fname)
     }
 }
 
+#ifdef LEAN_WINDOWS
+/* Like `decode_io_error`, but for the Windows error code `err` (see `GetLastError`). */
+static obj_res decode_win_io_error(DWORD err, b_obj_arg fname) {
+    int errnum;
+    switch (err) {
+    case ERROR_FILE_NOT_FOUND: case ERROR_PATH_NOT_FOUND: case ERROR_INVALID_DRIVE:
+        errnum = ENOENT; break;
+    case ERROR_ACCESS_DENIED: case ERROR_SHARING_VIOLATION: case ERROR_LOCK_VIOLATION:
+        errnum = EACCES; break;
+    case ERROR_WRITE_PROTECT:
+        errnum = EROFS; break;
+    case ERROR_ALREADY_EXISTS: case ERROR_FILE_EXISTS:
+        errnum = EEXIST; break;
+    case ERROR_TOO_MANY_LINKS:
+        errnum = EMLINK; break;
+    case ERROR_DISK_FULL: case ERROR_HANDLE_DISK_FULL:
+        errnum = ENOSPC; break;
+    case ERROR_NOT_ENOUGH_MEMORY: case ERROR_OUTOFMEMORY:
+        errnum = ENOMEM; break;
+    case ERROR_INVALID_NAME: case ERROR_BAD_PATHNAME: case ERROR_INVALID_PARAMETER:
+        errnum = EINVAL; break;
+    case ERROR_FILENAME_EXCED_RANGE:
+        errnum = ENAMETOOLONG; break;
+    case ERROR_DIRECTORY:
+        errnum = ENOTDIR; break;
+    case ERROR_NOT_SAME_DEVICE:
+        return decode_io_error(EXDEV, nullptr);
+    case ERROR_NOT_SUPPORTED: case ERROR_INVALID_FUNCTION:
+        return decode_io_error(ENOSYS, nullptr);
+    default:
+        return lean_mk_io_error_other_error(err, mk_string((sstream() << "Windows error " << err).str()));
+    }
+    return decode_io_error(errnum, fname);
+}
+#endif
+
 /* IO.setAccessRights (filename : @& String) (mode : UInt32) : IO Handle */
 extern "C" LEAN_EXPORT obj_res lean_chmod (b_obj_arg filename, uint32_t mode, obj_arg /* w */) {
     if (!chmod(lean_string_cstr(filename), mode)) {
@@ -639,6 +679,13 @@ extern "C" LEAN_EXPORT obj_res lean_io_get_num_heartbeats(obj_arg /* w */) {
     return io_result_mk_ok(lean_uint64_to_nat(get_num_heartbeats()));
 }
 
+/* withArena (act : EIO ε α) : EIO ε α */
+extern "C" LEAN_EXPORT obj_res lean_io_with_arena(obj_arg act, obj_arg w) {
+    scoped_arena arena;
+    object * r = apply_1(act, w);
+    return arena.pop(r);
+}
+
 /* addHeartbeats (count : Int64) : BaseIO Unit */
 extern "C" LEAN_EXPORT obj_res lean_io_add_heartbeats(int64_t count, obj_arg /* w */) {
     add_heartbeats(count);
@@ -819,9 +866,11 @@ extern "C" LEAN_EXPORT obj_res lean_io_rename(b_obj_arg from, b_obj_arg to, lean
     // with the unix-like OSs
     bool ok = MoveFileEx(string_cstr(from), string_cstr(to), MOVEFILE_REPLACE_EXISTING) != 0;
     if (!ok) {
-        // TODO: actually produce the right type of IO error
-        return io_result_mk_error((sstream()
-            << "failed to rename '" << string_cstr(from) << "' to '" << string_cstr(to) << "': " << GetLastError()).str());
+        DWORD err = GetLastError();
+        std::ostringstream s;
+        s << string_cstr(from) << " and/or " << string_cstr(to);
+        object_ref out{mk_string(s.str())};
+        return io_result_mk_error(decode_win_io_error(err, out.raw()));
     }
 #else
     bool ok = std::rename(string_cstr(from), string_cstr(to)) == 0;
@@ -835,6 +884,26 @@ extern "C" LEAN_EXPORT obj_res lean_io_rename(b_obj_arg from, b_obj_arg to, lean
     return io_result_mk_ok(box(0));
 }
 
+extern "C" LEAN_EXPORT obj_res lean_io_hard_link(b_obj_arg target, b_obj_arg link_path, obj_arg) {
+#ifdef LEAN_WINDOWS
+    if (!CreateHardLinkA(string_cstr(link_path), string_cstr(target), NULL)) {
+        DWORD err = GetLastError();
+        std::ostringstream s;
+        s << string_cstr(target) << " and/or " << string_cstr(link_path);
+        object_ref out{mk_string(s.str())};
+        return io_result_mk_error(decode_win_io_error(err, out.raw()));
+    }
+#else
+    if (link(string_cstr(target), string_cstr(link_path)) != 0) {
+        std::ostringstream s;
+        s << string_cstr(target) << " and/or " << string_cstr(link_path);
+        object_ref out{mk_string(s.str())};
+        return io_result_mk_error(decode_io_error(errno, out.raw()));
+    }
+#endif
+    return io_result_mk_ok(box(0));
+}
+
 extern "C" LEAN_EXPORT obj_res lean_io_remove_file(b_obj_arg fname, obj_arg) {
     if (std::remove(string_cstr(fname)) == 0) {
         return io_result_mk_ok(box(0));
@@ -843,6 +912,125 @@ extern "C" LEAN_EXPORT obj_res lean_io_remove_file(b_obj_arg fname, obj_arg) {
     }
 }
 
+static size_t g_hash_file_chunk_size     = 64 * 1024;
+static size_t g_hash_file_mmap_threshold = 1024 * 1024;
+
+/* Invoke `fn(data, n)` on consecutive chunks of the first `size` bytes of the file `fd`.
+   Large files are memory mapped instead of being copied into a buffer.
+   Return `false` if reading failed, in which case `errno` is set. */
+template<typename F> static bool for_each_file_chunk(int fd, size_t size, F && fn) {
+#if !defined(LEAN_WINDOWS) && !defined(LEAN_EMSCRIPTEN)
+    if (size >= g_hash_file_mmap_threshold) {
+        void * data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            madvise(data, size, MADV_SEQUENTIAL);
+            fn(static_cast<unsigned char const *>(data), size);
+            munmap(data, size);
+            return true;
+        }
+        // fall back to `read`, e.g. on file systems that do not support `mmap`
+    }
+#endif
+    if (lseek(fd, 0, SEEK_SET) < 0)
+        return false;
+    std::unique_ptr<unsigned char[]> buf(new unsigned char[g_hash_file_chunk_size]);
+    while (size > 0) {
+        auto n = read(fd, buf.get(), static_cast<unsigned>(std::min(size, g_hash_file_chunk_size)));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (n == 0)
+            break; // file was truncated concurrently
+        fn(buf.get(), static_cast<size_t>(n));
+        size -= n;
+    }
+    return true;
+}
+
+/* Number of `\r\n` pairs in the first `size` bytes of `fd`. `pending_cr` tracks a `\r` at the end of the previous chunk. */
+static bool count_crlf(int fd, size_t size, size_t & r) {
+    bool pending_cr = false;
+    r = 0;
+    return for_each_file_chunk(fd, size, [&](unsigned char const * data, size_t n) {
+        if (pending_cr && data[0] == '\n') r++;
+        unsigned char const * end = data + n;
+        unsigned char const * it  = data;
+        while ((it = static_cast<unsigned char const *>(memchr(it, '\r', end - it))) != nullptr) {
+            it++;
+            if (it < end && *it == '\n') r++;
+        }
+        pending_cr = data[n-1] == '\r';
+    });
+}
+
+/*
+  Hash the contents of a file without loading it into memory.
+  The result coincides with `lean_byte_array_hash` on the file contents, or, if `normalize_eol` is set,
+  with `lean_string_hash` on the contents after replacing every `\r\n` with `\n` (i.e., `String.crlfToLf`).
+  Since `hash_str` needs the length up front, normalization makes two passes over the file.
+*/
+extern "C" LEAN_EXPORT obj_res lean_io_hash_file(b_obj_arg fname, uint8 normalize_eol, obj_arg) {
+#ifdef LEAN_WINDOWS
+    int fd = open(string_cstr(fname), O_RDONLY | O_BINARY | O_NOINHERIT);
+#else
+    int fd = open(string_cstr(fname), O_RDONLY | O_CLOEXEC);
+#endif
+    if (fd == -1)
+        return io_result_mk_error(decode_io_error(errno, fname));
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int err = errno;
+        close(fd);
+        return io_result_mk_error(decode_io_error(err, fname));
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    bool ok;
+    uint64 h;
+    if (!normalize_eol) {
+        murmur_hasher hasher(size, 11);
+        ok = for_each_file_chunk(fd, size, [&](unsigned char const * data, size_t n) { hasher.add(data, n); });
+        h = hasher.get();
+    } else {
+        size_t num_crlf = 0;
+        ok = count_crlf(fd, size, num_crlf);
+        murmur_hasher hasher(size - num_crlf, 11);
+        // A `\r` at the end of a chunk is held back until we know whether the next chunk starts with `\n`.
+        bool pending_cr = false;
+        if (ok) ok = for_each_file_chunk(fd, size, [&](unsigned char const * data, size_t n) {
+            size_t start = 0;
+            if (pending_cr && data[0] != '\n')
+                hasher.add(reinterpret_cast<unsigned char const *>("\r"), 1);
+            pending_cr = false;
+            unsigned char const * end = data + n;
+            unsigned char const * it  = data;
+            while ((it = static_cast<unsigned char const *>(memchr(it, '\r', end - it))) != nullptr) {
+                size_t pos = it - data;
+                if (pos + 1 == n) {
+                    hasher.add(data + start, pos - start);
+                    pending_cr = true;
+                    start = n;
+                    break;
+                }
+                if (data[pos + 1] == '\n') {
+                    hasher.add(data + start, pos - start);
+                    start = pos + 1;
+                }
+                it++;
+            }
+            hasher.add(data + start, n - start);
+        });
+        if (pending_cr)
+            hasher.add(reinterpret_cast<unsigned char const *>("\r"), 1);
+        h = hasher.get();
+    }
+    int err = errno;
+    close(fd);
+    if (!ok)
+        return io_result_mk_error(decode_io_error(err, fname));
+    return io_result_mk_ok(box_uint64(h));
+}
+
 extern "C" LEAN_EXPORT obj_res lean_io_app_path(obj_arg) {
 #if defined(LEAN_WINDOWS)
     HMODULE hModule = GetModuleHandle(NULL);
@@ -17,6 +17,8 @@ Revision History:
 
 --*/
 #include <stdint.h>
+#include <algorithm>
+#include <vector>
 #include "runtime/mpn.h"
 #include "runtime/debug.h"
 #include "runtime/buffer.h"
@@ -30,6 +32,27 @@ static_assert(sizeof(mpn_double_digit) == 2 * sizeof(mpn_digit), "size alignment
 
 static const mpn_digit zero = 0;
 
+class  mpn_buffer : public buffer<mpn_digit> {
+public:
+    mpn_buffer() : buffer<mpn_digit>() {}
+
+    mpn_buffer(size_t nsz, const mpn_digit & elem = 0):buffer<mpn_digit>() {
+        for (size_t i = 0; i < nsz; i++) push_back(elem);
+    }
+
+    void resize(size_t nsz, const mpn_digit & elem = 0) {
+        buffer<mpn_digit>::resize(static_cast<unsigned>(nsz), elem);
+    }
+
+    mpn_digit & operator[](size_t idx) {
+        return buffer<mpn_digit>::operator[](static_cast<unsigned>(idx));
+    }
+
+    const mpn_digit & operator[](size_t idx) const {
+        return buffer<mpn_digit>::operator[](static_cast<unsigned>(idx));
+    }
+};
+
 int mpn_compare(mpn_digit const * a, size_t const lnga,
                 mpn_digit const * b, size_t const lngb) {
     int res = 0;
@@ -86,17 +109,64 @@ void mpn_sub(mpn_digit const * a, size_t const lnga,
     }
 }
 
-void mpn_mul(mpn_digit const * a, size_t const lnga,
-             mpn_digit const * b, size_t const lngb,
-             mpn_digit * c) {
+#define DIGIT_BITS (sizeof(mpn_digit)*8)
+#define HALF_BITS (sizeof(mpn_digit)*4)
+
+/* Operands with fewer digits than the following thresholds are handled by the
+   quadratic algorithms. They can be overridden at build time. */
+#ifndef LEAN_MPN_KARATSUBA_THRESHOLD
+#define LEAN_MPN_KARATSUBA_THRESHOLD 32
+#endif
+#ifndef LEAN_MPN_DC_DIV_THRESHOLD
+#define LEAN_MPN_DC_DIV_THRESHOLD 32
+#endif
+#ifndef LEAN_MPN_DC_TO_STRING_THRESHOLD
+#define LEAN_MPN_DC_TO_STRING_THRESHOLD 24
+#endif
+
+/* r[0..lr) += a[0..la), la <= lr. Returns the carry out of r[lr-1]. */
+static mpn_digit add_to(mpn_digit * r, size_t lr, mpn_digit const * a, size_t la) {
+    lean_assert(la <= lr);
+    mpn_digit k = 0;
+    size_t j = 0;
+    for (; j < la; j++) {
+        mpn_digit s = r[j] + a[j];
+        mpn_digit c1 = s < a[j];
+        r[j] = s + k;
+        k = c1 | (r[j] < s);
+    }
+    for (; k && j < lr; j++) {
+        r[j]++;
+        k = r[j] == 0;
+    }
+    return k;
+}
+
+/* r[0..lr) -= a[0..la), la <= lr. Returns the borrow out of r[lr-1]. */
+static mpn_digit sub_from(mpn_digit * r, size_t lr, mpn_digit const * a, size_t la) {
+    lean_assert(la <= lr);
+    mpn_digit k = 0;
+    size_t j = 0;
+    for (; j < la; j++) {
+        mpn_digit d = r[j] - a[j];
+        mpn_digit b1 = d > r[j];
+        r[j] = d - k;
+        k = b1 | (r[j] > d);
+    }
+    for (; k && j < lr; j++) {
+        k = r[j] == 0;
+        r[j]--;
+    }
+    return k;
+}
+
+static void mpn_mul_basecase(mpn_digit const * a, size_t const lnga,
+                             mpn_digit const * b, size_t const lngb,
+                             mpn_digit * c) {
     // Essentially Knuth's Algorithm M.
-    // Perhaps implement a more efficient version, see e.g., Knuth, Section 4.3.3.
     size_t i;
     mpn_digit k;
 
-#define DIGIT_BITS (sizeof(mpn_digit)*8)
-#define HALF_BITS (sizeof(mpn_digit)*4)
-
     for (unsigned i = 0; i < lnga; i++)
         c[i] = 0;
 
@@ -122,31 +192,107 @@ void mpn_mul(mpn_digit const * a, size_t const lnga,
     }
 }
 
-#define MASK_FIRST (~((mpn_digit)(-1) >> 1))
-#define FIRST_BITS(N, X) ((X) >> (DIGIT_BITS-(N)))
-#define LAST_BITS(N, X) (((X) << (DIGIT_BITS-(N))) >> (DIGIT_BITS-(N)))
-#define BASE ((mpn_double_digit)0x01 << DIGIT_BITS)
-
-class  mpn_buffer : public buffer<mpn_digit> {
-public:
-    mpn_buffer() : buffer<mpn_digit>() {}
-
-    mpn_buffer(size_t nsz, const mpn_digit & elem = 0):buffer<mpn_digit>() {
-        for (size_t i = 0; i < nsz; i++) push_back(elem);
+/* Number of scratch digits needed by `mpn_mul_karatsuba` for operands of length `n`. */
+static size_t karatsuba_scratch_size(size_t n) {
+    size_t r = 0;
+    while (n >= LEAN_MPN_KARATSUBA_THRESHOLD) {
+        size_t h = n - n/2;
+        r += 6*h + 1;
+        n = h;
     }
+    return r;
+}
 
-    void resize(size_t nsz, const mpn_digit & elem = 0) {
-        buffer<mpn_digit>::resize(static_cast<unsigned>(nsz), elem);
+/*
+  c[0..2n) := a[0..n) * b[0..n) using Karatsuba's algorithm (Knuth, Section 4.3.3).
+  We use the subtractive variant
+     a*b = a1*b1*B^2h + (a0*b0 + a1*b1 - (a1-a0)*(b1-b0))*B^h + a0*b0
+  to keep all intermediate values within `n` digits.
+  `t` must provide `karatsuba_scratch_size(n)` digits.
+*/
+static void mpn_mul_karatsuba(mpn_digit const * a, mpn_digit const * b, size_t n,
+                              mpn_digit * c, mpn_digit * t) {
+    if (n < LEAN_MPN_KARATSUBA_THRESHOLD) {
+        mpn_mul_basecase(a, n, b, n, c);
+        return;
     }
-
-    mpn_digit & operator[](size_t idx) {
-        return buffer<mpn_digit>::operator[](static_cast<unsigned>(idx));
+    size_t l = n / 2;     // length of the low halves a0, b0
+    size_t h = n - l;     // length of the high halves a1, b1, h >= l
+    mpn_digit const * a0 = a;
+    mpn_digit const * a1 = a + l;
+    mpn_digit const * b0 = b;
+    mpn_digit const * b1 = b + l;
+    mpn_digit * da   = t;
+    mpn_digit * db   = t + h;
+    mpn_digit * prod = t + 2*h;
+    mpn_digit * mid  = t + 4*h;
+    mpn_digit * rest = t + 6*h + 1;
+
+    mpn_mul_karatsuba(a0, b0, l, c, rest);
+    mpn_mul_karatsuba(a1, b1, h, c + 2*l, rest);
+
+    // da := |a1 - a0|, db := |b1 - b0|
+    bool neg = false;
+    mpn_digit borrow;
+    if (mpn_compare(a1, h, a0, l) >= 0) {
+        mpn_sub(a1, h, a0, l, da, &borrow);
+    } else {
+        mpn_sub(a0, l, a1, h, da, &borrow);
+        neg = !neg;
+    }
+    if (mpn_compare(b1, h, b0, l) >= 0) {
+        mpn_sub(b1, h, b0, l, db, &borrow);
+    } else {
+        mpn_sub(b0, l, b1, h, db, &borrow);
+        neg = !neg;
     }
+    mpn_mul_karatsuba(da, db, h, prod, rest);
+
+    // mid := a0*b0 + a1*b1 -/+ |a1-a0|*|b1-b0|
+    for (size_t i = 0; i < 2*h; i++)
+        mid[i] = c[2*l + i];
+    mid[2*h] = 0;
+    add_to(mid, 2*h + 1, c, 2*l);
+    if (neg)
+        add_to(mid, 2*h + 1, prod, 2*h);
+    else
+        sub_from(mid, 2*h + 1, prod, 2*h);
+    add_to(c + l, 2*n - l, mid, 2*h + 1);
+}
 
-    const mpn_digit & operator[](size_t idx) const {
-        return buffer<mpn_digit>::operator[](static_cast<unsigned>(idx));
+void mpn_mul(mpn_digit const * a, size_t lnga,
+             mpn_digit const * b, size_t lngb,
+             mpn_digit * c) {
+    if (lnga < lngb) {
+        std::swap(a, b);
+        std::swap(lnga, lngb);
     }
-};
+    if (lngb < LEAN_MPN_KARATSUBA_THRESHOLD) {
+        mpn_mul_basecase(a, lnga, b, lngb, c);
+    } else if (lnga == lngb) {
+        mpn_buffer t(karatsuba_scratch_size(lnga));
+        mpn_mul_karatsuba(a, b, lnga, c, t.data());
+    } else {
+        // Unbalanced operands: multiply `b` by `lngb`-sized slices of `a` and accumulate.
+        mpn_buffer t(karatsuba_scratch_size(lngb)), p(2*lngb);
+        for (size_t i = 0; i < lnga + lngb; i++)
+            c[i] = 0;
+        for (size_t i = 0; i < lnga; i += lngb) {
+            size_t k = std::min(lngb, lnga - i);
+            if (k == lngb)
+                mpn_mul_karatsuba(a + i, b, lngb, p.data(), t.data());
+            else
+                mpn_mul(b, lngb, a + i, k, p.data());
+            add_to(c + i, lnga + lngb - i, p.data(), lngb + k);
+        }
+    }
+}
+
+#define MASK_FIRST (~((mpn_digit)(-1) >> 1))
+#define FIRST_BITS(N, X) ((X) >> (DIGIT_BITS-(N)))
+#define LAST_BITS(N, X) (((X) << (DIGIT_BITS-(N))) >> (DIGIT_BITS-(N)))
+#define BASE ((mpn_double_digit)0x01 << DIGIT_BITS)
+
 
 static size_t div_normalize(mpn_digit const * numer, size_t const lnum,
                             mpn_digit const * denom, size_t const lden,
@@ -220,17 +366,14 @@ static void div_1(mpn_buffer & numer, mpn_digit const denom,
     }
 }
 
-static void div_n(mpn_buffer & numer, mpn_buffer const & denom,
-                  mpn_digit * quot, mpn_digit * rem,
+static void div_n(mpn_digit * numer, size_t const m,
+                  mpn_digit const * denom, size_t const n,
+                  mpn_digit * quot,
                   mpn_buffer & ms, mpn_buffer & ab) {
-    lean_assert(denom.size() > 1);
+    lean_assert(n > 1);
 
     // This is essentially Knuth's Algorithm D.
-    size_t m = numer.size() - denom.size();
-    size_t n = denom.size();
-
-    lean_assert(numer.size() == m+n);
-
+    // `numer` has `m+n` digits, and on return its lower `n` digits contain the remainder.
     ms.resize(n+1);
 
     mpn_double_digit q_hat, temp, r_hat;
@@ -251,20 +394,67 @@ static void div_n(mpn_buffer & numer, mpn_buffer const & denom,
         // Replace numer[j+n]...numer[j] with
         // numer[j+n]...numer[j] - q * (denom[n-1]...denom[0])
         mpn_digit q_hat_small = (mpn_digit)q_hat;
-        mpn_mul(&q_hat_small, 1, denom.data(), n, ms.data());
+        mpn_mul_basecase(denom, n, &q_hat_small, 1, ms.data());
         mpn_sub(&numer[j], n+1, ms.data(), n+1, &numer[j], &borrow);
         quot[j] = q_hat_small;
         if (borrow) {
             quot[j]--;
             ab.resize(n+2);
             size_t real_size;
-            mpn_add(denom.data(), n, &numer[j], n+1, ab.data(), n+2, &real_size);
+            mpn_add(denom, n, &numer[j], n+1, ab.data(), n+2, &real_size);
             for (size_t i = 0; i < n+1; i++)
                 numer[j+i] = ab[i];
         }
     }
 }
 
+/*
+  Divide-and-conquer division step in the style of Burnikel and Ziegler,
+  "Fast Recursive Division" (1998).
+
+  Divides `a[0..n+k)` by the normalized divisor `b[0..n)`, where `k <= n` and `a[k..n+k) < b`.
+  The `k` quotient digits are stored in `q`, and the remainder replaces `a[0..n)`;
+  `a[n..n+k)` is zero on return.
+*/
+static void div_dc(mpn_digit * a, mpn_digit const * b, size_t n, size_t k, mpn_digit * q,
+                   mpn_buffer & ms, mpn_buffer & ab) {
+    if (n < LEAN_MPN_DC_DIV_THRESHOLD || k < LEAN_MPN_DC_DIV_THRESHOLD) {
+        div_n(a, k, b, n, q, ms, ab);
+        return;
+    }
+    if (k == n) {
+        // Compute the upper and lower halves of the quotient separately.
+        size_t k_lo = k / 2;
+        div_dc(a + k_lo, b, n, k - k_lo, q + k_lo, ms, ab);
+        div_dc(a, b, n, k_lo, q, ms, ab);
+        return;
+    }
+    // Split b = b1*B^s + b2 where b1 has k digits. The top 2k digits of `a` divided by `b1`
+    // yield an estimate of the quotient that is at most 2 too large.
+    size_t s = n - k;
+    mpn_digit const * b1 = b + s;
+    mpn_digit const * b2 = b;
+    if (mpn_compare(a + n, k, b1, k) < 0) {
+        div_dc(a + s, b1, k, k, q, ms, ab);
+    } else {
+        // The estimate is B^k - 1, and a[s..n+k) - (B^k - 1)*b1 = a[s..n) + b1
+        for (size_t i = 0; i < k; i++) {
+            q[i]     = static_cast<mpn_digit>(-1);
+            a[n + i] = 0;
+        }
+        add_to(a + s, n + k - s, b1, k);
+    }
+    // a := a - q*b2, fixing up a negative result by adding back the divisor.
+    mpn_buffer d(n);
+    mpn_mul(q, k, b2, s, d.data());
+    if (sub_from(a, n + k, d.data(), n)) {
+        mpn_digit one = 1;
+        do {
+            sub_from(q, k, &one, 1);
+        } while (!add_to(a, n + k, b, n));
+    }
+}
+
 void mpn_div(mpn_digit const * numer, size_t const lnum,
              mpn_digit const * denom, size_t const lden,
              mpn_digit * quot,
@@ -298,10 +488,20 @@ void mpn_div(mpn_digit const * numer, size_t const lnum,
     else  {
         mpn_buffer u, v, t_ms, t_ab;
         size_t d = div_normalize(numer, lnum, denom, lden, u, v);
-        if (lden == 1)
+        size_t m = u.size() - v.size();
+        if (lden == 1) {
             div_1(u, v[0], quot);
-        else
-            div_n(u, v, quot, rem, t_ms, t_ab);
+        } else if (lden < LEAN_MPN_DC_DIV_THRESHOLD || m < LEAN_MPN_DC_DIV_THRESHOLD) {
+            div_n(u.data(), m, v.data(), lden, quot, t_ms, t_ab);
+        } else {
+            // Process the quotient from the top in blocks of at most `lden` digits.
+            size_t j = m - (m % lden == 0 ? lden : m % lden);
+            while (true) {
+                div_dc(u.data() + j, v.data(), lden, std::min(lden, m - j), quot + j, t_ms, t_ab);
+                if (j == 0) break;
+                j -= lden;
+            }
+        }
         div_unnormalize(u, v, d, rem);
     }
 
@@ -318,6 +518,76 @@ void mpn_div(mpn_digit const * numer, size_t const lnum,
 #endif
 }
 
+/* Decimal conversion works on chunks of 9 digits, i.e., in base 10^9. */
+static const mpn_digit dec_chunk = 1000000000u;
+static const size_t dec_chunk_digits = 9;
+
+static char * write_dec_chunk(mpn_digit v, char * out, size_t width) {
+    char tmp[dec_chunk_digits];
+    size_t n = 0;
+    do {
+        tmp[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v != 0);
+    for (; width > n; width--)
+        *out++ = '0';
+    while (n > 0)
+        *out++ = tmp[--n];
+    return out;
+}
+
+/* Write `a` in decimal to `out`, left-padded with zeros to `width` characters.
+   `a` is destroyed. */
+static char * to_string_basecase(mpn_buffer & a, char * out, size_t width) {
+    buffer<mpn_digit> chunks;
+    while (!a.empty() && a.back() == 0)
+        a.pop_back();
+    while (!a.empty()) {
+        mpn_double_digit r = 0;
+        for (size_t j = a.size(); j-- > 0;) {
+            mpn_double_digit t = (r << DIGIT_BITS) | a[j];
+            a[j] = static_cast<mpn_digit>(t / dec_chunk);
+            r    = t % dec_chunk;
+        }
+        chunks.push_back(static_cast<mpn_digit>(r));
+        while (!a.empty() && a.back() == 0)
+            a.pop_back();
+    }
+    if (chunks.empty())
+        return write_dec_chunk(0, out, width == 0 ? 1 : width);
+    size_t top_width = width > dec_chunk_digits * (chunks.size() - 1) ? width - dec_chunk_digits * (chunks.size() - 1) : 0;
+    out = write_dec_chunk(chunks.back(), out, top_width);
+    for (size_t i = chunks.size() - 1; i-- > 0;)
+        out = write_dec_chunk(chunks[i], out, dec_chunk_digits);
+    return out;
+}
+
+/*
+  Divide-and-conquer radix conversion: split `a` into quotient and remainder by
+  `pows[level] = 10^(9*2^level)` and convert both halves recursively.
+  Requires `a < pows[level+1]`.
+*/
+static char * to_string_dc(mpn_digit const * a, size_t lng, std::vector<mpn_buffer> const & pows,
+                           int level, char * out, size_t width) {
+    while (lng > 0 && a[lng-1] == 0)
+        lng--;
+    while (level >= 0 && mpn_compare(a, lng, pows[level].data(), pows[level].size()) < 0)
+        level--;
+    if (level < 0 || lng < LEAN_MPN_DC_TO_STRING_THRESHOLD) {
+        mpn_buffer t(lng);
+        for (size_t i = 0; i < lng; i++)
+            t[i] = a[i];
+        return to_string_basecase(t, out, width);
+    }
+    mpn_buffer const & p = pows[level];
+    size_t lp = p.size();
+    mpn_buffer q(lng - lp + 1), r(lp);
+    mpn_div(a, lng, p.data(), lp, q.data(), r.data());
+    size_t pw = dec_chunk_digits << level;
+    out = to_string_dc(q.data(), q.size(), pows, level - 1, out, width > pw ? width - pw : 0);
+    return to_string_dc(r.data(), r.size(), pows, level - 1, out, pw);
+}
+
 char * mpn_to_string(mpn_digit const * a, size_t const lng, char * buf, size_t const lbuf) {
     lean_assert(buf && lbuf > 0);
 
@@ -329,27 +599,21 @@ char * mpn_to_string(mpn_digit const * a, size_t const lng, char * buf, size_t c
 #endif
     }
     else {
-        mpn_buffer temp(lng, 0), t_numer(lng+1, 0), t_denom(1, 0);
-        for (unsigned i = 0; i < lng; i++)
-            temp[i] = a[i];
-
-        size_t j = 0;
-        mpn_digit rem;
-        mpn_digit ten = 10;
-        while (!temp.empty() && (temp.size() > 1 || temp[0] != 0)) {
-            size_t d = div_normalize(&temp[0], temp.size(), &ten, 1, t_numer, t_denom);
-            div_1(t_numer, t_denom[0], &temp[0]);
-            div_unnormalize(t_numer, t_denom, d, &rem);
-            buf[j++] = '0' + rem;
-            while (!temp.empty() && temp.back() == 0)
-                temp.pop_back();
+        std::vector<mpn_buffer> pows;
+        pows.push_back(mpn_buffer(1, dec_chunk));
+        if (lng >= LEAN_MPN_DC_TO_STRING_THRESHOLD) {
+            while (mpn_compare(a, lng, pows.back().data(), pows.back().size()) >= 0) {
+                mpn_buffer const & p = pows.back();
+                mpn_buffer sq(2 * p.size());
+                mpn_mul(p.data(), p.size(), p.data(), p.size(), sq.data());
+                while (sq.back() == 0)
+                    sq.pop_back();
+                pows.push_back(sq);
+            }
         }
-        buf[j] = 0;
-
-        j--;
-        size_t mid = (j/2) + ((j % 2) ? 1 : 0);
-        for (size_t i = 0; i < mid; i++)
-            std::swap(buf[i], buf[j-i]);
+        char * end = to_string_dc(a, lng, pows, static_cast<int>(pows.size()) - 2, buf, 0);
+        lean_assert(end < buf + lbuf);
+        *end = 0;
     }
     return buf;
 }
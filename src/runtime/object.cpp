@@ -8,6 +8,7 @@ Author: Leonardo de Moura
 #include <algorithm>
 #include <vector>
 #include <deque>
+#include <unordered_map>
 #include <cmath>
 #include <lean/lean.h>
 #include "runtime/object.h"
@@ -20,7 +21,7 @@ Author: Leonardo de Moura
 #include "runtime/interrupt.h"
 #include "runtime/buffer.h"
 #include "runtime/io.h"
-#include "runtime/hash.h"
+#include "runtime/trace_events.h"
 
 #ifdef __GLIBC__
 #include <execinfo.h>
@@ -122,11 +123,25 @@ extern "C" LEAN_EXPORT object * lean_sorry(uint8) {
     lean_unreachable();
 }
 
+#ifdef LEAN_MT_RC_CACHE
+static bool mt_rc_cache_cancel_dec(lean_object * o);
+#endif
+
 extern "C" LEAN_EXPORT void lean_inc_ref_cold(lean_object * o) {
+#ifdef LEAN_MT_RC_CACHE
+    if (mt_rc_cache_cancel_dec(o))
+        return;
+#endif
     std::atomic_fetch_sub_explicit(lean_get_rc_mt_addr(o), 1, std::memory_order_relaxed);
 }
 
 extern "C" LEAN_EXPORT void lean_inc_ref_n_cold(lean_object * o, unsigned n) {
+#ifdef LEAN_MT_RC_CACHE
+    while (n > 0 && mt_rc_cache_cancel_dec(o))
+        n--;
+    if (n == 0)
+        return;
+#endif
     std::atomic_fetch_sub_explicit(lean_get_rc_mt_addr(o), (int)n, std::memory_order_relaxed);
 }
 
@@ -206,6 +221,126 @@ static inline lean_object * pop_back(lean_object * & todo) {
     return r;
 }
 
+static void lean_del_core(object * o, object * & todo);
+
+#ifdef LEAN_MT_RC_CACHE
+/*
+Thread-local cache of deferred reference counter decrements for multi-threaded objects.
+
+Updating the counter of a multi-threaded object requires an atomic operation, and for objects
+shared by many threads (e.g., the environment) the cache line containing the counter keeps moving
+between cores. Instead, a thread records decrements in a small direct-mapped table, and a later
+increment of the same object by the same thread cancels a pending decrement without touching the
+object. Thus, the shared counter over-approximates the number of references, and the thread that
+keeps using an object does not need atomic operations for it. Pending decrements are applied when
+an entry is evicted, when a task finishes executing, and when the thread terminates.
+
+We never defer decrements of tasks and external objects because their finalization is observable.
+*/
+#ifndef LEAN_MT_RC_CACHE_SIZE
+#define LEAN_MT_RC_CACHE_SIZE 256
+#endif
+static_assert((LEAN_MT_RC_CACHE_SIZE & (LEAN_MT_RC_CACHE_SIZE - 1)) == 0, "cache size must be a power of two");
+
+struct mt_rc_cache_entry {
+    lean_object * m_obj{nullptr};
+    unsigned      m_pending{0};
+};
+
+struct mt_rc_cache {
+    mt_rc_cache_entry m_entries[LEAN_MT_RC_CACHE_SIZE];
+};
+
+LEAN_THREAD_PTR(mt_rc_cache, g_mt_rc_cache);
+
+static inline mt_rc_cache_entry & mt_rc_cache_entry_for(mt_rc_cache * c, lean_object * o) {
+    return c->m_entries[(reinterpret_cast<size_t>(o) >> 4) & (LEAN_MT_RC_CACHE_SIZE - 1)];
+}
+
+static bool mt_rc_cache_cancel_dec(lean_object * o) {
+    mt_rc_cache * c = g_mt_rc_cache;
+    if (c == nullptr)
+        return false;
+    mt_rc_cache_entry & e = mt_rc_cache_entry_for(c, o);
+    if (e.m_obj != o)
+        return false;
+    if (--e.m_pending == 0)
+        e.m_obj = nullptr;
+    return true;
+}
+
+/* Apply `n` decrements to the multi-threaded object `o`. */
+static inline void mt_dec_ref_n(lean_object * o, unsigned n, lean_object * & todo) {
+    if (o->m_rc == 0) // object has been marked persistent in the meantime
+        return;
+    if (std::atomic_fetch_add_explicit(lean_get_rc_mt_addr(o), (int)n, std::memory_order_acq_rel) == -(int)n)
+        push_back(todo, o);
+}
+
+/* Apply all pending decrements of the current thread. */
+static void mt_rc_cache_flush() {
+    mt_rc_cache * c = g_mt_rc_cache;
+    if (c == nullptr)
+        return;
+    bool found = true;
+    while (found) {
+        // Deleting objects may add new entries, so we iterate until the cache is empty.
+        found = false;
+        for (mt_rc_cache_entry & e : c->m_entries) {
+            if (e.m_obj == nullptr)
+                continue;
+            lean_object * o = e.m_obj;
+            unsigned n      = e.m_pending;
+            e.m_obj         = nullptr;
+            e.m_pending     = 0;
+            found           = true;
+            object * todo   = nullptr;
+            mt_dec_ref_n(o, n, todo);
+            while (todo) {
+                o = pop_back(todo);
+                lean_del_core(o, todo);
+            }
+        }
+    }
+}
+
+static void finalize_mt_rc_cache(void * p) {
+    mt_rc_cache_flush();
+    delete reinterpret_cast<mt_rc_cache*>(p);
+    g_mt_rc_cache = nullptr;
+}
+
+static void mt_dec_ref(lean_object * o, lean_object * & todo) {
+    if (std::atomic_load_explicit(lean_get_rc_mt_addr(o), std::memory_order_acquire) == -1) {
+        // We own the only reference, and no other thread can acquire a new one.
+        push_back(todo, o);
+        return;
+    }
+    uint8 tag = lean_ptr_tag(o);
+    if (tag == LeanTask || tag == LeanExternal || in_thread_finalization()) {
+        mt_dec_ref_n(o, 1, todo);
+        return;
+    }
+    mt_rc_cache * c = g_mt_rc_cache;
+    if (c == nullptr) {
+        c = new mt_rc_cache();
+        g_mt_rc_cache = c;
+        register_thread_finalizer(finalize_mt_rc_cache, c);
+    }
+    mt_rc_cache_entry & e = mt_rc_cache_entry_for(c, o);
+    if (e.m_obj == o) {
+        e.m_pending++;
+        return;
+    }
+    lean_object * old_obj = e.m_obj;
+    unsigned old_pending  = e.m_pending;
+    e.m_obj     = o;
+    e.m_pending = 1;
+    if (old_obj)
+        mt_dec_ref_n(old_obj, old_pending, todo);
+}
+#endif
+
 static inline void dec(lean_object * o, lean_object* & todo) {
     if (lean_is_scalar(o))
         return;
@@ -215,17 +350,21 @@ static inline void dec(lean_object * o, lean_object* & todo) {
         push_back(todo, o);
     } else if (o->m_rc == 0) {
         return;
+#ifdef LEAN_MT_RC_CACHE
+    } else {
+        mt_dec_ref(o, todo);
+    }
+#else
     } else if (std::atomic_fetch_add_explicit(lean_get_rc_mt_addr(o), 1, std::memory_order_acq_rel) == -1) {
         push_back(todo, o);
     }
+#endif
 }
 
 #ifdef LEAN_LAZY_RC
 LEAN_THREAD_PTR(object, g_to_free);
 #endif
 
-static void lean_del_core(object * o, object * & todo);
-
 extern "C" LEAN_EXPORT lean_object * lean_alloc_object(size_t sz) {
 #ifdef LEAN_LAZY_RC
      if (g_to_free) {
@@ -300,19 +439,30 @@ static void lean_del_core(object * o, object * & todo) {
 }
 
 extern "C" LEAN_EXPORT void lean_dec_ref_cold(lean_object * o) {
-    if (o->m_rc == 1 || std::atomic_fetch_add_explicit(lean_get_rc_mt_addr(o), 1, std::memory_order_acq_rel) == -1) {
-#ifdef LEAN_LAZY_RC
-        push_back(g_to_free, o);
-#else
+#ifdef LEAN_MT_RC_CACHE
+    if (o->m_rc != 1) {
+        // `o` is multi-threaded. Remark: `mt_dec_ref` may release an evicted object instead of `o`.
         object * todo = nullptr;
-        while (true) {
-            lean_del_core(o, todo);
-            if (todo == nullptr)
-                return;
-            o = pop_back(todo);
-        }
+        mt_dec_ref(o, todo);
+        if (todo == nullptr)
+            return;
+        o = pop_back(todo);
+    }
+#else
+    if (o->m_rc != 1 && std::atomic_fetch_add_explicit(lean_get_rc_mt_addr(o), 1, std::memory_order_acq_rel) != -1)
+        return;
 #endif
+#ifdef LEAN_LAZY_RC
+    push_back(g_to_free, o);
+#else
+    object * todo = nullptr;
+    while (true) {
+        lean_del_core(o, todo);
+        if (todo == nullptr)
+            return;
+        o = pop_back(todo);
     }
+#endif
 }
 
 
@@ -394,157 +544,268 @@ extern "C" LEAN_EXPORT b_obj_res lean_thunk_get_core(b_obj_arg t) {
 }
 
 // =======================================
-// Mark Persistent
+// Mark Persistent / Mark MT
+
+/* `lean_mark_persistent` and `lean_mark_mt` traverse the part of the object graph reachable from their argument
+   that is not persistent resp. multi-threaded yet. The traversal is sequential, but whenever it has visited another
+   `LEAN_PAR_MARK_THRESHOLD` objects, it tries to split the remaining work with the workers of the task manager
+   (see `mark_par`). */
+#ifndef LEAN_PAR_MARK_THRESHOLD
+#define LEAN_PAR_MARK_THRESHOLD 65536
+#endif
 
-extern "C" void lean_mark_persistent(object * o);
+enum class mark_kind { persistent = 0, mt = 1 };
 
-static obj_res mark_persistent_fn(obj_arg o) {
-    lean_mark_persistent(o);
-    return lean_box(0);
+/* Counters exposed by `IO.getMarkStats`. A call is an "early cutoff" if its argument is already marked (or a scalar),
+   i.e., no traversal takes place. */
+struct mark_stats {
+    uint64 m_calls{0};
+    uint64 m_cutoffs{0};
+    uint64 m_objects{0};
+    uint64 m_max_objects{0};
+    uint64 m_parallel{0};
+};
+
+/* The counters are kept per thread so that marking does not contend on shared cache lines: only the owner thread
+   updates them, so relaxed loads and stores suffice. `lean_io_get_mark_stats` sums the counters of the live threads,
+   and the counters of a thread are added to `g_exited_mark_stats` when it exits. */
+struct thread_mark_stats {
+    std::atomic<uint64> m_calls{0};
+    std::atomic<uint64> m_cutoffs{0};
+    std::atomic<uint64> m_objects{0};
+    std::atomic<uint64> m_max_objects{0};
+    std::atomic<uint64> m_parallel{0};
+
+    static void bump(std::atomic<uint64> & c, uint64 n) {
+        c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    void add_to(mark_stats & r) const {
+        r.m_calls   += m_calls.load(std::memory_order_relaxed);
+        r.m_cutoffs += m_cutoffs.load(std::memory_order_relaxed);
+        r.m_objects += m_objects.load(std::memory_order_relaxed);
+        r.m_max_objects = std::max(r.m_max_objects, m_max_objects.load(std::memory_order_relaxed));
+        r.m_parallel += m_parallel.load(std::memory_order_relaxed);
+    }
+};
+
+static mutex g_mark_stats_mutex;
+static std::vector<thread_mark_stats *> * g_thread_mark_stats = nullptr;
+static mark_stats g_exited_mark_stats[2];
+LEAN_THREAD_PTR(thread_mark_stats, g_mark_stats_tlocal);
+
+static void finalize_mark_stats(void * p) {
+    thread_mark_stats * s = static_cast<thread_mark_stats *>(p);
+    {
+        unique_lock<mutex> lock(g_mark_stats_mutex);
+        for (unsigned k = 0; k < 2; k++)
+            s[k].add_to(g_exited_mark_stats[k]);
+        g_thread_mark_stats->erase(std::find(g_thread_mark_stats->begin(), g_thread_mark_stats->end(), s));
+    }
+    delete[] s;
+    g_mark_stats_tlocal = nullptr;
+}
+
+static thread_mark_stats * new_thread_mark_stats() {
+    thread_mark_stats * s = new thread_mark_stats[2];
+    unique_lock<mutex> lock(g_mark_stats_mutex);
+    g_thread_mark_stats->push_back(s);
+    return s;
+}
+
+static thread_mark_stats & get_mark_stats(mark_kind k) {
+    if (!g_mark_stats_tlocal) {
+        // the counters of the main thread are created by `initialize_object`
+        g_mark_stats_tlocal = new_thread_mark_stats();
+        register_thread_finalizer(finalize_mark_stats, g_mark_stats_tlocal);
+    }
+    return g_mark_stats_tlocal[static_cast<unsigned>(k)];
 }
 
+static mark_stats sum_mark_stats(mark_kind k) {
+    unique_lock<mutex> lock(g_mark_stats_mutex);
+    mark_stats r = g_exited_mark_stats[static_cast<unsigned>(k)];
+    for (thread_mark_stats * s : *g_thread_mark_stats)
+        s[static_cast<unsigned>(k)].add_to(r);
+    return r;
+}
+
+/* `true` if the current thread takes part in a parallel traversal. Objects must then be claimed atomically as other
+   threads may try to claim them at the same time. */
+LEAN_THREAD_VALUE(bool, g_mark_concurrent, false);
+
 #if defined(__has_feature)
 #if __has_feature(address_sanitizer)
 #include <sanitizer/lsan_interface.h>
 #endif
 #endif
 
-extern "C" LEAN_EXPORT void lean_mark_persistent(object * o) {
-    buffer<object*> todo;
-    todo.push_back(o);
-    while (!todo.empty()) {
-        object * o = todo.back();
-        todo.pop_back();
-        if (!lean_is_scalar(o) && lean_has_rc(o)) {
+/* Mark `o` if it has not been marked yet. Return `true` if the children of `o` should be visited. */
+template<mark_kind K> static inline bool mark_claim(object * o, bool concurrent) {
+    if (lean_is_scalar(o))
+        return false;
+    if (K == mark_kind::mt) {
+        if (!concurrent) {
+            if (!lean_is_st(o))
+                return false;
+            o->m_rc = -o->m_rc;
+            return true;
+        }
+        int rc = std::atomic_load_explicit(lean_get_rc_mt_addr(o), std::memory_order_relaxed);
+        while (rc > 0) {
+            if (std::atomic_compare_exchange_weak_explicit(lean_get_rc_mt_addr(o), &rc, -rc, std::memory_order_relaxed, std::memory_order_relaxed))
+                return true;
+        }
+        return false;
+    } else {
+        if (!concurrent) {
+            if (!lean_has_rc(o))
+                return false;
             o->m_rc = 0;
+        } else {
+            int rc = std::atomic_load_explicit(lean_get_rc_mt_addr(o), std::memory_order_relaxed);
+            while (true) {
+                if (rc == 0)
+                    return false;
+                if (std::atomic_compare_exchange_weak_explicit(lean_get_rc_mt_addr(o), &rc, 0, std::memory_order_relaxed, std::memory_order_relaxed))
+                    break;
+            }
+        }
 #if defined(__has_feature)
 #if __has_feature(address_sanitizer)
-            // do not report as leak
-            // NOTE: Most persistent objects are actually reachable from global
-            // variables up to the end of the process. However, this is *not*
-            // true for closures inside of persistent thunks, which are
-            // "orphaned" after being evaluated.
-            __lsan_ignore_object(o);
+        // do not report as leak
+        // NOTE: Most persistent objects are actually reachable from global
+        // variables up to the end of the process. However, this is *not*
+        // true for closures inside of persistent thunks, which are
+        // "orphaned" after being evaluated.
+        __lsan_ignore_object(o);
 #endif
 #endif
-            uint8_t tag = lean_ptr_tag(o);
-            if (tag <= LeanMaxCtorTag) {
-                object ** it  = lean_ctor_obj_cptr(o);
-                object ** end = it + lean_ctor_num_objs(o);
-                for (; it != end; ++it) todo.push_back(*it);
-            } else {
-                switch (tag) {
-                case LeanScalarArray:
-                case LeanString:
-                case LeanMPZ:
-                    break;
-                case LeanExternal: {
-                    object * fn = lean_alloc_closure((void*)mark_persistent_fn, 1, 0);
-                    lean_to_external(o)->m_class->m_foreach(lean_to_external(o)->m_data, fn);
-                    lean_dec(fn);
-                    break;
-                }
-                case LeanTask:
-                    todo.push_back(lean_task_get(o));
-                    break;
-                case LeanClosure: {
-                    object ** it  = lean_closure_arg_cptr(o);
-                    object ** end = it + lean_closure_num_fixed(o);
-                    for (; it != end; ++it) todo.push_back(*it);
-                    break;
-                }
-                case LeanArray: {
-                    object ** it  = lean_array_cptr(o);
-                    object ** end = it + lean_array_size(o);
-                    for (; it != end; ++it) todo.push_back(*it);
-                    break;
-                }
-                case LeanThunk:
-                    if (object * c = lean_to_thunk(o)->m_closure) todo.push_back(c);
-                    if (object * v = lean_to_thunk(o)->m_value) todo.push_back(v);
-                    break;
-                case LeanRef:
-                    if (object * v = lean_to_ref(o)->m_value) todo.push_back(v);
-                    break;
-                default:
-                    lean_unreachable();
-                    break;
-                }
-            }
-        }
+        return true;
     }
 }
 
-// =======================================
-// Mark MT
-
+extern "C" void lean_mark_persistent(object * o);
 extern "C" void lean_mark_mt(object * o);
 
+static obj_res mark_persistent_fn(obj_arg o) {
+    lean_mark_persistent(o);
+    return lean_box(0);
+}
+
 static obj_res mark_mt_fn(obj_arg o) {
     lean_mark_mt(o);
     lean_dec(o);
     return lean_box(0);
 }
 
-extern "C" LEAN_EXPORT void lean_mark_mt(object * o) {
-#ifndef LEAN_MULTI_THREAD
-    return;
-#endif
-    if (lean_is_scalar(o) || !lean_is_st(o)) return;
+template<mark_kind K> static void mark_push_children(object * o, buffer<object*> & todo) {
+    uint8_t tag = lean_ptr_tag(o);
+    if (tag <= LeanMaxCtorTag) {
+        object ** it  = lean_ctor_obj_cptr(o);
+        object ** end = it + lean_ctor_num_objs(o);
+        for (; it != end; ++it) todo.push_back(*it);
+    } else {
+        switch (tag) {
+        case LeanScalarArray:
+        case LeanString:
+        case LeanMPZ:
+            break;
+        case LeanExternal: {
+            object * fn = lean_alloc_closure(K == mark_kind::mt ? (void*)mark_mt_fn : (void*)mark_persistent_fn, 1, 0);
+            lean_to_external(o)->m_class->m_foreach(lean_to_external(o)->m_data, fn);
+            lean_dec(fn);
+            break;
+        }
+        case LeanTask:
+            todo.push_back(lean_task_get(o));
+            break;
+        case LeanClosure: {
+            object ** it  = lean_closure_arg_cptr(o);
+            object ** end = it + lean_closure_num_fixed(o);
+            for (; it != end; ++it) todo.push_back(*it);
+            break;
+        }
+        case LeanArray: {
+            object ** it  = lean_array_cptr(o);
+            object ** end = it + lean_array_size(o);
+            for (; it != end; ++it) todo.push_back(*it);
+            break;
+        }
+        case LeanThunk:
+            if (object * c = lean_to_thunk(o)->m_closure) todo.push_back(c);
+            if (object * v = lean_to_thunk(o)->m_value) todo.push_back(v);
+            break;
+        case LeanRef:
+            if (object * v = lean_to_ref(o)->m_value) todo.push_back(v);
+            break;
+        default:
+            lean_unreachable();
+            break;
+        }
+    }
+}
 
+/* Continue the traversal on `todo` in parallel with idle task manager workers. Return `false` if no workers are
+   available, otherwise complete the traversal and add the number of objects marked to `visited`. */
+template<mark_kind K> static bool mark_par(buffer<object*> & todo, size_t & visited);
+
+template<mark_kind K> static void mark_core(object * o) {
+    thread_mark_stats & stats = get_mark_stats(K);
+    thread_mark_stats::bump(stats.m_calls, 1);
+    bool concurrent = g_mark_concurrent;
+    if (!mark_claim<K>(o, concurrent)) {
+        thread_mark_stats::bump(stats.m_cutoffs, 1);
+        return;
+    }
+    size_t visited = 1;
     buffer<object*> todo;
-    todo.push_back(o);
+    mark_push_children<K>(o, todo);
     while (!todo.empty()) {
         object * o = todo.back();
         todo.pop_back();
-        if (!lean_is_scalar(o) && lean_is_st(o)) {
-            o->m_rc = -o->m_rc;
-            uint8_t tag = lean_ptr_tag(o);
-            if (tag <= LeanMaxCtorTag) {
-                object ** it  = lean_ctor_obj_cptr(o);
-                object ** end = it + lean_ctor_num_objs(o);
-                for (; it != end; ++it) todo.push_back(*it);
-            } else {
-                switch (tag) {
-                case LeanScalarArray:
-                case LeanString:
-                case LeanMPZ:
-                    break;
-                case LeanExternal: {
-                    object * fn = lean_alloc_closure((void*)mark_mt_fn, 1, 0);
-                    lean_to_external(o)->m_class->m_foreach(lean_to_external(o)->m_data, fn);
-                    lean_dec(fn);
-                    break;
-                }
-                case LeanTask:
-                    todo.push_back(lean_task_get(o));
-                    break;
-                case LeanClosure: {
-                    object ** it  = lean_closure_arg_cptr(o);
-                    object ** end = it + lean_closure_num_fixed(o);
-                    for (; it != end; ++it) todo.push_back(*it);
-                    break;
-                }
-                case LeanArray: {
-                    object ** it  = lean_array_cptr(o);
-                    object ** end = it + lean_array_size(o);
-                    for (; it != end; ++it) todo.push_back(*it);
-                    break;
-                }
-                case LeanThunk:
-                    if (object * c = lean_to_thunk(o)->m_closure) todo.push_back(c);
-                    if (object * v = lean_to_thunk(o)->m_value) todo.push_back(v);
-                    break;
-                case LeanRef:
-                    if (object * v = lean_to_ref(o)->m_value) todo.push_back(v);
-                    break;
-                default:
-                    lean_unreachable();
-                    break;
-                }
+        if (mark_claim<K>(o, concurrent)) {
+            visited++;
+            mark_push_children<K>(o, todo);
+            if (visited % LEAN_PAR_MARK_THRESHOLD == 0 && !concurrent && todo.size() >= 2 &&
+                mark_par<K>(todo, visited)) {
+                thread_mark_stats::bump(stats.m_parallel, 1);
+                break;
             }
         }
     }
+    thread_mark_stats::bump(stats.m_objects, visited);
+    if (visited > stats.m_max_objects.load(std::memory_order_relaxed))
+        stats.m_max_objects.store(visited, std::memory_order_relaxed);
+}
+
+extern "C" LEAN_EXPORT void lean_mark_persistent(object * o) {
+    mark_core<mark_kind::persistent>(o);
+}
+
+extern "C" LEAN_EXPORT void lean_mark_mt(object * o) {
+#ifndef LEAN_MULTI_THREAD
+    return;
+#endif
+    mark_core<mark_kind::mt>(o);
+}
+
+static obj_res mk_mark_stats(mark_stats const & s) {
+    object * r = lean_alloc_ctor(0, 5, 0);
+    lean_ctor_set(r, 0, lean_uint64_to_nat(s.m_calls));
+    lean_ctor_set(r, 1, lean_uint64_to_nat(s.m_cutoffs));
+    lean_ctor_set(r, 2, lean_uint64_to_nat(s.m_objects));
+    lean_ctor_set(r, 3, lean_uint64_to_nat(s.m_max_objects));
+    lean_ctor_set(r, 4, lean_uint64_to_nat(s.m_parallel));
+    return r;
+}
+
+/* getMarkStats : BaseIO (MarkStats × MarkStats) */
+extern "C" LEAN_EXPORT obj_res lean_io_get_mark_stats(obj_arg /* w */) {
+    object * r = lean_alloc_ctor(0, 2, 0);
+    lean_ctor_set(r, 0, mk_mark_stats(sum_mark_stats(mark_kind::mt)));
+    lean_ctor_set(r, 1, mk_mark_stats(sum_mark_stats(mark_kind::persistent)));
+    return io_result_mk_ok(r);
 }
 
 // =======================================
@@ -568,7 +829,30 @@ static void free_task_imp(lean_task_imp * imp) {
     lean_free_small_object((lean_object*)imp);
 }
 
+/* Ids of the trace-event flows from the creation to the execution of tasks, see `runtime/trace_events.h`. Only used
+   when trace events are enabled. */
+static mutex * g_task_trace_ids_mutex = nullptr;
+static std::unordered_map<lean_task_object *, uint64_t> * g_task_trace_ids = nullptr;
+
+static void set_task_trace_id(lean_task_object * t, uint64_t id) {
+    unique_lock<mutex> lock(*g_task_trace_ids_mutex);
+    (*g_task_trace_ids)[t] = id;
+}
+
+/* Remove the flow id of `t` and return it, or `0` if there is none. */
+static uint64_t take_task_trace_id(lean_task_object * t) {
+    unique_lock<mutex> lock(*g_task_trace_ids_mutex);
+    auto it = g_task_trace_ids->find(t);
+    if (it == g_task_trace_ids->end())
+        return 0;
+    uint64_t id = it->second;
+    g_task_trace_ids->erase(it);
+    return id;
+}
+
 static void free_task(lean_task_object * t) {
+    if (trace_events_enabled())
+        take_task_trace_id(t);
     if (t->m_imp) free_task_imp(t->m_imp);
     lean_free_small_object((lean_object*)t);
 }
@@ -692,12 +976,26 @@ class task_manager {
             scoped_current_task_object scope_cur_task(t);
             object * c = t->m_imp->m_closure;
             t->m_imp->m_closure = nullptr;
+            unsigned prio = t->m_imp->m_prio;
             lock.unlock();
+            bool trace = trace_events_enabled();
+            if (trace) {
+                trace_event_begin("task", "task", "\"prio\":" + std::to_string(prio));
+                if (uint64_t id = take_task_trace_id(t))
+                    trace_event_flow_finish("task", "task", id);
+            }
             v = lean_apply_1(c, box(0));
+            if (trace)
+                trace_event_end("task", "task");
             // If deactivation was delayed by `m_keep_alive`, deactivate after the final execution (`v != nulltpr`)
             if (v != nullptr && t->m_imp->m_keep_alive) {
                 lean_dec_ref((lean_object*)t);
             }
+            // Mark the result before taking the lock so that `resolve_core` does not traverse it while holding it
+            if (v != nullptr) mark_mt(v);
+#ifdef LEAN_MT_RC_CACHE
+            mt_rc_cache_flush();
+#endif
             lock.lock();
         }
         lean_assert(t->m_imp);
@@ -723,6 +1021,7 @@ class task_manager {
 
     void resolve_core(lean_task_object * t, object * v) {
         handle_finished(t);
+        // Usually a no-op as callers mark `v` before taking the lock
         mark_mt(v);
         t->m_value = v;
         /* After the task has been finished and we propagated
@@ -765,6 +1064,8 @@ public:
         m_max_std_workers(max_std_workers) {
     }
 
+    unsigned max_std_workers() const { return m_max_std_workers; }
+
     ~task_manager() {
         {
             unique_lock<mutex> lock(m_mutex);
@@ -786,6 +1087,7 @@ public:
     }
 
     void resolve(lean_task_object * t, object * v) {
+        mark_mt(v);
         unique_lock<mutex> lock(m_mutex);
         if (t->m_value) {
             lock.unlock(); // `dec(v)` could lead to `deactivate_task` trying to take the lock
@@ -817,7 +1119,12 @@ public:
         unique_lock<mutex> lock(m_mutex);
         if (t->m_value)
             return;
+        bool trace = trace_events_enabled();
+        if (trace)
+            trace_event_begin("task", "wait");
         m_task_finished_cv.wait(lock, [&]() { return t->m_value != nullptr; });
+        if (trace)
+            trace_event_end("task", "wait");
     }
 
     object * wait_any(object * task_list) {
@@ -928,6 +1235,11 @@ static lean_task_object * alloc_task(obj_arg c, unsigned prio, bool keep_alive)
     o->m_imp   = alloc_task_imp(c, prio, keep_alive);
     if (keep_alive)
         lean_inc_ref((lean_object*)o);
+    if (trace_events_enabled()) {
+        uint64_t id = trace_event_new_flow_id();
+        set_task_trace_id(o, id);
+        trace_event_flow_start("task", "task", id);
+    }
     return o;
 }
 
@@ -950,6 +1262,124 @@ extern "C" LEAN_EXPORT obj_res lean_task_spawn_core(obj_arg c, unsigned prio, bo
     }
 }
 
+struct mark_par_state {
+    mutex                             m_mutex;
+    condition_variable                m_cv;
+    /* Chunks of pending objects not owned by any thread. */
+    std::vector<std::vector<object*>> m_pool;
+    /* Number of threads currently owning pending objects. */
+    unsigned                          m_active{0};
+    /* Number of threads waiting for work minus `m_pool.size()`. Read without holding `m_mutex` by threads
+       deciding whether to share some of their pending objects. */
+    std::atomic<int>                  m_hungry{0};
+    bool                              m_done{false};
+    size_t                            m_visited{0};
+};
+
+static external_object_class * g_mark_par_state_class = nullptr;
+
+static void mark_par_state_finalizer(void * s) {
+    delete static_cast<mark_par_state *>(s);
+}
+
+static void mark_par_state_foreach(void *, b_obj_arg) {}
+
+/* Process `todo` and then chunks from the pool until the pool is empty and no other thread can add to it anymore.
+   The current thread must have been counted in `m_active`. */
+template<mark_kind K> static void mark_par_loop(mark_par_state & s, buffer<object*> & todo) {
+    flet<bool> concurrent(g_mark_concurrent, true);
+    size_t visited = 0;
+    unique_lock<mutex> lock(s.m_mutex, std::defer_lock);
+    while (true) {
+        while (!todo.empty()) {
+            object * o = todo.back();
+            todo.pop_back();
+            if (mark_claim<K>(o, true)) {
+                visited++;
+                mark_push_children<K>(o, todo);
+            }
+            if (todo.size() >= 2 && s.m_hungry.load(std::memory_order_relaxed) > 0) {
+                // Share the older half of our pending objects, which tend to be the roots of larger subgraphs
+                size_t n = todo.size() / 2;
+                std::vector<object*> chunk(todo.begin(), todo.begin() + n);
+                std::copy(todo.begin() + n, todo.end(), todo.begin());
+                todo.shrink(todo.size() - n);
+                lock.lock();
+                s.m_pool.push_back(std::move(chunk));
+                s.m_hungry--;
+                lock.unlock();
+                s.m_cv.notify_one();
+            }
+        }
+        lock.lock();
+        s.m_visited += visited;
+        visited = 0;
+        s.m_active--;
+        if (s.m_pool.empty() && s.m_active > 0) {
+            s.m_hungry++;
+            while (s.m_pool.empty() && s.m_active > 0)
+                s.m_cv.wait(lock);
+            s.m_hungry--;
+        }
+        if (s.m_pool.empty()) {
+            s.m_done = true;
+            lock.unlock();
+            s.m_cv.notify_all();
+            return;
+        }
+        std::vector<object*> & chunk = s.m_pool.back();
+        todo.append(chunk.size(), chunk.data());
+        s.m_pool.pop_back();
+        s.m_hungry++;
+        s.m_active++;
+        lock.unlock();
+    }
+}
+
+template<mark_kind K> static obj_res mark_par_helper(obj_arg s_obj, obj_arg) {
+    mark_par_state & s = *static_cast<mark_par_state *>(lean_get_external_data(s_obj));
+    bool done;
+    {
+        unique_lock<mutex> lock(s.m_mutex);
+        done = s.m_done;
+        if (!done)
+            s.m_active++;
+    }
+    if (!done) {
+        buffer<object*> todo;
+        mark_par_loop<K>(s, todo);
+    }
+    lean_dec(s_obj);
+    return box(0);
+}
+
+template<mark_kind K> static bool mark_par(buffer<object*> & todo, size_t & visited) {
+    if (!g_task_manager)
+        return false;
+    unsigned num_helpers = g_task_manager->max_std_workers();
+    if (g_current_task_object && num_helpers > 0)
+        num_helpers--; // we are occupying one of the workers
+    if (num_helpers == 0)
+        return false;
+    mark_par_state * s = new mark_par_state();
+    s->m_active = 1;
+    object * s_obj = lean_alloc_external(g_mark_par_state_class, s);
+    buffer<object*> helpers;
+    for (unsigned i = 0; i < num_helpers; i++) {
+        object * c = lean_alloc_closure((void*)mark_par_helper<K>, 2, 1);
+        lean_inc(s_obj);
+        lean_closure_set(c, 0, s_obj);
+        helpers.push_back(lean_task_spawn_core(c, 0, false));
+    }
+    mark_par_loop<K>(*s, todo);
+    visited += s->m_visited;
+    // Helpers that have not started yet are simply discarded
+    for (object * t : helpers)
+        lean_dec(t);
+    lean_dec(s_obj);
+    return true;
+}
+
 extern "C" LEAN_EXPORT obj_res lean_task_pure(obj_arg a) {
     return (lean_object*)alloc_task(a);
 }
@@ -2058,12 +2488,18 @@ extern "C" LEAN_EXPORT uint64 lean_string_hash(b_obj_arg s) {
     return hash_str(sz, (unsigned char const *) str, 11);
 }
 
+extern "C" LEAN_EXPORT uint64 lean_string_hash_with_seed(b_obj_arg s, uint64 seed) {
+    usize sz = lean_string_size(s) - 1;
+    char const * str = lean_string_cstr(s);
+    return hash_bytes(sz, (unsigned char const *) str, seed);
+}
+
 extern "C" LEAN_EXPORT obj_res lean_string_of_usize(size_t n) {
     return mk_ascii_string_unchecked(std::to_string(n));
 }
 
 // =======================================
-// ByteArray & FloatArray
+// ByteArray, FloatArray & UInt{16,32,64}Array
 
 size_t lean_nat_to_size_t(obj_arg n) {
     if (lean_is_scalar(n)) {
@@ -2147,7 +2583,10 @@ extern "C" LEAN_EXPORT obj_res lean_byte_array_push(obj_arg a, uint8 b) {
     return r;
 }
 
-    extern "C" LEAN_EXPORT obj_res lean_byte_array_copy_slice(b_obj_arg src, obj_arg o_src_off, obj_arg dest, obj_arg o_dest_off, obj_arg o_len, bool exact) {
+/* Copy the slice of `len` elements at `src_off` in `src` to `dest_off` in `dest` (see `ByteArray.copySlice`).
+   `src` and `dest` must have the same element size. */
+extern "C" LEAN_EXPORT obj_res lean_sarray_copy_slice(b_obj_arg src, obj_arg o_src_off, obj_arg dest, obj_arg o_dest_off, obj_arg o_len, bool exact) {
+    size_t esz = lean_sarray_elem_size(src);
     size_t ssz = lean_sarray_size(src);
     size_t dsz = lean_sarray_size(dest);
     size_t src_off = lean_nat_to_size_t(o_src_off);
@@ -2163,14 +2602,22 @@ extern "C" LEAN_EXPORT obj_res lean_byte_array_push(obj_arg a, uint8 b) {
     object * r = lean_sarray_ensure_exclusive(lean_sarray_ensure_capacity(dest, new_dsz, exact));
     lean_to_sarray(r)->m_size = new_dsz;
     // `r` is exclusive, so the ranges definitely cannot overlap
-    memcpy(lean_sarray_cptr(r) + dest_off, lean_sarray_cptr(src) + src_off, len);
+    memcpy(lean_sarray_cptr(r) + dest_off * esz, lean_sarray_cptr(src) + src_off * esz, len * esz);
     return r;
 }
 
+extern "C" LEAN_EXPORT obj_res lean_byte_array_copy_slice(b_obj_arg src, obj_arg o_src_off, obj_arg dest, obj_arg o_dest_off, obj_arg o_len, bool exact) {
+    return lean_sarray_copy_slice(src, o_src_off, dest, o_dest_off, o_len, exact);
+}
+
 extern "C" LEAN_EXPORT uint64_t lean_byte_array_hash(b_obj_arg a) {
     return hash_str(lean_sarray_size(a), lean_sarray_cptr(a), 11);
 }
 
+extern "C" LEAN_EXPORT uint64_t lean_byte_array_hash_with_seed(b_obj_arg a, uint64_t seed) {
+    return hash_bytes(lean_sarray_size(a), lean_sarray_cptr(a), seed);
+}
+
 extern "C" LEAN_EXPORT obj_res lean_copy_float_array(obj_arg a) {
     return lean_copy_sarray(a, lean_sarray_capacity(a));
 }
@@ -2210,6 +2657,112 @@ extern "C" LEAN_EXPORT obj_res lean_float_array_push(obj_arg a, double d) {
     return r;
 }
 
+template<typename T, typename Unbox>
+static obj_res scalar_array_mk(obj_arg a, Unbox unbox) {
+    usize sz      = lean_array_size(a);
+    obj_res r     = lean_alloc_sarray(sizeof(T), sz, sz);
+    object ** it  = lean_array_cptr(a);
+    object ** end = it + sz;
+    T * dest      = reinterpret_cast<T*>(lean_sarray_cptr(r));
+    for (; it != end; ++it, ++dest) {
+        *dest = unbox(*it);
+    }
+    lean_dec(a);
+    return r;
+}
+
+template<typename T, typename Box>
+static obj_res scalar_array_data(obj_arg a, Box box) {
+    usize sz       = lean_sarray_size(a);
+    obj_res r      = lean_alloc_array(sz, sz);
+    T * it         = reinterpret_cast<T*>(lean_sarray_cptr(a));
+    T * end        = it+sz;
+    object ** dest = lean_array_cptr(r);
+    for (; it != end; ++it, ++dest) {
+        *dest = box(*it);
+    }
+    lean_dec(a);
+    return r;
+}
+
+template<typename T>
+static obj_res scalar_array_push(obj_arg a, T v) {
+    object * r = lean_sarray_ensure_exclusive(lean_sarray_ensure_capacity(a, lean_sarray_size(a) + 1, /* exact */ false));
+    size_t & sz  = lean_to_sarray(r)->m_size;
+    T * it       = reinterpret_cast<T*>(lean_sarray_cptr(r)) + sz;
+    *it = v;
+    sz++;
+    return r;
+}
+
+template<typename T>
+static obj_res scalar_array_fill(obj_arg a, T v) {
+    object * r = lean_sarray_ensure_exclusive(a);
+    T * it     = reinterpret_cast<T*>(lean_sarray_cptr(r));
+    std::fill(it, it + lean_sarray_size(r), v);
+    return r;
+}
+
+extern "C" LEAN_EXPORT obj_res lean_copy_uint16_array(obj_arg a) {
+    return lean_copy_sarray(a, lean_sarray_capacity(a));
+}
+
+extern "C" LEAN_EXPORT obj_res lean_uint16_array_mk(obj_arg a) {
+    return scalar_array_mk<uint16>(a, [](b_obj_arg v) { return static_cast<uint16>(lean_unbox(v)); });
+}
+
+extern "C" LEAN_EXPORT obj_res lean_uint16_array_data(obj_arg a) {
+    return scalar_array_data<uint16>(a, [](uint16 v) { return lean_box(v); });
+}
+
+extern "C" LEAN_EXPORT obj_res lean_uint16_array_push(obj_arg a, uint16 v) {
+    return scalar_array_push(a, v);
+}
+
+extern "C" LEAN_EXPORT obj_res lean_uint16_array_fill(obj_arg a, uint16 v) {
+    return scalar_array_fill(a, v);
+}
+
+extern "C" LEAN_EXPORT obj_res lean_copy_uint32_array(obj_arg a) {
+    return lean_copy_sarray(a, lean_sarray_capacity(a));
+}
+
+extern "C" LEAN_EXPORT obj_res lean_uint32_array_mk(obj_arg a) {
+    return scalar_array_mk<uint32>(a, [](b_obj_arg v) { return static_cast<uint32>(lean_unbox_uint32(v)); });
+}
+
+extern "C" LEAN_EXPORT obj_res lean_uint32_array_data(obj_arg a) {
+    return scalar_array_data<uint32>(a, [](uint32 v) { return lean_box_uint32(v); });
+}
+
+extern "C" LEAN_EXPORT obj_res lean_uint32_array_push(obj_arg a, uint32 v) {
+    return scalar_array_push(a, v);
+}
+
+extern "C" LEAN_EXPORT obj_res lean_uint32_array_fill(obj_arg a, uint32 v) {
+    return scalar_array_fill(a, v);
+}
+
+extern "C" LEAN_EXPORT obj_res lean_copy_uint64_array(obj_arg a) {
+    return lean_copy_sarray(a, lean_sarray_capacity(a));
+}
+
+extern "C" LEAN_EXPORT obj_res lean_uint64_array_mk(obj_arg a) {
+    return scalar_array_mk<uint64>(a, [](b_obj_arg v) { return lean_unbox_uint64(v); });
+}
+
+extern "C" LEAN_EXPORT obj_res lean_uint64_array_data(obj_arg a) {
+    return scalar_array_data<uint64>(a, [](uint64 v) { return lean_box_uint64(v); });
+}
+
+extern "C" LEAN_EXPORT obj_res lean_uint64_array_push(obj_arg a, uint64 v) {
+    return scalar_array_push(a, v);
+}
+
+extern "C" LEAN_EXPORT obj_res lean_uint64_array_fill(obj_arg a, uint64 v) {
+    return scalar_array_fill(a, v);
+}
+
 // =======================================
 // Array functions for generated code
 
@@ -2374,13 +2927,20 @@ extern "C" LEAN_EXPORT lean_external_class * lean_register_external_class(lean_e
 void initialize_object() {
     g_ext_classes       = new std::vector<external_object_class*>();
     g_ext_classes_mutex = new mutex();
+    g_task_trace_ids_mutex = new mutex();
+    g_task_trace_ids    = new std::unordered_map<lean_task_object *, uint64_t>();
+    g_thread_mark_stats = new std::vector<thread_mark_stats *>();
+    g_mark_stats_tlocal = new_thread_mark_stats();
     g_array_empty       = lean_alloc_array(0, 0);
     mark_persistent(g_array_empty);
+    g_mark_par_state_class = lean_register_external_class(mark_par_state_finalizer, mark_par_state_foreach);
 }
 
 void finalize_object() {
     for (external_object_class * cls : *g_ext_classes) delete cls;
     delete g_ext_classes;
     delete g_ext_classes_mutex;
+    delete g_task_trace_ids;
+    delete g_task_trace_ids_mutex;
 }
 }
@@ -14,6 +14,7 @@ Author: Jared Roesch
 #if defined(LEAN_WINDOWS)
 #include <unordered_map>
 #include <windows.h>
+#include <psapi.h>
 #include <fcntl.h>
 #include <io.h>
 #include <tchar.h>
@@ -23,6 +24,7 @@ Author: Jared Roesch
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
 #include <signal.h>
 #include <limits.h> // NOLINT
 #endif
@@ -37,6 +39,23 @@ Author: Jared Roesch
 
 namespace lean {
 
+/* Make an `IO.Process.ResourceUsage` object (a structure with three `UInt64` fields). */
+static obj_res mk_resource_usage(uint64 user_time_us, uint64 system_time_us, uint64 max_rss) {
+    object * r = lean_alloc_ctor(0, 0, 3 * sizeof(uint64));
+    lean_ctor_set_uint64(r, 0, user_time_us);
+    lean_ctor_set_uint64(r, sizeof(uint64), system_time_us);
+    lean_ctor_set_uint64(r, 2 * sizeof(uint64), max_rss);
+    return r;
+}
+
+/* Make the `UInt32 × IO.Process.ResourceUsage` result of `Child.waitWithUsage`. */
+static obj_res mk_wait_with_usage_result(unsigned exit_code, obj_arg usage) {
+    object * r = lean_alloc_ctor(0, 2, 0);
+    lean_ctor_set(r, 0, box_uint32(exit_code));
+    lean_ctor_set(r, 1, usage);
+    return r;
+}
+
 enum stdio {
     PIPED,
     INHERIT,
@@ -92,6 +111,33 @@ extern "C" LEAN_EXPORT obj_res lean_io_process_child_wait(b_obj_arg, b_obj_arg c
     return lean_io_result_mk_ok(box_uint32(exit_code));
 }
 
+static uint64 filetime_to_us(FILETIME const & t) {
+    // `FILETIME` counts 100-nanosecond intervals
+    return ((static_cast<uint64>(t.dwHighDateTime) << 32) | t.dwLowDateTime) / 10;
+}
+
+extern "C" LEAN_EXPORT obj_res lean_io_process_child_wait_with_usage(b_obj_arg, b_obj_arg child, obj_arg) {
+    HANDLE h = static_cast<HANDLE>(lean_get_external_data(cnstr_get(child, 3)));
+    DWORD exit_code;
+    if (WaitForSingleObject(h, INFINITE) == WAIT_FAILED) {
+        return io_result_mk_error((sstream() << GetLastError()).str());
+    }
+    if (!GetExitCodeProcess(h, &exit_code)) {
+        return io_result_mk_error((sstream() << GetLastError()).str());
+    }
+    FILETIME creation_time, exit_time, kernel_time, user_time;
+    if (!GetProcessTimes(h, &creation_time, &exit_time, &kernel_time, &user_time)) {
+        return io_result_mk_error((sstream() << GetLastError()).str());
+    }
+    PROCESS_MEMORY_COUNTERS mem;
+    if (!GetProcessMemoryInfo(h, &mem, sizeof(mem))) {
+        return io_result_mk_error((sstream() << GetLastError()).str());
+    }
+    uint64 max_rss = static_cast<uint64>(mem.PeakWorkingSetSize); // bytes
+    obj_res usage = mk_resource_usage(filetime_to_us(user_time), filetime_to_us(kernel_time), max_rss);
+    return lean_io_result_mk_ok(mk_wait_with_usage_result(exit_code, usage));
+}
+
 extern "C" LEAN_EXPORT obj_res lean_io_process_child_try_wait(b_obj_arg, b_obj_arg child, obj_arg) {
     HANDLE h = static_cast<HANDLE>(lean_get_external_data(cnstr_get(child, 3)));
     DWORD exit_code;
@@ -332,6 +378,34 @@ extern "C" LEAN_EXPORT obj_res lean_io_process_child_wait(b_obj_arg, b_obj_arg c
     }
 }
 
+extern "C" LEAN_EXPORT obj_res lean_io_process_child_wait_with_usage(b_obj_arg, b_obj_arg child, obj_arg) {
+    static_assert(sizeof(pid_t) == sizeof(uint32), "pid_t is expected to be a 32-bit type"); // NOLINT
+    pid_t pid = cnstr_get_uint32(child, 3 * sizeof(object *));
+    int status;
+    struct rusage ru;
+    if (wait4(pid, &status, 0, &ru) == -1) {
+        return io_result_mk_error(decode_io_error(errno, nullptr));
+    }
+    unsigned exit_code;
+    if (WIFEXITED(status)) {
+        exit_code = static_cast<unsigned>(WEXITSTATUS(status));
+    } else {
+        lean_assert(WIFSIGNALED(status));
+        // use bash's convention
+        exit_code = 128 + static_cast<unsigned>(WTERMSIG(status));
+    }
+    auto to_us = [](struct timeval const & t) {
+        return static_cast<uint64>(t.tv_sec) * 1000000 + static_cast<uint64>(t.tv_usec);
+    };
+#if defined(__APPLE__)
+    uint64 max_rss = static_cast<uint64>(ru.ru_maxrss); // bytes
+#else
+    uint64 max_rss = static_cast<uint64>(ru.ru_maxrss) * 1024; // kilobytes
+#endif
+    obj_res usage = mk_resource_usage(to_us(ru.ru_utime), to_us(ru.ru_stime), max_rss);
+    return lean_io_result_mk_ok(mk_wait_with_usage_result(exit_code, usage));
+}
+
 extern "C" LEAN_EXPORT obj_res lean_io_process_child_try_wait(b_obj_arg, b_obj_arg child, obj_arg) {
     static_assert(sizeof(pid_t) == sizeof(uint32), "pid_t is expected to be a 32-bit type"); // NOLINT
     pid_t pid = cnstr_get_uint32(child, 3 * sizeof(object *));
@@ -0,0 +1,198 @@
+/*
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include "runtime/trace_events.h"
+#include "runtime/thread.h"
+
+#define LEAN_TRACE_CHUNK_SIZE 1024
+
+namespace lean {
+bool g_trace_events_enabled = false;
+static std::string * g_trace_events_file = nullptr;
+static std::chrono::steady_clock::time_point g_trace_events_start;
+
+struct trace_event {
+    uint64_t     m_ts; // nanoseconds since `g_trace_events_start`
+    char         m_phase;
+    char const * m_category;
+    std::string  m_name;
+    std::string  m_args;
+    uint64_t     m_id;
+};
+
+/* Events are appended to a list of chunks by the owning thread only. The number of valid events of a chunk is
+   published using release stores so that `flush_trace_events` can read them while the thread keeps recording. */
+struct trace_chunk {
+    trace_event                m_events[LEAN_TRACE_CHUNK_SIZE];
+    std::atomic<unsigned>      m_size{0};
+    std::atomic<trace_chunk *> m_next{nullptr};
+};
+
+struct trace_buffer {
+    unsigned       m_tid;
+    trace_chunk *  m_first;
+    trace_chunk *  m_last;
+    trace_buffer * m_next;
+};
+
+/* Buffers of all threads that recorded events. Buffers are never freed so that they outlive their threads. */
+static std::atomic<trace_buffer *> g_trace_buffers(nullptr);
+static std::atomic<unsigned> g_next_tid(0);
+static std::atomic<uint64_t> g_next_flow_id(1);
+LEAN_THREAD_PTR(trace_buffer, g_trace_buffer);
+
+static trace_buffer * get_trace_buffer() {
+    if (LEAN_UNLIKELY(g_trace_buffer == nullptr)) {
+        trace_buffer * b = new trace_buffer();
+        b->m_tid   = g_next_tid++;
+        b->m_first = b->m_last = new trace_chunk();
+        b->m_next  = g_trace_buffers.load();
+        while (!g_trace_buffers.compare_exchange_weak(b->m_next, b)) {}
+        g_trace_buffer = b;
+    }
+    return g_trace_buffer;
+}
+
+uint64_t trace_event_timestamp() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - g_trace_events_start).count();
+}
+
+static void record(char phase, char const * category, std::string const & name, std::string const & args, uint64_t id,
+                   uint64_t ts = trace_event_timestamp()) {
+    trace_buffer * b = get_trace_buffer();
+    trace_chunk * c  = b->m_last;
+    unsigned sz      = c->m_size.load(std::memory_order_relaxed);
+    if (sz == LEAN_TRACE_CHUNK_SIZE) {
+        trace_chunk * n = new trace_chunk();
+        c->m_next.store(n, std::memory_order_release);
+        b->m_last = c = n;
+        sz = 0;
+    }
+    trace_event & e = c->m_events[sz];
+    e.m_ts       = ts;
+    e.m_phase    = phase;
+    e.m_category = category;
+    e.m_name     = name;
+    e.m_args     = args;
+    e.m_id       = id;
+    c->m_size.store(sz + 1, std::memory_order_release);
+}
+
+void trace_event_begin(char const * category, std::string const & name, std::string const & args) {
+    record('B', category, name, args, 0);
+}
+
+void trace_event_end(char const * category, std::string const & name, std::string const & args, uint64_t ts) {
+    record('E', category, name, args, 0, ts);
+}
+
+uint64_t trace_event_new_flow_id() {
+    return g_next_flow_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+void trace_event_flow_start(char const * category, char const * name, uint64_t id) {
+    record('s', category, name, std::string(), id);
+}
+
+void trace_event_flow_finish(char const * category, char const * name, uint64_t id) {
+    record('f', category, name, std::string(), id);
+}
+
+std::string json_escape(std::string const & s) {
+    std::string r = "\"";
+    for (char c : s) {
+        switch (c) {
+        case '"':  r += "\\\""; break;
+        case '\\': r += "\\\\"; break;
+        case '\n': r += "\\n"; break;
+        case '\t': r += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(c));
+                r += buf;
+            } else {
+                r += c;
+            }
+        }
+    }
+    r += "\"";
+    return r;
+}
+
+static void write_event(std::ostream & out, unsigned tid, trace_event const & e) {
+    char ts[32];
+    snprintf(ts, sizeof(ts), "%llu.%03llu", static_cast<unsigned long long>(e.m_ts / 1000),
+             static_cast<unsigned long long>(e.m_ts % 1000));
+    out << "{\"ph\":\"" << e.m_phase << "\",\"pid\":1,\"tid\":" << tid << ",\"ts\":" << ts
+        << ",\"cat\":" << json_escape(e.m_category) << ",\"name\":" << json_escape(e.m_name);
+    if (e.m_phase == 's' || e.m_phase == 'f')
+        out << ",\"id\":" << e.m_id;
+    if (e.m_phase == 'f')
+        out << ",\"bp\":\"e\"";
+    if (!e.m_args.empty())
+        out << ",\"args\":{" << e.m_args << "}";
+    out << "}";
+}
+
+void flush_trace_events() {
+    if (!g_trace_events_enabled || !g_trace_events_file)
+        return;
+    std::ofstream out(*g_trace_events_file);
+    if (!out) {
+        std::cerr << "failed to write trace events to '" << *g_trace_events_file << "'\n";
+        return;
+    }
+    out << "{\"traceEvents\":[\n";
+    // `g_trace_buffers` lists the most recent thread first; write the threads in order of their ids instead
+    std::vector<trace_buffer *> buffers;
+    for (trace_buffer * b = g_trace_buffers.load(); b; b = b->m_next)
+        buffers.push_back(b);
+    std::reverse(buffers.begin(), buffers.end());
+    bool first = true;
+    for (trace_buffer * b : buffers) {
+        if (!first) out << ",\n";
+        first = false;
+        out << "{\"ph\":\"M\",\"pid\":1,\"tid\":" << b->m_tid << ",\"name\":\"thread_name\",\"args\":{\"name\":\""
+            << (b->m_tid == 0 ? "main" : "thread ") << (b->m_tid == 0 ? "" : std::to_string(b->m_tid)) << "\"}}";
+        for (trace_chunk * c = b->m_first; c; c = c->m_next.load(std::memory_order_acquire)) {
+            unsigned sz = c->m_size.load(std::memory_order_acquire);
+            for (unsigned i = 0; i < sz; i++) {
+                out << ",\n";
+                write_event(out, b->m_tid, c->m_events[i]);
+            }
+        }
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+void start_trace_events(std::string const & file_name) {
+    if (g_trace_events_enabled)
+        return;
+    g_trace_events_file    = new std::string(file_name);
+    g_trace_events_start   = std::chrono::steady_clock::now();
+    g_trace_events_enabled = true;
+    // make sure the main thread gets id 0
+    get_trace_buffer();
+    std::atexit(flush_trace_events);
+}
+
+void initialize_trace_events() {
+    if (char const * file_name = std::getenv("LEAN_TRACE_EVENTS")) {
+        if (*file_name)
+            start_trace_events(file_name);
+    }
+}
+
+void finalize_trace_events() {
+}
+}
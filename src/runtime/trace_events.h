@@ -0,0 +1,47 @@
+/*
+Copyright (c) 2024 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#pragma once
+#include <string>
+#include <lean/lean.h>
+
+namespace lean {
+/* Profiler output in the Chrome trace-event format, which can be loaded into `chrome://tracing` or
+   https://ui.perfetto.dev. Events are recorded into per-thread buffers without synchronization between
+   recording threads and written to the output file at process exit.
+
+   Recording is enabled by `start_trace_events`, i.e., by `lean --trace-events=file`, or by setting the
+   environment variable `LEAN_TRACE_EVENTS` to the output file name. */
+extern LEAN_EXPORT bool g_trace_events_enabled;
+
+inline bool trace_events_enabled() { return g_trace_events_enabled; }
+
+/* Start recording events that will be written to `file_name` at process exit. */
+LEAN_EXPORT void start_trace_events(std::string const & file_name);
+
+/* Current timestamp of the trace in nanoseconds. */
+LEAN_EXPORT uint64_t trace_event_timestamp();
+
+/* Begin/end a duration event named `name` on the current thread. Duration events of a thread must be properly
+   nested. `args` is an optional list of JSON object members such as `"decl":"Nat.add"`, see `json_escape`. An end
+   event can be recorded after the fact by passing an earlier `trace_event_timestamp()` as `ts`. */
+LEAN_EXPORT void trace_event_begin(char const * category, std::string const & name, std::string const & args = std::string());
+LEAN_EXPORT void trace_event_end(char const * category, std::string const & name, std::string const & args = std::string(),
+                                 uint64_t ts = trace_event_timestamp());
+/* Return a fresh, nonzero id for `trace_event_flow_start`. */
+LEAN_EXPORT uint64_t trace_event_new_flow_id();
+/* Start/finish an arrow between events on different threads. `id` must be shared by the start and the finish. The
+   finish event is bound to the enclosing duration event. */
+LEAN_EXPORT void trace_event_flow_start(char const * category, char const * name, uint64_t id);
+LEAN_EXPORT void trace_event_flow_finish(char const * category, char const * name, uint64_t id);
+
+/* Return `s` as a JSON string literal. */
+LEAN_EXPORT std::string json_escape(std::string const & s);
+
+/* Write all events recorded so far. Called automatically at process exit. */
+LEAN_EXPORT void flush_trace_events();
+
+void initialize_trace_events();
+void finalize_trace_events();
+}
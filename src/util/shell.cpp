@@ -23,6 +23,7 @@ Author: Leonardo de Moura
 #include "runtime/array_ref.h"
 #include "runtime/object_ref.h"
 #include "runtime/utf8.h"
+#include "runtime/trace_events.h"
 #include "util/timer.h"
 #include "util/macros.h"
 #include "util/io.h"
@@ -199,6 +200,8 @@ static void display_help(std::ostream & out) {
     std::cout << "  --o=oname -o       create olean file\n";
     std::cout << "  --i=iname -i       create ilean file\n";
     std::cout << "  --c=fname -c       name of the C output file\n";
+    std::cout << "  --c-shards=num     split the C output into num files that can be compiled in parallel,\n"
+              << "                     the i-th extra file is named fname with `.c` replaced by `.i.c`\n";
     std::cout << "  --bc=fname -b      name of the LLVM bitcode file\n";
     std::cout << "  --stdin            take input from stdin\n";
     std::cout << "  --root=dir         set package root directory from which the module name of the input file is calculated\n"
@@ -216,6 +219,11 @@ static void display_help(std::ostream & out) {
     std::cout << "  --server           start lean in server mode\n";
     std::cout << "  --worker           start lean in server-worker mode\n";
 #endif
+    std::cout << "  --build-worker     build the modules requested on stdin (until EOF or an empty line),\n"
+              << "                     reusing imported modules across builds; each request is a line of the\n"
+              << "                     tab-separated fields `file root olean ilean c bc` (empty if not requested),\n"
+              << "                     and its output is followed by the character 0x1E and the exit code on stdout,\n"
+              << "                     and by the character 0x1E on stderr\n";
     std::cout << "  --plugin=file      load and initialize Lean shared library for registering linters etc.\n";
     std::cout << "  --load-dynlib=file load shared library to make its symbols available to the interpreter\n";
     std::cout << "  --json             report Lean output (e.g., messages) as JSON (one per line)\n";
@@ -223,6 +231,8 @@ static void display_help(std::ostream & out) {
     std::cout << "  --print-prefix     print the installation prefix for Lean and exit\n";
     std::cout << "  --print-libdir     print the installation directory for Lean's built-in libraries and exit\n";
     std::cout << "  --profile          display elaboration/type checking time for each definition/theorem\n";
+    std::cout << "  --trace-events=file\n"
+              << "                     write profiling and task events to file in the Chrome trace-event format\n";
     std::cout << "  --stats            display environment statistics\n";
     DEBUG_CODE(
     std::cout << "  --debug=tag        enable assertions with the given tag\n";
@@ -233,6 +243,7 @@ static void display_help(std::ostream & out) {
 static int print_prefix = 0;
 static int print_libdir = 0;
 static int json_output = 0;
+static int build_worker = 0;
 
 static struct option g_long_options[] = {
     {"version",      no_argument,       0, 'v'},
@@ -252,6 +263,7 @@ static struct option g_long_options[] = {
     {"deps-json",    no_argument,       0, 'J'},
     {"timeout",      optional_argument, 0, 'T'},
     {"c",            optional_argument, 0, 'c'},
+    {"c-shards",     required_argument, 0, 'H'},
     {"bc",           optional_argument, 0, 'b'},
     {"features",     optional_argument, 0, 'f'},
     {"exitOnPanic",  no_argument,       0, 'e'},
@@ -263,7 +275,9 @@ static struct option g_long_options[] = {
 #endif
     {"plugin",       required_argument, 0, 'p'},
     {"load-dynlib",  required_argument, 0, 'l'},
+    {"trace-events", required_argument, 0, 'E'},
     {"json",         no_argument,       &json_output, 1},
+    {"build-worker", no_argument,       &build_worker, 1},
     {"print-prefix", no_argument,       &print_prefix, 1},
     {"print-libdir", no_argument,       &print_libdir, 1},
 #ifdef LEAN_DEBUG
@@ -427,6 +441,138 @@ extern "C" object* lean_environment_free_regions(object * env, object * w);
 void environment_free_regions(environment && env) {
     consume_io_result(lean_environment_free_regions(env.steal(), io_mk_world()));
 }
+
+extern "C" object* lean_enable_module_data_cache(object * w);
+void enable_module_data_cache() {
+    consume_io_result(lean_enable_module_data_cache(io_mk_world()));
+}
+
+extern "C" object* lean_reset_interpreted_mod_inits(object * w);
+void reset_interpreted_mod_inits() {
+    consume_io_result(lean_reset_interpreted_mod_inits(io_mk_world()));
+}
+}
+
+/* Removes a leading `#lang` line from `contents`. Returns false if it names an unknown language. */
+static bool strip_lang_line(std::string & contents) {
+    // Quick and dirty `#lang` support
+    // TODO: make it extensible, and add `lean4md`
+    if (contents.compare(0, 5, "#lang") == 0) {
+        auto end_line_pos = contents.find("\n");
+        // TODO: trim
+        auto lang_id      = contents.substr(6, end_line_pos - 6);
+        if (lang_id == "lean4") {
+            // do nothing for now
+        } else {
+            std::cerr << "unknown language '" << lang_id << "'\n";
+            return false;
+        }
+        // Remove up to `\n`
+        contents.erase(0, end_line_pos);
+    }
+    return true;
+}
+
+/* Writes the requested outputs of the elaborated module. Returns false if an output file cannot be created. */
+static bool write_module_outputs(environment const & env, options const & opts, name const & main_module_name,
+                                 optional<std::string> const & olean_fn, optional<std::string> const & c_output,
+                                 unsigned c_shards, optional<std::string> const & llvm_output) {
+    if (olean_fn) {
+        time_task t(".olean serialization", opts);
+        write_module(env, *olean_fn);
+    }
+
+    if (c_output) {
+        std::ofstream out(*c_output, std::ios_base::binary);
+        if (out.fail()) {
+            std::cerr << "failed to create '" << *c_output << "'\n";
+            return false;
+        }
+        time_task _("C code generation", opts);
+        if (c_shards == 1) {
+            out << lean::ir::emit_c(env, main_module_name).data();
+        } else {
+            array_ref<string_ref> shards = lean::ir::emit_c_shards(env, main_module_name, c_shards);
+            out << shards[0].data();
+            for (unsigned i = 1; i < shards.size(); i++) {
+                std::string const & fn = *c_output;
+                std::string shard_fn = fn.size() > 2 && fn.compare(fn.size() - 2, 2, ".c") == 0
+                    ? fn.substr(0, fn.size() - 2) + "." + std::to_string(i) + ".c"
+                    : fn + "." + std::to_string(i);
+                std::ofstream shard_out(shard_fn, std::ios_base::binary);
+                if (shard_out.fail()) {
+                    std::cerr << "failed to create '" << shard_fn << "'\n";
+                    return false;
+                }
+                shard_out << shards[i].data();
+            }
+        }
+        out.close();
+    }
+
+    if (llvm_output) {
+        initialize_Lean_Compiler_IR_EmitLLVM(/*builtin*/ false,
+                lean_io_mk_world());
+        time_task _("LLVM code generation", opts);
+        lean::consume_io_result(lean_ir_emit_llvm(
+                    env.to_obj_arg(), main_module_name.to_obj_arg(),
+                    lean::string_ref(*llvm_output).to_obj_arg(),
+                    lean_io_mk_world()));
+    }
+    return true;
+}
+
+/* Marks the end of the output of a request to `--build-worker`. */
+static char const g_build_worker_done = '\x1e';
+
+/*
+  Builds the modules requested on stdin until EOF or an empty line (see `--build-worker`). Each build elaborates its
+  module in a fresh environment, but the data of imported modules is read only once per process
+  (see `Lean.moduleDataCacheRef`).
+  Errors are reported on stdout, like messages, so that they are attributed to the request.
+  The end of the output is marked on both stdout and stderr; the marker is not necessarily at the beginning of a line.
+*/
+static int run_build_worker(options const & opts, unsigned trust_lvl, unsigned c_shards) {
+    enable_module_data_cache();
+    std::string line;
+    while (std::getline(std::cin, line) && !line.empty()) {
+        std::vector<optional<std::string>> fields;
+        std::stringstream in(line);
+        std::string field;
+        while (std::getline(in, field, '\t'))
+            fields.push_back(field.empty() ? optional<std::string>() : optional<std::string>(field));
+        fields.resize(6);
+        int ret = 1;
+        try {
+            if (!fields[0])
+                throw lean::exception("invalid build request, file name missing");
+            std::string const & mod_fn = *fields[0];
+            optional<std::string> const & root_dir    = fields[1];
+            optional<std::string> const & olean_fn    = fields[2];
+            optional<std::string> const & ilean_fn    = fields[3];
+            optional<std::string> const & c_output    = fields[4];
+            optional<std::string> const & llvm_output = fields[5];
+            std::string contents = read_file(mod_fn);
+            optional<name> main_module_name = module_name_of_file(mod_fn, root_dir, /* optional */ !olean_fn && !c_output);
+            if (!main_module_name)
+                main_module_name = name("_stdin");
+            if (strip_lang_line(contents)) {
+                pair_ref<environment, object_ref> r = run_new_frontend(contents, opts, mod_fn, *main_module_name, trust_lvl, ilean_fn, json_output);
+                bool ok = unbox(r.snd().raw());
+                if (ok && write_module_outputs(r.fst(), opts, *main_module_name, olean_fn, c_output, c_shards, llvm_output))
+                    ret = 0;
+            }
+        } catch (lean::throwable & ex) {
+            std::cout << ex.what() << "\n";
+        } catch (std::bad_alloc & ex) {
+            std::cout << "out of memory" << std::endl;
+        }
+        reset_interpreted_mod_inits();
+        std::cerr << g_build_worker_done << std::endl;
+        std::cout << g_build_worker_done << ret << std::endl;
+        fflush(stdout);
+    }
+    return 0;
 }
 
 extern "C" object * lean_get_prefix(object * w);
@@ -495,6 +641,7 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
     optional<std::string> server_in;
     std::string native_output;
     optional<std::string> c_output;
+    unsigned c_shards = 1;
     optional<std::string> llvm_output;
     optional<std::string> root_dir;
     buffer<string_ref> forwarded_args;
@@ -529,6 +676,10 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
                 check_optarg("c");
                 c_output = optarg;
                 break;
+            case 'H':
+                check_optarg("c-shards");
+                c_shards = std::max(1, atoi(optarg));
+                break;
             case 'b':
                 check_optarg("bc");
                 llvm_output = optarg;
@@ -617,6 +768,10 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
                 lean::load_dynlib(optarg);
                 forwarded_args.push_back(string_ref("--load-dynlib=" + std::string(optarg)));
                 break;
+            case 'E':
+                check_optarg("E");
+                start_trace_events(optarg);
+                break;
             default:
                 std::cerr << "Unknown command line option\n";
                 display_help(std::cerr);
@@ -666,6 +821,9 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
         else if (run_server == 2)
             return run_server_worker(opts);
 
+        if (build_worker)
+            return run_build_worker(opts, trust_lvl, c_shards);
+
         if (only_deps && deps_json) {
             buffer<string_ref> fns;
             if (use_stdin) {
@@ -707,21 +865,8 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
             return 0;
         }
 
-        // Quick and dirty `#lang` support
-        // TODO: make it extensible, and add `lean4md`
-        if (contents.compare(0, 5, "#lang") == 0) {
-            auto end_line_pos = contents.find("\n");
-            // TODO: trim
-            auto lang_id      = contents.substr(6, end_line_pos - 6);
-            if (lang_id == "lean4") {
-                // do nothing for now
-            } else {
-                std::cerr << "unknown language '" << lang_id << "'\n";
-                return 1;
-            }
-            // Remove up to `\n`
-            contents.erase(0, end_line_pos);
-        }
+        if (!strip_lang_line(contents))
+            return 1;
 
         if (!main_module_name)
             main_module_name = name("_stdin");
@@ -738,31 +883,8 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
             // environment_free_regions(std::move(env));
             return ret;
         }
-        if (olean_fn && ok) {
-            time_task t(".olean serialization", opts);
-            write_module(env, *olean_fn);
-        }
-
-        if (c_output && ok) {
-            std::ofstream out(*c_output, std::ios_base::binary);
-            if (out.fail()) {
-                std::cerr << "failed to create '" << *c_output << "'\n";
-                return 1;
-            }
-            time_task _("C code generation", opts);
-            out << lean::ir::emit_c(env, *main_module_name).data();
-            out.close();
-        }
-
-        if (llvm_output && ok) {
-            initialize_Lean_Compiler_IR_EmitLLVM(/*builtin*/ false,
-                    lean_io_mk_world());
-            time_task _("LLVM code generation", opts);
-            lean::consume_io_result(lean_ir_emit_llvm(
-                        env.to_obj_arg(), (*main_module_name).to_obj_arg(),
-                        lean::string_ref(*llvm_output).to_obj_arg(),
-                        lean_io_mk_world()));
-        }
+        if (ok && !write_module_outputs(env, opts, *main_module_name, olean_fn, c_output, c_shards, llvm_output))
+            return 1;
 
         display_cumulative_profiling_times(std::cerr);
 
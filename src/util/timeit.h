@@ -47,6 +47,8 @@ class xtimeit {
     second_duration m_threshold;
     second_duration m_excluded {0};
     std::chrono::steady_clock::time_point m_start;
+    std::chrono::steady_clock::time_point m_end;
+    bool m_stopped {false};
     std::function<void(second_duration)> m_fn; // NOLINT
 public:
     xtimeit(second_duration threshold, std::function<void(second_duration)> const & fn): // NOLINT
@@ -64,10 +66,18 @@ public:
     }
 
     second_duration get_elapsed_inclusive() const {
-        auto end = std::chrono::steady_clock::now();
+        auto end = m_stopped ? m_end : std::chrono::steady_clock::now();
         return second_duration(end - m_start);
     }
 
+    /** \brief Stop the timer; the time until destruction is not measured. */
+    void stop() {
+        if (!m_stopped) {
+            m_end = std::chrono::steady_clock::now();
+            m_stopped = true;
+        }
+    }
+
     second_duration get_elapsed() const {
         return get_elapsed_inclusive() - m_excluded;
     }
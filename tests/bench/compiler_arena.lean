@@ -0,0 +1,26 @@
+import Lean
+
+/-!
+  Code generation for many definitions with the old code generator.
+  Compare against `lean -Dcompiler.arena=true compiler_arena.lean`, which
+  allocates the objects of the main compiler passes in memory arenas. -/
+
+open Lean Elab Command in
+elab "gen_defs " n:num : command => do
+  for i in [0:n.getNat] do
+    let id := mkIdent (Name.mkSimple s!"f{i}")
+    let k := Syntax.mkNumLit (toString i)
+    elabCommand (← `(def $id (xs : List Nat) (s : String) : Nat × String := Id.run do
+      let mut acc := 0
+      let mut out := s
+      for x in xs do
+        if x % 3 == 0 then
+          acc := acc + x * $k
+        else if x % 5 == 0 then
+          out := out ++ toString (x + $k)
+        else match x, acc with
+          | 0, _ => acc := acc + 1
+          | n+1, m => acc := m + n
+      return (acc, out)))
+
+gen_defs 400
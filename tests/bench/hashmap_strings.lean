@@ -0,0 +1,32 @@
+import Std.Data.HashMap
+
+/-! `HashMap` lookups keyed by declaration-like strings using `String.hash` and `String.hashWithSeed`. -/
+
+/-- A string hashed with `String.hashWithSeed` instead of `String.hash`. -/
+structure SeededKey where
+  s : String
+  deriving BEq
+
+instance : Hashable SeededKey where
+  hash k := k.s.hashWithSeed 11
+
+def mkKeys (n : Nat) : Array String :=
+  (Array.range n).map fun i => s!"Lean.Elab.Tactic.someRatherLongDeclarationName_{i}.proof_{i % 7}"
+
+def run [BEq α] [Hashable α] (ks : Array α) (rounds : Nat) : Nat := Id.run do
+  let m : Std.HashMap α Nat := ks.foldl (init := {}) fun m k => m.insert k 1
+  let mut found := 0
+  for _ in [0:rounds] do
+    for k in ks do
+      found := found + m.getD k 0
+  return found
+
+def main : List String → IO Unit
+| [mode, rounds] => do
+  let ks := mkKeys 100000
+  let rounds := rounds.toNat!
+  if mode == "murmur" || mode == "all" then
+    IO.println s!"murmur: {run ks rounds}"
+  if mode == "wyhash" || mode == "all" then
+    IO.println s!"wyhash: {run (ks.map SeededKey.mk) rounds}"
+| _ => throw $ IO.userError "give mode (murmur/wyhash/all) and number of rounds"
@@ -0,0 +1,42 @@
+import Lean.Data.Json
+
+/-!
+Parsing and printing of JSON messages the size of the language server's semantic token and
+diagnostic notifications, with `Json.parse`/`Json.compress` (`lean`) or their native
+implementations `Json.parseNative`/`Json.compressNative` (`native`).
+-/
+
+open Lean
+
+def semanticTokens (n : Nat) : Json :=
+  let data := (Array.range (5 * n)).map fun i => toJson (i * 7919 % 1000)
+  Json.mkObj [("jsonrpc", "2.0"), ("id", 42), ("result", Json.mkObj [("data", Json.arr data)])]
+
+def diagnostics (n : Nat) : Json :=
+  let pos (l c : Nat) := Json.mkObj [("line", l), ("character", c)]
+  let diag (i : Nat) := Json.mkObj [
+    ("range", Json.mkObj [("start", pos i 2), ("end", pos (i + 1) 40)]),
+    ("fullRange", Json.mkObj [("start", pos i 2), ("end", pos (i + 3) 12)]),
+    ("severity", 1), ("source", "Lean 4"),
+    ("message", s!"type mismatch\n  h{i}\nhas type\n  x{i} = y{i} : Prop\nbut is expected to have type\n  \"α{i}\" ≤ β : Prop")]
+  Json.mkObj [("jsonrpc", "2.0"), ("method", "textDocument/publishDiagnostics"), ("params", Json.mkObj [
+    ("uri", "file:///home/user/project/Project/Basic.lean"), ("version", 3),
+    ("diagnostics", Json.arr <| (Array.range n).map diag)])]
+
+def roundtrip (native : Bool) (s : String) : Except String String :=
+  if native then
+    return (← Json.parseNative s).compressNative
+  else
+    return (← Json.parse s).compress
+
+def main : List String → IO Unit
+| [mode, rounds] => do
+  let native := mode == "native"
+  let msgs := #[(semanticTokens 20000).compress, (diagnostics 2000).compress]
+  let mut size := 0
+  for _ in [0:rounds.toNat!] do
+    for msg in msgs do
+      let out ← IO.ofExcept <| roundtrip native msg
+      size := size + out.utf8ByteSize
+  IO.println s!"{size}"
+| _ => throw $ IO.userError "give mode (lean/native) and number of rounds"
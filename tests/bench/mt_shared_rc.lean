@@ -0,0 +1,19 @@
+/-!
+Several tasks repeatedly building new data that points into a structure shared between threads,
+similar to parallel elaboration sharing the environment. All reference counting operations on the
+shared strings go through the multi-threaded code path.
+-/
+
+def work (xs : Array String) (rounds : Nat) : Nat := Id.run do
+  let mut total := 0
+  for _ in [0:rounds] do
+    let ps := xs.map fun s => (s, s.length)
+    total := total + ps.foldl (fun acc p => acc + p.2) 0
+  return total
+
+def main : List String → IO Unit
+| [n, tasks, rounds] => do
+  let xs := (Array.range n.toNat!).map toString
+  let ts := (List.range tasks.toNat!).map fun _ => Task.spawn fun _ => work xs rounds.toNat!
+  IO.println (ts.foldl (fun acc t => acc + t.get) 0)
+| _ => throw $ IO.userError "give size, number of tasks, and number of rounds"
@@ -0,0 +1,22 @@
+/-! Large `Nat` multiplication, division and decimal conversion. -/
+
+/-- Product of all numbers in `[lo, hi)`, computed as a balanced product tree. -/
+partial def prodRange (lo hi : Nat) : Nat :=
+  if hi - lo ≤ 8 then
+    (List.range (hi - lo)).foldl (fun acc i => acc * (lo + i)) 1
+  else
+    let mid := (lo + hi) / 2
+    prodRange lo mid * prodRange mid hi
+
+def main : List String → IO Unit
+| [n] => do
+  let n := n.toNat!
+  let f := prodRange 1 (n+1)
+  let d := 3 ^ n + 7
+  let q := f / d
+  let r := f % d
+  IO.println (toString f).length
+  IO.println (toString q).length
+  IO.println (q * d + r == f)
+  IO.println ((toString r).foldl (fun s c => s + (c.toNat - '0'.toNat)) 0)
+| _ => throw $ IO.userError "give n"
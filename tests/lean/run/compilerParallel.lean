@@ -0,0 +1,96 @@
+set_option compiler.parallel true
+
+def f (n : Nat) : Nat := n + 1
+def g (n : Nat) : Nat := n * 2
+def h (n : Nat) : Nat := f (g n)
+
+@[specialize] def twice (k : Nat → Nat) (n : Nat) : Nat := k (k n)
+def useTwice (n : Nat) : Nat := twice h n
+
+def sum : List Nat → Nat
+  | []      => 0
+  | x :: xs => x + sum xs
+
+/-!
+`partial` and well-founded definitions are compiled as `f._unsafe_rec`, but later declarations refer
+to `f`, so they must not be compiled in parallel with `f`.
+-/
+
+partial def collatzSteps (n : Nat) (acc : Nat := 0) : Nat :=
+  if n ≤ 1 then acc else collatzSteps (if n % 2 == 0 then n / 2 else 3 * n + 1) (acc + 1)
+
+def digits (n : Nat) : List Nat :=
+  if n < 10 then [n] else digits (n / 10) ++ [n % 10]
+termination_by n
+decreasing_by omega
+
+def useRec (n : Nat) : Nat := collatzSteps n + (digits n).length
+
+/-- info: 113 -/
+#guard_msgs in
+#eval useRec 27
+
+/-!
+Postponed declarations are compiled with the options in effect where they were declared.
+-/
+
+def withClosed (n : Nat) : List Nat := n :: [1, 2, 3].map (· + 1)
+
+set_option compiler.extract_closed false in
+def noClosed (n : Nat) : List Nat := n :: [1, 2, 3].map (· + 1)
+
+open Lean in
+#eval show CoreM Unit from do
+  compilePendingDecls
+  let env ← getEnv
+  unless (IR.findEnvDecl env `withClosed._closed_1).isSome && (IR.findEnvDecl env `noClosed._closed_1).isNone do
+    throwError "unexpected closed term extraction"
+
+/-!
+`evalConst` only compiles the postponed declarations that the constant uses.
+-/
+
+open Lean in
+#eval show CoreM Unit from do
+  let opts ← getOptions
+  for n in [`pendingA, `pendingB] do
+    addDecl <| .defnDecl {
+      name := n, levelParams := [], type := mkConst ``Nat, value := mkRawNatLit 1
+      hints := .opaque, safety := .safe }
+    modifyEnv (·.addPendingCodeGen opts [n])
+  match (← getEnv).compilePendingDeclsFor `pendingB with
+  | .ok env =>
+    unless (IR.findEnvDecl env `pendingB).isSome && (IR.findEnvDecl env `pendingA).isNone &&
+        (Compiler.pendingCodeGenExt.getState env).map (·.1) == [[`pendingA]] do
+      throwError "unexpected postponed declarations"
+  | .error ex => throwKernelException ex
+
+/-!
+Attributes such as `@[macro]` evaluate the new declaration using `Environment.evalConst` directly,
+which must compile the postponed declarations first.
+-/
+
+def double (n : Nat) : Nat := 2 * n
+
+syntax "twice! " term : term
+
+macro_rules
+  | `(twice! $e) => `(double $e)
+
+syntax (name := squareStx) "square! " term : term
+
+@[macro squareStx] def expandSquare : Lean.Macro
+  | `(square! $e) => `(let x := $e; x * x)
+  | _ => Lean.Macro.throwUnsupported
+
+/-- info: 14 -/
+#guard_msgs in
+#eval twice! h 3
+
+/-- info: 49 -/
+#guard_msgs in
+#eval square! h 3
+
+#eval show IO Unit from do
+  unless h 3 == 7 && useTwice 1 == 7 && sum [f 1, g 2, h 3] == 13 do
+    throw <| IO.userError "unexpected result"
@@ -0,0 +1,35 @@
+import Lean
+open Lean Meta
+
+/-!
+`DiscrTree.merge` must agree with inserting the entries of the second tree into the first one.
+-/
+
+def entries₁ : MetaM (List (Expr × Nat)) := do
+  return [(← mkAppM ``HAdd.hAdd #[mkNatLit 1, mkNatLit 2], 1),
+          (mkNatLit 3, 2),
+          (← mkAppM ``List.length #[← mkAppOptM ``List.nil #[mkConst ``Nat]], 3)]
+
+def entries₂ : MetaM (List (Expr × Nat)) := do
+  return [(← mkAppM ``HAdd.hAdd #[mkNatLit 1, mkNatLit 2], 4),
+          (← mkAppM ``HAdd.hAdd #[mkNatLit 1, mkNatLit 5], 5),
+          (mkNatLit 3, 2),
+          (← mkAppM ``List.length #[← mkAppOptM ``List.nil #[mkConst ``Bool]], 6)]
+
+def build (d : DiscrTree Nat) (es : List (Expr × Nat)) : MetaM (DiscrTree Nat) :=
+  es.foldlM (init := d) fun d (e, v) => d.insert e v {}
+
+/-- info: true -/
+#guard_msgs in
+#eval show MetaM Bool from do
+  let es₁ ← entries₁
+  let es₂ ← entries₂
+  let d₁ ← build .empty es₁
+  let d₂ ← build .empty es₂
+  let merged := d₁.merge d₂
+  let sequential ← build d₁ es₂
+  let mut ok := merged.size == sequential.size
+  for (e, _) in es₁ ++ es₂ do
+    ok := ok && (← merged.getMatch e {}) == (← sequential.getMatch e {})
+    ok := ok && (← merged.getUnify e {}) == (← sequential.getUnify e {})
+  return ok
@@ -0,0 +1,59 @@
+import Lean
+open Lean
+
+/-!
+Persistent environment extensions can compute their imported state in a task (`.async`) or on first
+access (`.lazy`). Exporting the module data must not force these states.
+-/
+
+/--
+error: invalid environment extension 'testLazyExt', import mode Lean.EnvExtensionImportMode.lazy requires `addImportedPureFn?`
+-/
+#guard_msgs in
+#eval show IO Unit from do
+  discard <| registerPersistentEnvExtension (α := Name) (β := Name) (σ := NameSet) {
+    name            := `testLazyExt
+    mkInitial       := pure {}
+    addImportedFn   := fun _ => pure {}
+    addEntryFn      := fun s n => s.insert n
+    exportEntriesFn := fun s => s.toList.toArray
+    importMode      := .lazy
+  }
+
+/-- `true` if the imported state of `ext` has not been computed into `state` yet. -/
+def isImportedStatePending (ext : PersistentEnvExtension α β σ) (env : Environment) : Bool :=
+  (ext.toEnvExtension.getState env).importedState?.isSome
+
+def getExportedEntries (env : Environment) (extName : Name) : IO (Array EnvExtensionEntry) := do
+  let data ← mkModuleData env
+  let some (_, entries) := data.entries.find? (·.1 == extName) | throw <| IO.userError s!"unknown extension {extName}"
+  return entries
+
+-- `codeActionProviderExt` is `.lazy`, and it is not used by the elaborator
+/-- info: true -/
+#guard_msgs in
+#eval return isImportedStatePending Server.codeActionProviderExt (← getEnv)
+
+/-- info: (0, true) -/
+#guard_msgs in
+#eval show CoreM _ from do
+  let env ← getEnv
+  let entries ← getExportedEntries env Server.codeActionProviderExt.name
+  return (entries.size, isImportedStatePending Server.codeActionProviderExt env)
+
+-- `instanceExtension` is `.async`, it is forced by type class resolution, and exports the local instances
+class Foo (α : Type) where
+  val : Nat
+
+instance instFooNat : Foo Nat := ⟨1⟩
+
+/-- info: 1 -/
+#guard_msgs in
+#eval Foo.val Nat
+
+/-- info: (false, 1) -/
+#guard_msgs in
+#eval show CoreM _ from do
+  let env ← getEnv
+  let entries ← getExportedEntries env Meta.instanceExtension.ext.name
+  return (isImportedStatePending Meta.instanceExtension.ext env, entries.size)
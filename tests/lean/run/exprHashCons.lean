@@ -0,0 +1,40 @@
+/-!
+With hash-consing enabled, equal expressions built with the construction functions are
+pointer-equal. Hash-consing is a process-wide setting, so instead of toggling it in this elaborator,
+the check is elaborated by a separate `lean -DhashConsExprs=true` process.
+-/
+
+def child : String := "
+import Lean
+open Lean
+
+def mkTestExpr (n : Nat) : Expr :=
+  mkApp2 (mkConst ``Nat.add) (mkRawNatLit n) (mkLambda `x .default (mkConst ``Nat) (mkRawNatLit n))
+
+unsafe def checkHashCons : IO Bool := do
+  -- use values unknown at compile time so that the expressions are built twice
+  let e₁ := mkTestExpr (← IO.rand 1 1)
+  let e₂ := mkTestExpr (← IO.rand 1 1)
+  let e₃ := mkTestExpr (← IO.rand 2 2)
+  let shared := ptrAddrUnsafe e₁ == ptrAddrUnsafe e₂ && ptrAddrUnsafe e₁.appArg! == ptrAddrUnsafe e₂.appArg!
+  let distinct := ptrAddrUnsafe e₁ != ptrAddrUnsafe e₃ && e₁ != e₃
+  let nonEmpty := (← Expr.hashConsTableSize) > 0
+  return (← Expr.isHashConsing) && shared && distinct && nonEmpty
+
+#eval checkHashCons
+"
+
+/-- info: true -/
+#guard_msgs in
+#eval show IO Unit from do
+  let lean ← IO.Process.spawn {
+    cmd := "lean"
+    args := #["--stdin", "-DhashConsExprs=true"]
+    stdin := .piped
+    stdout := .piped
+  }
+  -- the handle is closed when it is dropped after writing the input
+  let (stdin, lean) ← lean.takeStdin
+  stdin.putStr child
+  IO.print (← lean.stdout.readToEnd)
+  discard <| lean.wait
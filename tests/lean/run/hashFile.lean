@@ -0,0 +1,18 @@
+def checkHashFile (contents : String) : IO Unit := do
+  let fname : System.FilePath := "hashFile.tmp"
+  IO.FS.writeFile fname contents
+  let h ← IO.FS.hashFile fname
+  unless h == hash (← IO.FS.readBinFile fname) do
+    throw <| IO.userError s!"binary hash mismatch for {repr contents}"
+  let h ← IO.FS.hashFile fname (normalizeEol := true)
+  unless h == hash contents.crlfToLf do
+    throw <| IO.userError s!"text hash mismatch for {repr contents}"
+  IO.FS.removeFile fname
+
+#eval checkHashFile ""
+#eval checkHashFile "a"
+#eval checkHashFile "\r"
+#eval checkHashFile "\r\n"
+#eval checkHashFile "abc\r\ndef\r\r\nghi\n\r"
+#eval checkHashFile (String.join (List.replicate 20000 "line of text\r\n"))
+#eval checkHashFile (String.join (List.replicate 100000 "longer line of text\r\n\r"))
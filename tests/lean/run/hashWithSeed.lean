@@ -0,0 +1,19 @@
+/-! Basic properties of the seeded hash functions. -/
+
+#guard "abc".hashWithSeed 0 == "abc".hashWithSeed 0
+#guard "abc".hashWithSeed 0 != "abc".hashWithSeed 1
+#guard "abc".hashWithSeed 0 != "abd".hashWithSeed 0
+#guard "".hashWithSeed 0 != "a".hashWithSeed 0
+
+-- strings and byte arrays with the same bytes hash equally
+#guard "αβγ".hashWithSeed 7 == "αβγ".toUTF8.hashWithSeed 7
+
+-- inputs of all lengths around the internal block sizes
+def longString (n : Nat) : String := String.mk ((List.range n).map fun i => Char.ofNat (97 + i % 26))
+
+#guard (List.range 120).all fun n =>
+  (longString n).hashWithSeed 3 == (longString n).toUTF8.hashWithSeed 3 &&
+  (longString n).hashWithSeed 3 != (longString (n+1)).hashWithSeed 3
+
+-- chaining seeds hashes composite data
+#guard ("a".hashWithSeed ("bc".hashWithSeed 0)) != ("ab".hashWithSeed ("c".hashWithSeed 0))
@@ -0,0 +1,105 @@
+import Lean.Server.References
+
+open Lean Lean.Server Lean.Lsp
+
+def refs : Lsp.ModuleRefs :=
+  HashMap.empty
+    |>.insert (.const `Foo `Foo.bar) {
+      definition? := some ⟨⟨⟨1, 2⟩, ⟨1, 5⟩⟩, none⟩
+      usages := #[⟨⟨⟨3, 0⟩, ⟨3, 300⟩⟩, some ⟨`Foo.baz, ⟨⟨2, 0⟩, ⟨4, 0⟩⟩, ⟨⟨2, 4⟩, ⟨2, 7⟩⟩⟩⟩]
+    }
+    |>.insert (.fvar `Foo ⟨`_uniq.12345⟩) { definition? := none, usages := #[] }
+
+def ilean : Ilean := { module := `Foo, references := refs }
+
+/--
+The entries of `refs` in a canonical order. The JSON encoding of a `HashMap` depends on its
+capacity, which need not be preserved by a roundtrip.
+-/
+def sortedEntries (refs : Lsp.ModuleRefs) : Array String :=
+  refs.toArray.map (fun (ident, info) => s!"{(toJson ident).compress} {(toJson info).compress}")
+    |>.qsort (· < ·)
+
+/-- info: true -/
+#guard_msgs in
+#eval match Ilean.ofBinary? ilean.toBinary with
+  | .ok ilean' =>
+    ilean'.module == ilean.module && sortedEntries ilean'.references == sortedEntries ilean.references
+  | .error _ => false
+
+/-- info: true -/
+#guard_msgs in
+#eval match Ilean.ofBinary? (ilean.toBinary.extract 0 20) with
+  | .ok _ => false
+  | .error _ => true
+
+/-! The inverted index of `References` tracks the modules referring to each identifier. -/
+
+def defRef (line : Nat) : Lsp.RefInfo :=
+  { definition? := some ⟨⟨⟨line, 0⟩, ⟨line, 3⟩⟩, none⟩, usages := #[] }
+
+def useRef (line : Nat) : Lsp.RefInfo :=
+  { definition? := none, usages := #[⟨⟨⟨line, 0⟩, ⟨line, 3⟩⟩, none⟩] }
+
+def mkRefs (entries : List (RefIdent × Lsp.RefInfo)) : Lsp.ModuleRefs :=
+  entries.foldl (init := HashMap.empty) fun m (ident, info) => m.insert ident info
+
+def idents : List RefIdent := [.const `A `A.f, .const `A `A.h, .const `B `B.g, .const `C `C.k]
+
+/-- Modules of `r` referring to `ident` according to the index. -/
+def indexedModules (r : References) (ident : RefIdent) : List Name :=
+  (r.index.findD ident {}).toArray.qsort (·.toString < ·.toString) |>.toList
+
+/-- Modules of `r` referring to `ident`, computed without the index. -/
+def referringModules (r : References) (ident : RefIdent) : List Name :=
+  r.allRefs.toArray.filterMap (fun (module, refs) => if refs.contains ident then some module else none)
+    |>.qsort (·.toString < ·.toString) |>.toList
+
+def showIndex (r : References) : IO Unit := do
+  for ident in idents do
+    unless indexedModules r ident == referringModules r ident do
+      throw <| IO.userError "index out of sync"
+  IO.println <| ", ".intercalate <| idents.map fun
+    | ident@(.const _ n) => s!"{n}: {indexedModules r ident}"
+    | _ => ""
+
+def refsA := mkRefs [(.const `A `A.f, defRef 1), (.const `B `B.g, useRef 2)]
+def refsB := mkRefs [(.const `B `B.g, defRef 1)]
+def workerRefsA := mkRefs [(.const `A `A.f, defRef 1), (.const `A `A.h, defRef 5)]
+def moreWorkerRefsA := mkRefs [(.const `C `C.k, useRef 7)]
+
+/--
+info: A.f: [A], A.h: [], B.g: [A, B], C.k: []
+A.f: [A], A.h: [], B.g: [A, B], C.k: []
+A.f: [A], A.h: [A], B.g: [A, B], C.k: []
+A.f: [A], A.h: [A], B.g: [A, B], C.k: [A]
+A.f: [A], A.h: [A], B.g: [B], C.k: [A]
+A.f: [A], A.h: [], B.g: [A, B], C.k: []
+A.f: [A], A.h: [], B.g: [A, B], C.k: []
+A.f: [], A.h: [], B.g: [B], C.k: []
+-/
+#guard_msgs in
+#eval show IO Unit from do
+  let r := References.empty
+    |>.addIlean "A.ilean" { module := `A, references := refsA }
+    |>.addIlean "B.ilean" { module := `B, references := refsB }
+  showIndex r
+  -- there are no worker references to update yet
+  let r := r.updateWorkerRefs `A 1 workerRefsA
+  showIndex r
+  let r := r.finalizeWorkerRefs `A 1 workerRefsA
+  showIndex r
+  -- same version: merged with the current worker references
+  let r := r.updateWorkerRefs `A 1 moreWorkerRefsA
+  showIndex r
+  -- `B.g` is only referred to by the ilean file of `A`
+  let r := r.removeIlean "A.ilean"
+  showIndex r
+  -- newer version: replaces the current worker references
+  let r := r.updateWorkerRefs `A 2 refsA
+  showIndex r
+  -- older version: ignored
+  let r := r.updateWorkerRefs `A 1 workerRefsA
+  showIndex r
+  let r := r.removeWorkerRefs `A
+  showIndex r
@@ -0,0 +1,25 @@
+import Lean
+open Lean Meta
+
+/-!
+Results of `instantiateMVars` are cached in the `MetavarContext`. The cache must be restored
+together with the assignments it depends on.
+-/
+
+/--
+info: Nat.succ 1
+---
+info: Nat.succ ?m
+-/
+#guard_msgs in
+run_meta do
+  let m ← mkFreshExprMVar (mkConst ``Nat) (userName := `m)
+  let e := mkApp (mkConst ``Nat.succ) m
+  let s ← saveState
+  m.mvarId!.assign (mkNatLit 1)
+  let r₁ ← instantiateMVars e
+  let r₂ ← instantiateMVars e
+  unless r₁ == r₂ do throwError "unexpected result {r₂}"
+  logInfo r₂
+  s.restore
+  logInfo (← instantiateMVars e)
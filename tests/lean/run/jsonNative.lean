@@ -0,0 +1,47 @@
+import Lean.Data.Json
+open Lean
+
+/-! The native JSON parser and printer must agree with `Json.parse` and `Json.compress`. -/
+
+def inputs : List String := [
+  "null", "true", "false", " [ ] ", "{}", "[1, -2, 3 ,true,false,null]",
+  "{\"b\":1,\"a\":2,\"c\":{\"x\":[]},\"a\":5}",
+  "{\"k1\":1,\"k2\":2,\"k3\":3,\"k4\":4,\"k5\":5,\"k6\":6,\"k7\":7}",
+  "\"h\\u00e9llo\\n\\t\\\"x\\\\ \\ud800 \\/ \\b\\f\\r a string long enough to be scanned in blocks\"",
+  "\"héllo wörld, this is long enough to be scanned in blocks ✓ 𝔸\"",
+  "0", "-0", "1.5", "-0.001", "1e3", "1E+3", "1.25e1", "1.25e-7", "2e-0", "0e5",
+  "12345678901234567890123", "-98765432109876543210.5e2",
+  -- errors
+  "", "[1,", "{\"a\" 1}", "{\"a\":1 \"b\":2}", "tru", "nul", "01", "-", "1.", "1e", "\"\\q\"",
+  "\"\\u12g4\"", "[1 2]", "\"a\x01\"", "\"unterminated", "[] []", "+1"
+]
+
+def check (s : String) : Option String :=
+  match Json.parse s, Json.parseNative s, Json.parseUTF8Native s.toUTF8 with
+  | .ok j, .ok j', .ok j'' =>
+    if j.compress != j'.compress || j.compress != j''.compress then
+      some s!"{s}: parsed differently: {j.compress} vs. {j'.compress}"
+    else if j.compress != j.compressNative then
+      some s!"{s}: printed differently: {j.compress} vs. {j.compressNative}"
+    else
+      none
+  | .error _, .error _, .error _ => none
+  | _, _, _ => some s!"{s}: only one parser failed"
+
+/-- info: [] -/
+#guard_msgs in
+#eval inputs.filterMap check
+
+/-- info: true -/
+#guard_msgs in
+#eval Json.parseUTF8Native ⟨#[0x22, 0xff, 0x22]⟩ matches .error "invalid UTF-8"
+
+-- control characters are escaped as in `Json.compress`
+/-- info: "\"\\u0001\\u001f\\n\\r\\\"\\\\\"" -/
+#guard_msgs in
+#eval (Json.str "\x01\x1f\n\r\"\\").compressNative
+
+-- deeply nested values are printed without exhausting the stack
+/-- info: 200004 -/
+#guard_msgs in
+#eval (Nat.repeat (fun j => Json.arr #[j]) 100000 Json.null).compressNative.length
@@ -0,0 +1,27 @@
+def mkData (n : Nat) : List Nat := List.range n |>.map (· + 1000000)
+
+/-- Passing a fresh value to a task marks its object graph as multi-threaded. -/
+def test : IO Unit := do
+  let (mt₁, _) ← IO.getMarkStats
+  -- avoid `xs` being extracted as a closed term, which would make it persistent
+  let n := 100000 + (← IO.monoMsNow) % 1
+  let xs := mkData n
+  let t := Task.spawn fun _ => xs.foldl (· + ·) 0
+  unless (← IO.wait t) > 0 do
+    throw <| IO.userError "unexpected sum"
+  let (mt₂, _) ← IO.getMarkStats
+  unless mt₂.calls > mt₁.calls do
+    throw <| IO.userError "no marking calls recorded"
+  unless mt₂.objects ≥ mt₁.objects + 100000 do
+    throw <| IO.userError s!"expected at least 100000 newly marked objects, got {mt₂.objects - mt₁.objects}"
+  unless mt₂.maxObjects ≥ 100000 do
+    throw <| IO.userError s!"unexpected maximum {mt₂.maxObjects}"
+  -- Marking the same value again stops at the root
+  let ys := Runtime.markMultiThreaded xs
+  unless ys.length == n do
+    throw <| IO.userError "unexpected length"
+  let (mt₃, _) ← IO.getMarkStats
+  unless mt₃.cutoffs > mt₂.cutoffs do
+    throw <| IO.userError "expected an early cutoff"
+
+#eval test
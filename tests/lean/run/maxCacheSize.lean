@@ -0,0 +1,26 @@
+import Lean
+open Lean Meta
+
+/-! Bounded `MetaM` caches (`maxCacheSize`). -/
+
+/-- info: [true, true, true] -/
+#guard_msgs in
+run_meta do
+  let (size, counters) ← withTheReader Core.Context
+      (fun ctx => { ctx with diag := true, options := maxCacheSize.set ctx.options 4 }) do
+    for i in [0:10] do
+      discard <| inferType (mkNatSucc (mkNatLit i))
+    -- still in the young generation
+    discard <| inferType (mkNatSucc (mkNatLit 9))
+    return ((← get).cache.inferType.size, (← get).diag.cacheCounters.findD `inferType {})
+  logInfo m!"{[size ≤ 4, counters.evictions > 0, counters.hits > 0]}"
+
+-- Elaboration is not affected by evictions
+set_option maxCacheSize 2 in
+example (xs ys : List Nat) (h : xs = ys) : (xs ++ []).length + 0 = ys.length := by
+  simp [h]
+
+set_option maxCacheSize 2 in
+example : (fun (x : Nat) => x + 0) = id := by
+  funext x
+  rfl
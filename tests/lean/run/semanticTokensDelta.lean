@@ -0,0 +1,30 @@
+import Lean.Server.FileWorker.RequestHandling
+open Lean Lsp Server FileWorker
+
+/-! Edits between the semantic token data of consecutive `textDocument/semanticTokens/full` results. -/
+
+def applyEdits (data : Array Nat) (edits : Array SemanticTokensEdit) : Array Nat :=
+  edits.foldl (init := data) fun data e =>
+    data.extract 0 e.start ++ e.data?.getD #[] ++ data.extract (e.start + e.deleteCount) data.size
+
+def check (prev next : Array Nat) : Bool :=
+  applyEdits prev (computeSemanticTokensEdits prev next) == next
+
+/-- info: #[] -/
+#guard_msgs in
+#eval (computeSemanticTokensEdits #[0, 0, 3, 1, 0, 1, 2, 4, 1, 0] #[0, 0, 3, 1, 0, 1, 2, 4, 1, 0]).map (toJson ·)
+
+-- appending a token only sends the new token
+/-- info: #[{"start": 10, "deleteCount": 0, "data": [2, 0, 5, 0, 0]}] -/
+#guard_msgs in
+#eval (computeSemanticTokensEdits #[0, 0, 3, 1, 0, 1, 2, 4, 1, 0] #[0, 0, 3, 1, 0, 1, 2, 4, 1, 0, 2, 0, 5, 0, 0]).map (toJson ·)
+
+-- edits are aligned to whole tokens
+/-- info: #[{"start": 5, "deleteCount": 5, "data": [1, 2, 3, 1, 0]}] -/
+#guard_msgs in
+#eval (computeSemanticTokensEdits #[0, 0, 3, 1, 0, 1, 2, 4, 1, 0, 2, 0, 5, 0, 0] #[0, 0, 3, 1, 0, 1, 2, 3, 1, 0, 2, 0, 5, 0, 0]).map (toJson ·)
+
+#guard check #[] #[0, 0, 3, 1, 0]
+#guard check #[0, 0, 3, 1, 0] #[]
+#guard check #[1, 1, 1, 1, 1, 1, 1, 1, 1, 1] #[1, 1, 1, 1, 1]
+#guard check #[0, 0, 3, 1, 0, 1, 2, 4, 1, 0] #[0, 0, 3, 1, 0, 0, 0, 3, 1, 0, 1, 2, 4, 1, 0]
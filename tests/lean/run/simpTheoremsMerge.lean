@@ -0,0 +1,48 @@
+import Lean
+open Lean Meta
+
+/-!
+`SimpTheorems.merge` must agree with adding the entries of the second simp set to the first one,
+as done by a sequential import. In particular, a backward theorem `← thm` must erase the forward
+theorem `thm` added by an earlier module.
+-/
+
+def mkEntries (specs : List (Name × Bool)) : MetaM (Array SimpTheorem) :=
+  specs.foldlM (init := #[]) fun r (declName, inv) => do
+    let d ← ({} : SimpTheorems).addConst declName (inv := inv)
+    return r ++ d.pre.values ++ d.post.values
+
+def module₁ : List (Name × Bool) :=
+  [(``Nat.succ_eq_add_one, false), (``Nat.add_comm, false), (``List.length_cons, false)]
+
+def module₂ : List (Name × Bool) :=
+  [(``Nat.succ_eq_add_one, true), (``List.length_nil, false), (``List.length_cons, true)]
+
+def module₃ : List (Name × Bool) :=
+  [(``Nat.succ_eq_add_one, false), (``Nat.zero_add, false)]
+
+def sameEntries (t₁ t₂ : SimpTheoremTree) : Bool :=
+  let es₁ := t₁.toArray.map fun (keys, thm) => (keys, thm.origin)
+  let es₂ := t₂.toArray.map fun (keys, thm) => (keys, thm.origin)
+  es₁.size == es₂.size && es₁.all (es₂.contains ·)
+
+def same (d₁ d₂ : SimpTheorems) (origins : List Origin) : Bool :=
+  sameEntries d₁.pre d₂.pre && sameEntries d₁.post d₂.post &&
+  origins.all fun o => d₁.isLemma o == d₂.isLemma o && d₁.erased.contains o == d₂.erased.contains o
+
+/-- info: (true, true, true, true) -/
+#guard_msgs in
+#eval show MetaM _ from do
+  let es₁ ← mkEntries module₁
+  let es₂ ← mkEntries module₂
+  let es₃ ← mkEntries module₃
+  let d₁ := es₁.foldl addSimpTheoremEntry {}
+  let d₂ := es₂.foldl addSimpTheoremEntry {}
+  let d₃ := es₃.foldl addSimpTheoremEntry {}
+  let sequential := (es₁ ++ es₂ ++ es₃).foldl addSimpTheoremEntry {}
+  let origins := (es₁ ++ es₂ ++ es₃).toList.map (·.origin)
+  let fwd : Origin := .decl ``Nat.succ_eq_add_one
+  return (same ((d₁.merge d₂).merge d₃) sequential origins,
+          same (d₁.merge (d₂.merge d₃)) sequential origins,
+          ((es₁ ++ es₂).foldl addSimpTheoremEntry {}).isLemma fwd == (d₁.merge d₂).isLemma fwd,
+          (d₁.merge d₂).erased.contains fwd)
@@ -0,0 +1,106 @@
+/-!
+Solutions of closed type class problems are shared between commands. Adding, erasing, or
+activating instances must invalidate them.
+-/
+
+class Foo (α : Type) where
+  val : Nat
+
+instance : Foo Nat := ⟨1⟩
+
+/-- info: 1 -/
+#guard_msgs in
+#eval Foo.val Nat
+
+instance (priority := high) instFooNat₂ : Foo Nat := ⟨2⟩
+
+/-- info: 2 -/
+#guard_msgs in
+#eval Foo.val Nat
+
+attribute [-instance] instFooNat₂
+
+/-- info: 1 -/
+#guard_msgs in
+#eval Foo.val Nat
+
+namespace N
+scoped instance (priority := high) : Foo Nat := ⟨3⟩
+end N
+
+/-- info: 3 -/
+#guard_msgs in
+open N in
+#eval Foo.val Nat
+
+/-- info: 1 -/
+#guard_msgs in
+#eval Foo.val Nat
+
+section
+attribute [local instance high] instFooNat₂
+
+/-- info: 2 -/
+#guard_msgs in
+#eval Foo.val Nat
+end
+
+/-- info: 1 -/
+#guard_msgs in
+#eval Foo.val Nat
+
+set_option synthInstance.sharedCache false in
+/-- info: 1 -/
+#guard_msgs in
+#eval Foo.val Nat
+
+/-!
+Solutions found while a definition is locally reducible must not be reused after the section.
+-/
+
+def MyNat := Nat
+
+section
+set_option allowUnsafeReducibility true in
+attribute [local reducible] MyNat
+
+/-- info: 1 -/
+#guard_msgs in
+#eval Foo.val MyNat
+end
+
+/--
+error: failed to synthesize
+  Foo MyNat
+Additional diagnostic information may be available using the `set_option diagnostics true` command.
+-/
+#guard_msgs in
+#eval Foo.val MyNat
+
+/-!
+A solution that is still type correct must not be reused when a reducibility change makes a
+higher-priority instance match.
+-/
+
+class Bar (α : Type) where
+  val : Nat
+
+instance (priority := low) : Bar MyNat := ⟨1⟩
+instance : Bar Nat := ⟨2⟩
+
+/-- info: 1 -/
+#guard_msgs in
+#eval Bar.val MyNat
+
+section
+set_option allowUnsafeReducibility true in
+attribute [local reducible] MyNat
+
+/-- info: 2 -/
+#guard_msgs in
+#eval Bar.val MyNat
+end
+
+/-- info: 1 -/
+#guard_msgs in
+#eval Bar.val MyNat
@@ -0,0 +1,40 @@
+def tst : IO Unit := do
+  let xs := [(1 : UInt32), 2, 3].toUInt32Array
+  IO.println xs
+  let xs := xs.push 4
+  let xs := xs.set! 1 20
+  IO.println xs
+  let xs₁ := xs.set! 2 30
+  IO.println xs₁
+  IO.println xs
+  IO.println xs.size
+  IO.println (xs.fill 7)
+  IO.println xs
+  IO.println (xs.extract 1 3)
+  IO.println (xs ++ xs₁)
+  IO.println (xs.copySlice 1 xs₁ 3 2)
+  IO.println (xs.foldl (· + ·) 0)
+
+/--
+info: [1, 2, 3]
+[1, 20, 3, 4]
+[1, 20, 30, 4]
+[1, 20, 3, 4]
+4
+[7, 7, 7, 7]
+[1, 20, 3, 4]
+[20, 3]
+[1, 20, 3, 4, 1, 20, 30, 4]
+[1, 20, 30, 20, 3]
+28
+-/
+#guard_msgs in
+#eval tst
+
+/-- info: [65535, 0, 18446744073709551615] -/
+#guard_msgs in
+#eval IO.println (([65535, 0].toUInt16Array.toList.map (·.toUInt64)).toUInt64Array.push 0xFFFFFFFFFFFFFFFF)
+
+/-- info: [5, 5, 5] -/
+#guard_msgs in
+#eval IO.println (UInt64Array.mkArray 3 5)
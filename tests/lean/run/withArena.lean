@@ -0,0 +1,29 @@
+def build (n : Nat) : List (Nat × String) :=
+  (List.range n).map fun i => (i, toString i)
+
+def test : IO Unit := do
+  let escaped ← IO.mkRef ([] : List (Nat × String))
+  for round in [0:20] do
+    let r ← IO.withArena (ε := IO.Error) do
+      -- garbage
+      let _ ← pure ((build 10000).foldl (fun s (_, x) => s + x.length) 0)
+      let xs := build (1000 + round)
+      -- objects stored in a reference outlive the arena
+      escaped.modify fun es => xs.take 2 ++ es
+      return xs
+    unless r.length == 1000 + round && r.getLast? == some (999 + round, toString (999 + round)) do
+      throw <| IO.userError s!"unexpected result in round {round}"
+  let es ← escaped.get
+  unless es.length == 40 && es.getLast? == some (1, "1") do
+    throw <| IO.userError "unexpected escaped objects"
+  -- nested arenas and errors
+  let r ← IO.withArena (ε := IO.Error) do
+    let a ← IO.withArena (ε := IO.Error) (pure (build 10))
+    try
+      let _ ← IO.withArena (ε := IO.Error) (throw <| IO.userError "fail")
+    catch _ => pure ()
+    return a ++ build 5
+  unless r.length == 15 do
+    throw <| IO.userError "unexpected nested result"
+
+#eval test